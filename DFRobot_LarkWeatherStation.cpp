@@ -13,424 +13,1359 @@
 
 #define DEBUG_TIMEOUT_MS    4500
 
-#define CMD_GET_DATA                0x00 // Return name based on the passed name
-#define CMD_GET_ALL_DATA            0x01 // Get all onboard sensor data
-#define CMD_SET_TIME                0x02 // Set onboard RTC time
-#define CME_GET_TIME                0x03
-#define CMD_GET_UNIT                0x04 // Get sensor units
-#define CMD_GET_VERSION             0x05 // Get version number
-#define CMD_RESET_DATA              0x06 // Re-transmit data
-#define CMD_RADIUS_DATA             0x07 // Set cup radius
-#define CMD_SPEED1_DATA             0x08 // Set standard wind speed 1
-#define CMD_SPEED2_DATA             0x09 // Set standard wind speed 2
-#define CMD_CALIBRATOR              0x0a // Start calibration calculation
-
-#define CMD_DTU                     0x0c // DTU configuration
-#define CMD_WIFI                    0x0d // WiFi configuration
-#define CMD_LORA                    0x0e // LoRa configuration
-#define CMD_MQTT1                   0x10 // MQTT configuration
-#define CMD_MQTT2                   0x11 // MQTT configuration
-#define CMD_TOP                     0x12 // TOPIC configuration
-
-
-#define IIC_MAX_TRANSFER            32     ///< Maximum transferred data via I2C
-#define I2C_ACHE_MAX_LEN            32
-#define CMD_END             CMD_TOP
-
-
-#define ERR_CODE_NONE               0x00 ///< Normal communication 
-#define ERR_CODE_CMD_INVAILED       0x01 ///< Invalid command
-#define ERR_CODE_RES_PKT            0x02 ///< Response packet error
-#define ERR_CODE_M_NO_SPACE         0x03 ///< Insufficient memory of I2C controller(master)
-#define ERR_CODE_RES_TIMEOUT        0x04 ///< Response packet reception timeout
-#define ERR_CODE_CMD_PKT            0x05 ///< Invalid command packet or unmatched command
-#define ERR_CODE_SLAVE_BREAK        0x06 ///< Peripheral(slave) fault
-#define ERR_CODE_ARGS               0x07 ///< Set wrong parameter
-#define ERR_CODE_SKU                0x08 ///< The SKU is an invalid SKU, or unsupported by SCI Acquisition Module
-#define ERR_CODE_S_NO_SPACE         0x09 ///< Insufficient memory of I2C peripheral(slave)
-#define ERR_CODE_I2C_ADRESS         0x0A ///< Invalid I2C address
-
-#define STATUS_SUCCESS      0x53  ///< Status of successful response   
-#define STATUS_FAILED       0x63  ///< Status of failed response 
+#if (LARK_I2C_SPECULATIVE > LARK_PAYLOAD_MAX_LEN) || (LARK_I2C_SPECULATIVE > 200)
+#error "LARK_I2C_SPECULATIVE must fit the packet buffer"
+#endif
 
+/**
+ * @brief How a command is exchanged, one entry per command code
+ */
 typedef struct{
-  uint8_t cmd;      /**< Command                     */
-  uint8_t argsNumL; /**< Low byte of parameter number after the command    */
-  uint8_t argsNumH; /**< High byte of parameter number after the command    */
-  uint8_t args[0];  /**< The array with 0-data length, its size depends on the value of the previous variables argsNumL and argsNumH     */
-}__attribute__ ((packed)) sCmdSendPkt_t, *pCmdSendPkt_t;
+  uint16_t latency;   /**< Usual processing time, the first status poll is made after it */
+  uint8_t limit;      /**< Longest processing time in 100 ms steps, the response timeout runs after it */
+  uint8_t reply;      /**< LARK_REPLY_* */
+}sCommandInfo_t;
+
+#define LARK_REPLY_NONE             0      ///< The device does not answer, startRequest() rejects it
+#define LARK_REPLY_STATUS           1      ///< Only the status matters
+#define LARK_REPLY_TEXT             2      ///< The payload is the result
+
+/**
+ * @brief Command table, indexed by command code. The limits, in 100 ms steps, are the fixed delays the commands
+ * @n     used to wait before reading the response. Argument lengths are not kept: the fixed ones are checked at
+ * @n     compile time by sCommandArg, the device answers ERR_CODE_ARGS to the others.
+ */
+static const sCommandInfo_t commandTable[CMD_END + 1] PROGMEM = {
+  {   5,   1, LARK_REPLY_TEXT   }, //CMD_GET_DATA: key
+  {  10,   1, LARK_REPLY_TEXT   }, //CMD_GET_ALL_DATA: timestamp flag
+  {   5,   1, LARK_REPLY_STATUS }, //CMD_SET_TIME: sTime_t
+  {   5,   1, LARK_REPLY_TEXT   }, //CME_GET_TIME
+  {   5,   1, LARK_REPLY_TEXT   }, //CMD_GET_UNIT: key
+  {   5,   1, LARK_REPLY_TEXT   }, //CMD_GET_VERSION
+  {   0,   0, LARK_REPLY_NONE   }, //CMD_RESET_DATA, sent by restData() only
+  { 200,  20, LARK_REPLY_STATUS }, //CMD_RADIUS_DATA: float
+  {1000, 100, LARK_REPLY_STATUS }, //CMD_SPEED1_DATA: float
+  {1000, 100, LARK_REPLY_STATUS }, //CMD_SPEED2_DATA: float
+  { 200,  20, LARK_REPLY_TEXT   }, //CMD_CALIBRATOR
+  {   0,   0, LARK_REPLY_NONE   }, //0x0b project mode, sent by projectMode() only
+  {  20,   1, LARK_REPLY_STATUS }, //CMD_DTU
+  {  20,   1, LARK_REPLY_STATUS }, //CMD_WIFI
+  {  20,   1, LARK_REPLY_STATUS }, //CMD_LORA
+  {   0,   0, LARK_REPLY_NONE   }, //0x0f unused
+  {  20,   1, LARK_REPLY_STATUS }, //CMD_MQTT1
+  {  20,   1, LARK_REPLY_STATUS }, //CMD_MQTT2
+  {  20,   1, LARK_REPLY_STATUS }, //CMD_TOP
+};
+
+/**
+ * @fn commandInfo
+ * @brief Read the table entry of a command from flash
+ */
+static void commandInfo(uint8_t cmd, sCommandInfo_t *info)
+{
+  memcpy_P(info, &commandTable[cmd], sizeof(sCommandInfo_t));
+}
+
+static const uint8_t resetPacket[sizeof(sCmdSendPkt_t)] = {CMD_RESET_DATA, 0, 0};
+static const uint8_t projectPacket[sizeof(sCmdSendPkt_t)] = {0x0b, 0, 0};
+
+#define LARK_SENSOR_PACKETS(key)    {{CMD_GET_DATA, sizeof(key) - 1, 0, key}, {CMD_GET_UNIT, sizeof(key) - 1, 0, key}}
+
+/**
+ * @brief Request packets of the sensors, indexed by eSensor_t: the CMD_GET_DATA packet, then the CMD_GET_UNIT one
+ */
+static const sSensorPacket_t sensorPackets[eSensorEnd][2] PROGMEM = {
+  LARK_SENSOR_PACKETS("Temp"),
+  LARK_SENSOR_PACKETS("Humi"),
+  LARK_SENSOR_PACKETS("Speed"),
+  LARK_SENSOR_PACKETS("Dir"),
+  LARK_SENSOR_PACKETS("Altitude"),
+  LARK_SENSOR_PACKETS("Pressure"),
+};
+
+/**
+ * @fn sensorKey
+ * @brief Key of a sensor packet for the cache, used in place where flash is byte addressable
+ */
+static const char *sensorKey(const sSensorPacket_t *packet, char *buf)
+{
+#if LARK_FLASH_DIRECT
+  (void)buf;
+  return packet->key;
+#else
+  memcpy_P(buf, packet->key, LARK_CACHE_KEY_LEN);
+  return buf;
+#endif
+}
+
+/**
+ * @fn findField
+ * @brief Locate "name:value" in a payload made of fields separated by ',' ';' or line breaks
+ *
+ * @param data      Payload
+ * @param length    Byte number of the payload
+ * @param key       Field name, compared without case
+ * @param value     Returns the start of the value
+ * @param valueLen  Returns the byte number of the value
+ * @return Whether the field was found
+ */
+static bool findField(const char *data, uint16_t length, const char *key, const char **value, uint16_t *valueLen)
+{
+  uint16_t i = 0;
+  while(i < length){
+    uint16_t start = i, end, sep = 0;
+    while((i < length) && (data[i] != ',') && (data[i] != ';') && (data[i] != '\n') && (data[i] != '\r')){
+      if((sep == 0) && ((data[i] == ':') || (data[i] == '='))) sep = i;
+      i++;
+    }
+    end = i++;
+    if(sep == 0) continue;
+    while((start < sep) && (data[start] == ' ')) start++;
+    uint16_t k = 0;
+    while((start + k < sep) && key[k] && (tolower(data[start + k]) == tolower(key[k]))) k++;
+    while((start + k < sep) && (data[start + k] == ' ')) k++;
+    if((key[k] != '\0') || (start + k != sep)) continue;
+    sep++;
+    while((sep < end) && (data[sep] == ' ')) sep++;
+    while((end > sep) && (data[end - 1] == ' ')) end--;
+    *value = data + sep;
+    *valueLen = end - sep;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @fn copyText
+ * @brief Copy text into a caller buffer and terminate it
+ *
+ * @return Byte number copied, -1 if there is no room at all
+ */
+static int copyText(char *out, size_t cap, const char *text, uint16_t length)
+{
+  if((out == NULL) || (cap == 0)) return -1;
+  if(length > cap - 1) length = cap - 1;
+  memcpy(out, text, length);
+  out[length] = '\0';
+  return length;
+}
 
 typedef struct{
-  uint8_t status;   /**< Response packet status, 0x53, response succeeded, 0x63, response failed */
-  uint8_t cmd;      /**< Response packet command */
-  uint8_t lenL;     /**< Low byte of the buf array length excluding packet header */
-  uint8_t lenH;     /**< High byte of the buf array length excluding packet header */
-  uint8_t buf[0];   /**< The array with 0-data length, its size depends on the value of the previous variables lenL and lenH */
-}__attribute__ ((packed)) sCmdRecvPkt_t, *pCmdRecvPkt_t;
+  char **values;
+  size_t cap;
+}sTextSink_t;
 
+static void textSink(void *ctx, uint8_t index, const char *value, uint16_t length)
+{
+  sTextSink_t *sink = (sTextSink_t *)ctx;
+  copyText(sink->values[index], sink->cap, value, length);
+}
+
+static void stringSink(void *ctx, uint8_t index, const char *value, uint16_t length)
+{
+  String &out = ((String *)ctx)[index];
+  //Appended in place, the field is not terminated inside the payload
+  out = "";
+  out.reserve(length);
+  for(uint16_t i = 0; i < length; i++) out += value[i];
+}
+
+String DFRobot_LarkWeatherStation::getValue(const char *keys)
+{
+  if(keys == NULL) return String("");
+  return valueString(keys, NULL);
+}
+
+int DFRobot_LarkWeatherStation::getValue(const char *keys, char *out, size_t cap)
+{
+  if(keys == NULL) return -1;
+  return valueText(keys, NULL, out, cap);
+}
+
+String DFRobot_LarkWeatherStation::getValue(eSensor_t sensor)
+{
+  char key[LARK_CACHE_KEY_LEN];
+  if((unsigned)sensor >= eSensorEnd) return String("");
+  return valueString(sensorKey(&sensorPackets[sensor][0], key), &sensorPackets[sensor][0]);
+}
+
+int DFRobot_LarkWeatherStation::getValue(eSensor_t sensor, char *out, size_t cap)
+{
+  char key[LARK_CACHE_KEY_LEN];
+  if((unsigned)sensor >= eSensorEnd) return -1;
+  return valueText(sensorKey(&sensorPackets[sensor][0], key), &sensorPackets[sensor][0], out, cap);
+}
 
-String DFRobot_LarkWeatherStation::getValue(char *keys)
+String DFRobot_LarkWeatherStation::valueString(const char *key, const sSensorPacket_t *packet)
 {
   String values = "";
-  uint8_t errorCode;
-  uint16_t length = 0;
-  if(keys == NULL) return values;
-  length = strlen(keys);
-
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  if(sendpkt == NULL) return "";
-  sendpkt->cmd = CMD_GET_DATA;
-  sendpkt->argsNumL = length & 0xFF;
-  sendpkt->argsNumH = (length >> 8) & 0xFF;
-  memcpy(sendpkt->args, keys, strlen(keys));
-  
-  length += sizeof(sCmdSendPkt_t);
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
-  delay(100);
-  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)recvPacket(CMD_GET_DATA, &errorCode);
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_FAILED)) errorCode = rcvpkt->buf[0];
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_SUCCESS)){
-    length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
-    char sku[length + 1];
-    memcpy(sku, rcvpkt->buf, length);
-    sku[length] = '\0';
-    values = String(sku);
-  }
-  if(rcvpkt) free(rcvpkt);
+  const char *value = cacheValue(key);
+  if(value != NULL) return String(value);
+  value = readValue(key, NULL, packet);
+  if(value != NULL){
+    values = String(value);
+    endRequest();
+  }
   return values;
+}
 
+int DFRobot_LarkWeatherStation::valueText(const char *key, const sSensorPacket_t *packet, char *out, size_t cap)
+{
+  const char *value;
+  uint16_t length;
+  int ret;
+  value = cacheValue(key);
+  if(value != NULL) return copyText(out, cap, value, strlen(value));
+  value = readValue(key, &length, packet);
+  if(value == NULL) return -1;
+  ret = copyText(out, cap, value, length);
+  endRequest();
+  return ret;
 }
-String DFRobot_LarkWeatherStation::getUnit(char *keys)
+
+const char *DFRobot_LarkWeatherStation::readValue(const char *key, uint16_t *length, const sSensorPacket_t *packet)
+{
+  uint16_t len;
+  pCmdRecvPkt_t rcvpkt = packet ? execute(packet) : execute(CMD_GET_DATA, key, strlen(key));
+  if(rcvpkt == NULL) return NULL;
+  len = (rcvpkt->lenH << 8) | rcvpkt->lenL;
+  if(len) cacheStore(key, (const char *)rcvpkt->buf, len);
+  if(length) *length = len;
+  return (const char *)rcvpkt->buf;
+}
+
+String DFRobot_LarkWeatherStation::getUnit(const char *keys)
+{
+  if(keys == NULL) return String("");
+  return unitString(keys, NULL);
+}
+
+int DFRobot_LarkWeatherStation::getUnit(const char *keys, char *out, size_t cap)
+{
+  if(keys == NULL) return -1;
+  return unitText(keys, NULL, out, cap);
+}
+
+String DFRobot_LarkWeatherStation::getUnit(eSensor_t sensor)
+{
+  char key[LARK_CACHE_KEY_LEN];
+  if((unsigned)sensor >= eSensorEnd) return String("");
+  return unitString(sensorKey(&sensorPackets[sensor][1], key), &sensorPackets[sensor][1]);
+}
+
+int DFRobot_LarkWeatherStation::getUnit(eSensor_t sensor, char *out, size_t cap)
+{
+  char key[LARK_CACHE_KEY_LEN];
+  if((unsigned)sensor >= eSensorEnd) return -1;
+  return unitText(sensorKey(&sensorPackets[sensor][1], key), &sensorPackets[sensor][1], out, cap);
+}
+
+String DFRobot_LarkWeatherStation::unitString(const char *key, const sSensorPacket_t *packet)
 {
   String values = "";
-  uint8_t errorCode;
-  uint16_t length = 0;
-  if(keys == NULL) return values;
-  length = strlen(keys);
-
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  if(sendpkt == NULL) return "";
-  sendpkt->cmd = CMD_GET_UNIT;
-  sendpkt->argsNumL = length & 0xFF;
-  sendpkt->argsNumH = (length >> 8) & 0xFF;
-  memcpy(sendpkt->args, keys, strlen(keys));
-  
-  length += sizeof(sCmdSendPkt_t);
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
-  delay(100);
-  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)recvPacket(CMD_GET_UNIT, &errorCode);
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_FAILED)) errorCode = rcvpkt->buf[0];
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_SUCCESS)){
-    length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
-    char sku[length + 1];
-    memcpy(sku, rcvpkt->buf, length);
-    sku[length] = '\0';
-    values = String(sku);
-  }
-  if(rcvpkt) free(rcvpkt);
+  const char *unit = readUnit(key, NULL, packet);
+  if(unit != NULL){
+    values = String(unit);
+    endRequest();
+  }
   return values;
 }
 
- int DFRobot_LarkWeatherStation::setRadius(float radius){
-  uint16_t data = radius * 100;
-  uint16_t length = 2;
-  uint8_t errorCode;
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  if(sendpkt == NULL) return 0;
-  sendpkt->cmd = CMD_RADIUS_DATA;
-  sendpkt->argsNumL = length & 0xFF;
-  sendpkt->argsNumH = (length >> 8) & 0xFF;
-  sendpkt->args[0] = data >> 8;
-  sendpkt->args[1] = data & 0xff;
-  length += sizeof(sCmdSendPkt_t);
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
-  delay(2000);
-  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)recvPacket(CMD_RADIUS_DATA, &errorCode);
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_FAILED)) errorCode = rcvpkt->buf[0];
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_SUCCESS)){
-    if(rcvpkt) free(rcvpkt);
-    DBG("setRadius");
-    return 1;
+int DFRobot_LarkWeatherStation::unitText(const char *key, const sSensorPacket_t *packet, char *out, size_t cap)
+{
+  const char *unit;
+  uint16_t length;
+  int ret;
+  unit = readUnit(key, &length, packet);
+  if(unit == NULL) return -1;
+  ret = copyText(out, cap, unit, length);
+  endRequest();
+  return ret;
+}
+
+const char *DFRobot_LarkWeatherStation::readUnit(const char *key, uint16_t *length, const sSensorPacket_t *packet)
+{
+  uint16_t len;
+  sCacheEntry_t *entry = cacheFind(key, false);
+  if((entry != NULL) && (entry->valid & LARK_CACHE_UNIT)){
+    _cacheHits++;
+    if(length) *length = strlen(entry->unit);
+    return entry->unit;
+  }
+  _cacheMisses++;
+  pCmdRecvPkt_t rcvpkt = packet ? execute(packet) : execute(CMD_GET_UNIT, key, strlen(key));
+  if(rcvpkt == NULL) return NULL;
+  len = (rcvpkt->lenH << 8) | rcvpkt->lenL;
+  if(len && (len < LARK_CACHE_UNIT_LEN)){
+    entry = cacheFind(key, true);
+    if(entry != NULL){
+      memcpy(entry->unit, rcvpkt->buf, len + 1);
+      entry->valid |= LARK_CACHE_UNIT;
+    }
+  }
+  if(length) *length = len;
+  return (const char *)rcvpkt->buf;
+}
+
+bool DFRobot_LarkWeatherStation::setMaxAge(const char *key, uint32_t maxAgeMs)
+{
+  if(key == NULL){
+    _cacheMaxAge = maxAgeMs;
+    return true;
   }
-  return 0;
- }
-
- void DFRobot_LarkWeatherStation::projectMode(void){
-  uint16_t length = 0;
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  //if(sendpkt == NULL) return "";
-  sendpkt->cmd = 0x0b;
-  sendpkt->argsNumL = 0;
-  sendpkt->argsNumH = 0;
-  length += sizeof(sCmdSendPkt_t);
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
- }
-
- void DFRobot_LarkWeatherStation::setSpeed1(float speed){
-   uint16_t data = speed * 100;
-  uint16_t length = 2;
-  uint8_t errorCode;
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  if(sendpkt == NULL) return 0;
-  sendpkt->cmd = CMD_SPEED1_DATA;
-  sendpkt->argsNumL = length & 0xFF;
-  sendpkt->argsNumH = (length >> 8) & 0xFF;
-  sendpkt->args[0] = data >> 8;
-  sendpkt->args[1] = data & 0xff;
-  length += sizeof(sCmdSendPkt_t);
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
-  delay(10000);
-  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)recvPacket(CMD_SPEED1_DATA, &errorCode);
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_FAILED)) errorCode = rcvpkt->buf[0];
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_SUCCESS)){
-    if(rcvpkt) free(rcvpkt);
-  }
- }
- void DFRobot_LarkWeatherStation::setSpeed2(float speed){
-   uint16_t data = speed * 100;
-  uint16_t length = 2;
-  uint8_t errorCode;
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  if(sendpkt == NULL) return 0;
-  sendpkt->cmd = CMD_SPEED2_DATA;
-  sendpkt->argsNumL = length & 0xFF;
-  sendpkt->argsNumH = (length >> 8) & 0xFF;
-  sendpkt->args[0] = data >> 8;
-  sendpkt->args[1] = data & 0xff;
-  length += sizeof(sCmdSendPkt_t);
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
-  delay(10000);
-  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)recvPacket(CMD_SPEED2_DATA, &errorCode);
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_FAILED)) errorCode = rcvpkt->buf[0];
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_SUCCESS)){
-    if(rcvpkt) free(rcvpkt);
-  }
- }
- String DFRobot_LarkWeatherStation::calibrationSpeed(void){
-  String values = "";
-  uint16_t length = 0;
-  uint8_t errorCode;
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  if(sendpkt == NULL) return "";
-  sendpkt->cmd = CMD_CALIBRATOR;
-  sendpkt->argsNumL = length & 0xFF;
-  sendpkt->argsNumH = (length >> 8) & 0xFF;
-  length += sizeof(sCmdSendPkt_t);
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
-  delay(2000);
-  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)recvPacket(CMD_CALIBRATOR, &errorCode);
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_FAILED)) errorCode = rcvpkt->buf[0];
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_SUCCESS)){
-    length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
-    char sku[length + 1];
-    memcpy(sku, rcvpkt->buf, length);
-    sku[length] = '\0';
-    values = String(sku);
-  }
-  if(rcvpkt) free(rcvpkt);
-  return values;
- }
+  sCacheEntry_t *entry = cacheFind(key, true);
+  if(entry == NULL) return false;
+  entry->maxAge = maxAgeMs;
+  return true;
+}
+
+void DFRobot_LarkWeatherStation::clearCache(void)
+{
+  for(uint8_t i = 0; i < LARK_CACHE_SIZE; i++){
+    _cache[i].valid = 0;
+  }
+}
+
+void DFRobot_LarkWeatherStation::getCacheStats(uint32_t *hits, uint32_t *misses)
+{
+  if(hits) *hits = _cacheHits;
+  if(misses) *misses = _cacheMisses;
+}
+
+sCacheEntry_t *DFRobot_LarkWeatherStation::cacheFind(const char *key, bool create)
+{
+  sCacheEntry_t *entry = NULL;
+  if(strlen(key) >= LARK_CACHE_KEY_LEN) return NULL;
+  for(uint8_t i = 0; i < LARK_CACHE_SIZE; i++){
+    if(strcmp(_cache[i].key, key) == 0) return &_cache[i];
+  }
+  if(!create) return NULL;
+  //Reuse a free entry, otherwise the one whose value was read longest ago
+  for(uint8_t i = 0; i < LARK_CACHE_SIZE; i++){
+    if(_cache[i].key[0] == '\0'){
+      entry = &_cache[i];
+      break;
+    }
+    if((entry == NULL) || (millis() - _cache[i].stamp > millis() - entry->stamp)) entry = &_cache[i];
+  }
+  if(entry == NULL) return NULL;
+  strcpy(entry->key, key);
+  entry->maxAge = _cacheMaxAge;
+  entry->stamp = millis();
+  entry->valid = 0;
+  return entry;
+}
+
+const char *DFRobot_LarkWeatherStation::cacheValue(const char *key)
+{
+  sCacheEntry_t *entry = cacheFind(key, false);
+  if((entry != NULL) && (entry->valid & LARK_CACHE_VALUE) && (millis() - entry->stamp < entry->maxAge)){
+    _cacheHits++;
+    return entry->value;
+  }
+  _cacheMisses++;
+  return NULL;
+}
+
+void DFRobot_LarkWeatherStation::cacheStore(const char *key, const char *value, uint16_t length)
+{
+  sCacheEntry_t *entry = cacheFind(key, false);
+  if(length >= LARK_CACHE_VALUE_LEN) return;
+  if(entry == NULL){
+    if(_cacheMaxAge == 0) return;
+    entry = cacheFind(key, true);
+    if(entry == NULL) return;
+  }
+  if(entry->maxAge == 0) return;
+  memcpy(entry->value, value, length);
+  entry->value[length] = '\0';
+  entry->stamp = millis();
+  entry->valid |= LARK_CACHE_VALUE;
+}
+
+/**
+ * @fn centiArgs
+ * @brief Encode a radius or wind speed as the big endian hundredths the calibration commands take
+ *
+ * @return Whether value fits
+ */
+static bool centiArgs(float value, uint8_t *args)
+{
+  float scaled = value * 100 + 0.5;
+  uint16_t data;
+  if((scaled < 0) || (scaled > 65535)) return false;
+  data = scaled;
+  args[0] = data >> 8;
+  args[1] = data & 0xff;
+  return true;
+}
+
+/**
+ * @brief Argument encoding of each argument type, size is the byte number on the wire
+ */
+template<typename T> struct sArgCodec;
+
+template<> struct sArgCodec<float>{
+  //Big endian hundredths, centimetres of a radius or 0.01 m/s of a speed
+  static const uint8_t size = 2;
+  static bool encode(const float &value, uint8_t *args){ return centiArgs(value, args); }
+};
+
+template<> struct sArgCodec<sTime_t>{
+  //Year - 2000, month, day, 0, hour, minute, second
+  static const uint8_t size = 7;
+  static bool encode(const sTime_t &time, uint8_t *args){
+    //Month to second follow the year, each checked as its distance from the lowest value, 1 for month and day
+    static const uint8_t spans[5] PROGMEM = {11, 30, 23, 59, 59};
+    const uint16_t *field = &time.month;
+    if((uint16_t)(time.year - 2000) > 255) return false;
+    args[0] = time.year - 2000;
+    args[3] = 0;
+    for(uint8_t i = 0; i < 5; i++){
+      if((uint16_t)(field[i] - (i < 2)) > pgm_read_byte(&spans[i])) return false;
+      args[i + 1 + (i > 1)] = field[i];
+    }
+    return true;
+  }
+};
+
+/**
+ * @brief Argument type of the commands with fixed arguments, executeValue() accepts no other
+ */
+template<> struct sCommandArg<CMD_SET_TIME>{ typedef sTime_t type; };
+template<> struct sCommandArg<CMD_RADIUS_DATA>{ typedef float type; };
+template<> struct sCommandArg<CMD_SPEED1_DATA>{ typedef float type; };
+template<> struct sCommandArg<CMD_SPEED2_DATA>{ typedef float type; };
+
+template<typename T>
+uint8_t DFRobot_LarkWeatherStation::executeArgs(uint8_t cmd, const T &value)
+{
+  uint8_t args[sArgCodec<T>::size];
+  if(!sArgCodec<T>::encode(value, args)){
+    //Out of range, nothing is sent
+    _reqError = ERR_CODE_ARGS;
+    return 0;
+  }
+  return executeStatus(cmd, args, sizeof(args));
+}
+
+template<uint8_t cmd>
+uint8_t DFRobot_LarkWeatherStation::executeValue(const typename sCommandArg<cmd>::type &value)
+{
+  //Commands of one argument type share executeArgs(), only the argument type is resolved per command
+  return executeArgs(cmd, value);
+}
+
+int DFRobot_LarkWeatherStation::setRadius(float radius){
+  if(executeValue<CMD_RADIUS_DATA>(radius) == 0) return 0;
+  DBG("setRadius");
+  return 1;
+}
+
+void DFRobot_LarkWeatherStation::projectMode(void){
+  sendPacket((void *)projectPacket, sizeof(projectPacket), true);
+}
+
+void DFRobot_LarkWeatherStation::setSpeed1(float speed){
+  executeValue<CMD_SPEED1_DATA>(speed);
+}
+
+void DFRobot_LarkWeatherStation::setSpeed2(float speed){
+  executeValue<CMD_SPEED2_DATA>(speed);
+}
+
+String DFRobot_LarkWeatherStation::calibrationSpeed(void){
+  return executeString(CMD_CALIBRATOR, NULL, 0);
+}
 
 String DFRobot_LarkWeatherStation::getInformation(bool state)
 {
-  String values = "";
-  uint8_t errorCode;
-  uint16_t length = 1;
-
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  if(sendpkt == NULL) return "";
-  sendpkt->cmd = CMD_GET_ALL_DATA;
-  sendpkt->argsNumL = length & 0xFF;
-  sendpkt->argsNumH = (length >> 8) & 0xFF;
-  if(state == true){
-    sendpkt->args[0] = 1;
-  }else{
-    sendpkt->args[0] = 0;
-  }
-    
-  length += sizeof(sCmdSendPkt_t);
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
-  delay(100);
-  DBG("send ok");
-  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)recvPacket(CMD_GET_ALL_DATA, &errorCode);
-  DBG("return");
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_FAILED)) errorCode = rcvpkt->buf[0];
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_SUCCESS)/*|| (rcvpkt->status == 0xD3)*/){
-    length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
-    char sku[length + 1];
-    memcpy(sku, rcvpkt->buf, length);
-    sku[length] = '\0';
-    values = String(sku);
-  }else{
-    DBG("rcvpkt->status");
-    DBG(rcvpkt->status);
+  uint8_t args[1] = {(uint8_t)(state ? 1 : 0)};
+  return executeString(CMD_GET_ALL_DATA, args, sizeof(args));
+}
+
+int DFRobot_LarkWeatherStation::getInformation(bool state, char *out, size_t cap)
+{
+  uint8_t args[1] = {(uint8_t)(state ? 1 : 0)};
+  return executeText(CMD_GET_ALL_DATA, args, sizeof(args), out, cap);
+}
+
+uint8_t DFRobot_LarkWeatherStation::getValues(const char* const keys[], uint8_t n, String values[])
+{
+  if((keys == NULL) || (values == NULL)) return 0;
+  for(uint8_t i = 0; i < n; i++) values[i] = "";
+  return fetchValues(keys, n, stringSink, values);
+}
+
+uint8_t DFRobot_LarkWeatherStation::getValues(const char* const keys[], uint8_t n, char *values[], size_t cap)
+{
+  sTextSink_t sink = {values, cap};
+  if((keys == NULL) || (values == NULL)) return 0;
+  for(uint8_t i = 0; i < n; i++) copyText(values[i], cap, "", 0);
+  return fetchValues(keys, n, textSink, &sink);
+}
+
+uint8_t DFRobot_LarkWeatherStation::fetchValues(const char* const keys[], uint8_t n, fieldSink_t sink, void *ctx)
+{
+  uint8_t found = 0, missing = 0;
+  uint8_t pending[32];      //One bit per key, n is at most 255
+  const char *value;
+  uint16_t valueLen;
+  memset(pending, 0, sizeof(pending));
+  for(uint8_t i = 0; i < n; i++){
+    if(keys[i] == NULL) continue;
+    value = cacheValue(keys[i]);
+    if(value != NULL){
+      sink(ctx, i, value, strlen(value));
+      found++;
+    }else{
+      pending[i >> 3] |= 1 << (i & 7);
+      missing++;
+    }
+  }
+  if(missing > 1){
+    uint8_t args[1] = {0};
+    pCmdRecvPkt_t rcvpkt = execute(CMD_GET_ALL_DATA, args, sizeof(args));
+    if(rcvpkt != NULL){
+      uint16_t length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
+      for(uint8_t i = 0; i < n; i++){
+        if((pending[i >> 3] & (1 << (i & 7))) == 0) continue;
+        if(!findField((const char *)rcvpkt->buf, length, keys[i], &value, &valueLen)) continue;
+        cacheStore(keys[i], value, valueLen);
+        sink(ctx, i, value, valueLen);
+        pending[i >> 3] &= ~(1 << (i & 7));
+        found++;
+      }
+      endRequest();
+    }
+  }
+  for(uint8_t i = 0; i < n; i++){
+    if((pending[i >> 3] & (1 << (i & 7))) == 0) continue;
+    value = readValue(keys[i], &valueLen);
+    if(value == NULL) continue;
+    sink(ctx, i, value, valueLen);
+    endRequest();
+    found++;
+  }
+  return found;
+}
+
+/**
+ * @fn compassDegrees
+ * @brief Convert a 16 point compass name such as "NNE" to degrees
+ * @return Degrees, negative if the name is unknown
+ */
+static float compassDegrees(const char *name)
+{
+  static const char points[16][4] = {"N","NNE","NE","ENE","E","ESE","SE","SSE","S","SSW","SW","WSW","W","WNW","NW","NNW"};
+  for(uint8_t i = 0; i < 16; i++){
+    uint8_t k = 0;
+    while(points[i][k] && (toupper(name[k]) == points[i][k])) k++;
+    if((points[i][k] == '\0') && ((name[k] == '\0') || (name[k] == ' '))) return i * 22.5;
+  }
+  return -1;
+}
+
+/**
+ * @fn parseNumber
+ * @brief Parse the leading number of text, trailing units are ignored
+ * @return Whether text starts with a number
+ */
+static bool parseNumber(const char *text, float *value)
+{
+  const char *p = text;
+  if((*p == '-') || (*p == '+')) p++;
+  if(!isdigit(*p) && !((*p == '.') && isdigit(p[1]))) return false;
+  *value = atof(text);
+  return true;
+}
+
+static void snapshotTime(sTime_t *time, const char *text)
+{
+  uint16_t num[6] = {0};
+  uint8_t n = 0;
+  while(*text && (n < 6)){
+    if(isdigit(*text)){
+      num[n] = num[n] * 10 + (*text - '0');
+      if(!isdigit(text[1])) n++;
+    }
+    text++;
+  }
+  time->year = num[0];
+  time->month = num[1];
+  time->day = num[2];
+  time->hour = num[3];
+  time->minute = num[4];
+  time->second = num[5];
+  time->week = 0;
+}
+
+static void snapshotEntry(sSnapshotParser_t *parser)
+{
+  sWeatherSnapshot_t *out = parser->out;
+  char *name = parser->entry, *value;
+  float number;
+  parser->entry[parser->length] = '\0';
+  parser->length = 0;
+  while(*name == ' ') name++;
+  if(*name == '\0') return;
+  if(isdigit(*name)){
+    //A bare "2023/01/11 23:59:05" entry is the timestamp
+    snapshotTime(&out->time, name);
+    out->valid |= LARK_SNAPSHOT_TIME;
+    return;
+  }
+  value = name;
+  while(*value && (*value != ':') && (*value != '=')) value++;
+  if(*value == '\0') return;
+  *value++ = '\0';
+  while(*value == ' ') value++;
+  for(char *p = value - 2; (p >= name) && (*p == ' '); p--) *p = '\0';
+  for(char *p = name; *p; p++) *p = tolower(*p);
+  if((strcmp(name, "time") == 0) || (strcmp(name, "timestamp") == 0)){
+    snapshotTime(&out->time, value);
+    out->valid |= LARK_SNAPSHOT_TIME;
+  }else if(strcmp(name, "dir") == 0){
+    number = compassDegrees(value);
+    if((number >= 0) || parseNumber(value, &number)){
+      out->direction = number;
+      out->valid |= LARK_SNAPSHOT_DIR;
+    }
+  }else if(parseNumber(value, &number)){
+    if(strcmp(name, "temp") == 0){
+      out->temp = number;
+      out->valid |= LARK_SNAPSHOT_TEMP;
+    }else if(strcmp(name, "humi") == 0){
+      out->humidity = number;
+      out->valid |= LARK_SNAPSHOT_HUMI;
+    }else if(strcmp(name, "speed") == 0){
+      out->speed = number;
+      out->valid |= LARK_SNAPSHOT_SPEED;
+    }else if(strcmp(name, "altitude") == 0){
+      out->altitude = number;
+      out->valid |= LARK_SNAPSHOT_ALTITUDE;
+    }else if(strcmp(name, "pressure") == 0){
+      out->pressure = number;
+      out->valid |= LARK_SNAPSHOT_PRESSURE;
+    }
   }
-  if(rcvpkt) free(rcvpkt);
-  return values;
 }
 
-void * DFRobot_LarkWeatherStation::recvPacket(uint8_t cmd, uint8_t *errorCode){
-  if(cmd > CMD_END){
+static void snapshotFeed(void *ctx, const uint8_t *data, uint16_t length)
+{
+  sSnapshotParser_t *parser = (sSnapshotParser_t *)ctx;
+  for(uint16_t i = 0; i < length; i++){
+    char c = data[i];
+    if((c == ',') || (c == ';') || (c == '\n') || (c == '\r')){
+      snapshotEntry(parser);
+    }else if(parser->length < sizeof(parser->entry) - 1){
+      parser->entry[parser->length++] = c;
+    }
+  }
+}
+
+bool DFRobot_LarkWeatherStation::getSnapshot(sWeatherSnapshot_t &snapshot, bool state)
+{
+  sSnapshotParser_t parser;
+  uint8_t args[1] = {(uint8_t)(state ? 1 : 0)};
+  memset(&snapshot, 0, sizeof(snapshot));
+  parser.length = 0;
+  parser.out = &snapshot;
+  setBodySink(snapshotFeed, &parser);
+  pCmdRecvPkt_t rcvpkt = execute(CMD_GET_ALL_DATA, args, sizeof(args));
+  setBodySink(NULL, NULL);
+  if(rcvpkt == NULL) return false;
+  snapshotEntry(&parser);
+  endRequest();
+  return true;
+}
+
+/**
+ * @fn scaleField
+ * @brief Convert a decoded value to a scaled integer of a sample record, clamped to its range
+ */
+static int32_t scaleField(float value, float scale, int32_t min, int32_t max)
+{
+  float scaled = value * scale;
+  scaled += (scaled < 0) ? -0.5 : 0.5;
+  if(scaled <= min) return min;
+  if(scaled >= max) return max;
+  return (int32_t)scaled;
+}
+
+bool DFRobot_LarkWeatherStation::startContinuous(uint32_t periodMs, uint8_t fields, eSamplePolicy_t policy)
+{
+  if(periodMs == 0) return false;
+  stopContinuous();
+  _samplePeriod = periodMs;
+  _sampleFields = fields & LARK_SAMPLE_FIELDS;
+  _samplePolicy = policy;
+  _sampleTick = millis();
+  _sampleLast = _sampleTick;
+  return true;
+}
+
+void DFRobot_LarkWeatherStation::stopContinuous(void)
+{
+  if(_sampleBusy){
+    setBodySink(NULL, NULL);
+    endRequest();
+    _sampleBusy = false;
+  }
+  _samplePeriod = 0;
+}
+
+bool DFRobot_LarkWeatherStation::runContinuous(void)
+{
+  eRequestStatus_t status;
+  if(_samplePeriod == 0) return false;
+  if(!_sampleBusy){
+    uint8_t args[1] = {0};
+    if((int32_t)(millis() - _sampleTick) < 0) return false;
+    if(millis() - _sampleTick >= _samplePeriod) _sampleTick = millis(); //Missed a period, keep the cadence from now
+    if((_samplePolicy == eSampleBlock) && (_ringCount == LARK_SAMPLE_RING_SIZE)){
+      _sampleDropped++;
+      _sampleTick += _samplePeriod;
+      return false;
+    }
+    memset(&_sample, 0, sizeof(_sample));
+    _sampleParser.length = 0;
+    _sampleParser.out = &_sample;
+    setBodySink(snapshotFeed, &_sampleParser);
+    if(!startRequest(CMD_GET_ALL_DATA, args, sizeof(args))){
+      //Another request is in progress, try again on the next call
+      setBodySink(NULL, NULL);
+      return false;
+    }
+    _sampleStart = _sampleTick;
+    _sampleTick += _samplePeriod;
+    _sampleBusy = true;
+  }
+  status = poll();
+  if(status == eRequestBusy) return false;
+  setBodySink(NULL, NULL);
+  _sampleBusy = false;
+  if(status != eRequestDone){
+    _sampleFailed++;
+    endRequest();
+    return false;
+  }
+  snapshotEntry(&_sampleParser);
+  endRequest();
+  samplePush(_sampleStart);
+  return true;
+}
+
+void DFRobot_LarkWeatherStation::samplePush(uint32_t stamp)
+{
+  sSampleRecord_t *record;
+  uint32_t delta = (stamp - _sampleLast) / LARK_SAMPLE_TICK_MS;
+  uint8_t valid = _sample.valid & _sampleFields;
+  if(_ringCount == LARK_SAMPLE_RING_SIZE){
+    sampleShift();
+    _sampleDropped++;
+  }
+  record = &_ring[(_ringHead + _ringCount) % LARK_SAMPLE_RING_SIZE];
+  memset(record, 0, sizeof(sSampleRecord_t));
+  record->delta = (delta > 0xffff) ? 0xffff : delta;
+  if(valid & LARK_SNAPSHOT_TEMP) record->temp = scaleField(_sample.temp, 100, -32768, 32767);
+  if(valid & LARK_SNAPSHOT_HUMI) record->humidity = scaleField(_sample.humidity, 100, 0, 65535);
+  if(valid & LARK_SNAPSHOT_SPEED) record->speed = scaleField(_sample.speed, 100, 0, 65535);
+  if(valid & LARK_SNAPSHOT_DIR) record->direction = scaleField(_sample.direction, 10, 0, 3599);
+  if(valid & LARK_SNAPSHOT_ALTITUDE) record->altitude = scaleField(_sample.altitude, 1, -32768, 32767);
+  if(valid & LARK_SNAPSHOT_PRESSURE) record->pressure = scaleField(_sample.pressure, 10, 0, 65535);
+  record->valid = valid;
+  if(_ringCount == 0) _sampleStamp = stamp;
+  _ringCount++;
+  _sampleLast = stamp;
+}
+
+void DFRobot_LarkWeatherStation::sampleShift(void)
+{
+  _ringHead = (_ringHead + 1) % LARK_SAMPLE_RING_SIZE;
+  _ringCount--;
+  if(_ringCount) _sampleStamp += (uint32_t)_ring[_ringHead].delta * LARK_SAMPLE_TICK_MS;
+}
+
+uint16_t DFRobot_LarkWeatherStation::drain(sSampleRecord_t *dst, uint16_t max, uint32_t *stamp)
+{
+  uint16_t n = 0;
+  if(stamp) *stamp = _sampleStamp;
+  if(dst == NULL) return 0;
+  while((n < max) && _ringCount){
+    dst[n++] = _ring[_ringHead];
+    sampleShift();
+  }
+  return n;
+}
+
+uint16_t DFRobot_LarkWeatherStation::samplesAvailable(void)
+{
+  return _ringCount;
+}
+
+void DFRobot_LarkWeatherStation::getSampleStats(uint32_t *dropped, uint32_t *failed)
+{
+  if(dropped) *dropped = _sampleDropped;
+  if(failed) *failed = _sampleFailed;
+}
+
+void DFRobot_LarkWeatherStation::setBodySink(bodySink_t sink, void *ctx)
+{
+  _bodySink = sink;
+  _bodyCtx = ctx;
+}
+
+bool DFRobot_LarkWeatherStation::startRequest(uint8_t cmd, const void *args, uint16_t len, uint32_t delayMs)
+{
+  pCmdSendPkt_t sendpkt = (pCmdSendPkt_t)_pktBuf;
+  if(!prepareRequest(cmd, len, delayMs)) return false;
+  sendpkt->cmd = cmd;
+  sendpkt->argsNumL = len & 0xFF;
+  sendpkt->argsNumH = (len >> 8) & 0xFF;
+  if(len && (args != sendpkt->args)) memcpy(sendpkt->args, args, len);
+  _sendPkt = _pktBuf;
+  return true;
+}
+
+bool DFRobot_LarkWeatherStation::startPacket(const sSensorPacket_t *packet)
+{
+  uint8_t len = pgm_read_byte(&packet->argsNumL);
+  if(!prepareRequest(pgm_read_byte(&packet->cmd), len, LARK_LATENCY_AUTO)) return false;
+#if LARK_FLASH_DIRECT
+  _sendPkt = (const uint8_t *)packet;
+#else
+  memcpy_P(_pktBuf, packet, sizeof(sCmdSendPkt_t) + len);
+  _sendPkt = _pktBuf;
+#endif
+  return true;
+}
+
+bool DFRobot_LarkWeatherStation::prepareRequest(uint8_t cmd, uint16_t len, uint32_t delayMs)
+{
+  sCommandInfo_t info;
+  uint8_t error = ERR_CODE_NONE;
+  if((_reqState != eStateIdle) && (_reqState != eStateDone) && (_reqState != eStateError)){
+    DBG("request busy");
+    return false;
+  }
+  endRequest();
+  if(cmd <= CMD_END) commandInfo(cmd, &info);
+  if((cmd > CMD_END) || (info.reply == LARK_REPLY_NONE)){
     DBG("cmd is error!");
-    if(errorCode) *errorCode = ERR_CODE_CMD_INVAILED; //There is no this command
-    return NULL;
+    _reqError = ERR_CODE_CMD_INVAILED; //There is no this command
+    _reqState = eStateError;
+    return false;
   }
-  
-  sCmdRecvPkt_t recvPkt;
-  pCmdRecvPkt_t recvPktPtr = NULL;
-  uint16_t length = 0;
-  uint32_t t = millis();
-  while(millis() - t < _timeout/*time_ms*/){
-    DBG("k");
-    recvData(&recvPkt.status, 1);
-    if(recvPkt.status != 0xff){
-      switch(recvPkt.status){
-        case STATUS_SUCCESS:
-        case STATUS_FAILED:{
-          recvData(&recvPkt.cmd, 1);
-          if(recvPkt.cmd != cmd){
-            //recvFlush();
-            if(errorCode) *errorCode = ERR_CODE_RES_PKT; //Response packet error
-            DBG("Response pkt is error!");
-            return NULL;
+  if(sizeof(sCmdSendPkt_t) + len > sizeof(_pktBuf)){
+    error = ERR_CODE_M_NO_SPACE;
+  }
+  if(error != ERR_CODE_NONE){
+    _reqError = error;
+    _reqState = eStateError;
+#if LARK_COMMAND_STATS
+    _stats[cmd].calls++;
+    _stats[cmd].failed++;
+    _stats[cmd].errors[error]++;
+#endif
+    return false;
+  }
+  _sendLen = sizeof(sCmdSendPkt_t) + len;
+  _reqCmd = cmd;
+  _reqLimit = info.limit * 100UL;
+  _reqSpeculate = (info.reply == LARK_REPLY_TEXT) ? LARK_I2C_SPECULATIVE : 0;
+  if(delayMs == LARK_LATENCY_AUTO){
+    _reqDelay = _latencyHint[cmd];
+  }else{
+    _reqDelay = delayMs;
+    if(_reqDelay > _reqLimit) _reqLimit = _reqDelay;
+  }
+  _reqLimit += _timeout;
+  _reqPolls = 0;
+  _reqResets = 0;
+  _reqSkipped = 0;
+  _reqReadyMs = 0;
+  _reqError = ERR_CODE_NONE;
+  _reqState = eStateSend;
+  return true;
+}
+
+eRequestStatus_t DFRobot_LarkWeatherStation::poll(void)
+{
+  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)_pktBuf;
+  uint16_t length;
+  uint8_t idle = 0, skip;
+  int avail, want, got;
+  switch(_reqState){
+    case eStateIdle:
+      return eRequestIdle;
+    case eStateDone:
+      return eRequestDone;
+    case eStateError:
+      return eRequestError;
+    case eStateSend:
+      sendPacket((void *)_sendPkt, _sendLen, true);
+      _reqTick = millis();
+      _reqState = eStateWait;
+      return eRequestBusy;
+    case eStateWait:
+      if(millis() - _reqTick < _reqDelay) return eRequestBusy;
+      _pollTick = millis();
+      _pollGap = 0;
+      _hdrLen = 0;
+      _scanSkipped = 0;
+      _reqMismatch = false;
+      _reqState = eStateStatus;
+      // fall through
+    case eStateStatus:
+      //Collect the 4 header bytes, anything before a plausible header is line noise and skipped
+      if(millis() - _reqTick >= _reqLimit) return failRequest(ERR_CODE_RES_TIMEOUT);
+      if(millis() - _pollTick < _pollGap) return eRequestBusy;
+      while(true){
+        avail = recvAvailable();
+        if(avail < 1){
+          if(_scanSkipped && (millis() - _pollTick >= LARK_RESYNC_IDLE_MS)) return resync();
+          return eRequestBusy;
+        }
+        _pollTick = millis();
+        if(_hdrLen == 0){
+          //The first poll of a polled device takes the header and the start of the payload in one transaction,
+          //once it turned out busy single status bytes keep the bus free
+          want = ((avail >= 0x7fff) && (_pollGap == 0)) ? sizeof(sCmdRecvPkt_t) + _reqSpeculate : 1;
+          got = recvData(_pktBuf, want);
+          _reqPolls++;
+          //Leading 0xff are answered before the device is ready, it may become ready within the read
+          for(skip = 0; (skip < got - 1) && (_pktBuf[skip] == 0xff); skip++);
+          if(skip){
+            got -= skip;
+            memmove(_pktBuf, _pktBuf + skip, got);
           }
-          recvData(&recvPkt.lenL, 2);
-          length = (recvPkt.lenH << 8) | recvPkt.lenL;
-          DBG(length);
-          if(length<1000){
-            recvPktPtr = (pCmdRecvPkt_t)malloc(sizeof(sCmdRecvPkt_t) + length);
+          if((got < 1) || (_pktBuf[0] == 0xff)){
+            if(_scanSkipped){
+              //0xff is noise on a stream, a polled device that keeps answering it has dropped the response
+              _scanSkipped++;
+              _reqSkipped++;
+              if(++idle >= 4) return resync();
+              continue;
+            }
+            //Not ready yet, probe again soon and back off while the device stays busy
+            _pollGap = _pollGap ? _pollGap * 2 : LARK_POLL_MIN_MS;
+            if(_pollGap > LARK_POLL_MAX_MS) _pollGap = LARK_POLL_MAX_MS;
+            return eRequestBusy;
+          }
+          _hdrLen = got;
+        }else{
+          if(avail >= 0x7fff){
+            //Rest of the header and the start of the payload in one transaction
+            want = sizeof(sCmdRecvPkt_t) - _hdrLen + _reqSpeculate;
           }else{
-             return NULL;
-           }
-          
-          if(recvPktPtr == NULL){
-            if(errorCode) *errorCode = ERR_CODE_M_NO_SPACE; //Insufficient memory of I2C controller(master)
-            DBG("malloc error");
-            free(recvPktPtr);
-            return NULL;
+            want = (avail > (int)sizeof(sCmdRecvPkt_t) - _hdrLen) ? sizeof(sCmdRecvPkt_t) - _hdrLen : avail;
           }
-          memcpy(recvPktPtr, &recvPkt, sizeof(sCmdRecvPkt_t));
-      
-          if(length)recvData(recvPktPtr->buf, length);
-          if(errorCode) *errorCode = ERR_CODE_NONE;
-          return recvPktPtr;
+          got = recvData(_pktBuf + _hdrLen, want);
+          if(got < 1) return recvStalled();
+          _hdrLen += got;
+        }
+        if(scanHeader()) break;
+        if(_scanSkipped > LARK_RESYNC_MAX_SKIP) return resync();
+      }
+      _reqReadyMs = (millis() - _reqTick > 0xffff) ? 0xffff : millis() - _reqTick;
+      length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
+      DBG(length);
+      if(((_bodySink == NULL) || (rcvpkt->status != STATUS_SUCCESS)) && (sizeof(sCmdRecvPkt_t) + length + 1 > sizeof(_pktBuf))){
+        DBG("response too long");
+        recvFlush();
+        return failRequest(ERR_CODE_M_NO_SPACE); //Insufficient memory of I2C controller(master)
+      }
+      //Payload bytes that came with the header, anything past the payload is filler
+      _rspRecv = _hdrLen - sizeof(sCmdRecvPkt_t);
+      if(_rspRecv > length) _rspRecv = length;
+      if(_rspRecv && (_bodySink != NULL) && (rcvpkt->status == STATUS_SUCCESS)) _bodySink(_bodyCtx, rcvpkt->buf, _rspRecv);
+      _pollGap = 0;
+      _reqState = eStateBody;
+      // fall through
+    case eStateBody:
+      if(millis() - _pollTick < _pollGap) return eRequestBusy;
+      length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
+      if((_bodySink != NULL) && (rcvpkt->status == STATUS_SUCCESS)){
+        //Stream the payload through the buffer so its length is not limited
+        while(_rspRecv < length){
+          avail = recvAvailable();
+          if(avail < 1){
+            if(millis() - _reqTick >= _reqLimit) return failRequest(ERR_CODE_RES_TIMEOUT);
+            return eRequestBusy;
+          }
+          if(avail > length - _rspRecv) avail = length - _rspRecv;
+          if(avail > LARK_PAYLOAD_MAX_LEN) avail = LARK_PAYLOAD_MAX_LEN;
+          avail = recvData(rcvpkt->buf, avail);
+          if(avail < 1) return recvStalled();
+          _bodySink(_bodyCtx, rcvpkt->buf, avail);
+          _rspRecv += avail;
+        }
+        rcvpkt->lenL = 0;
+        rcvpkt->lenH = 0;
+        rcvpkt->buf[0] = '\0';
+        return finishRequest();
+      }
+      while(_rspRecv < length){
+        avail = recvAvailable();
+        if(avail < 1){
+          if(millis() - _reqTick >= _reqLimit) return failRequest(ERR_CODE_RES_TIMEOUT);
+          return eRequestBusy;
+        }
+        if(avail > length - _rspRecv) avail = length - _rspRecv;
+        avail = recvData(rcvpkt->buf + _rspRecv, avail);
+        if(avail < 1) return recvStalled();
+        _rspRecv += avail;
+      }
+      rcvpkt->buf[length] = '\0';
+      if(rcvpkt->status == STATUS_FAILED){
+        return failRequest(length ? rcvpkt->buf[0] : ERR_CODE_RES_PKT);
+      }
+      return finishRequest();
+  }
+  return eRequestError;
+}
+
+eRequestStatus_t DFRobot_LarkWeatherStation::failRequest(uint8_t errorCode)
+{
+  DBG(errorCode);
+  _reqError = errorCode;
+  _reqState = eStateError;
+  recordPolls();
+  return eRequestError;
+}
+
+eRequestStatus_t DFRobot_LarkWeatherStation::recvStalled(void)
+{
+  //A polled device reports bytes it does not deliver on a NACK or a failed transfer, read again shortly
+  if(millis() - _reqTick >= _reqLimit) return failRequest(ERR_CODE_RES_TIMEOUT);
+  _pollTick = millis();
+  _pollGap = LARK_POLL_MIN_MS;
+  return eRequestBusy;
+}
+
+bool DFRobot_LarkWeatherStation::scanHeader(void)
+{
+  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)_pktBuf;
+  uint16_t length;
+  while(_hdrLen){
+    if((rcvpkt->status == STATUS_SUCCESS) || (rcvpkt->status == STATUS_FAILED)){
+      if(_hdrLen < sizeof(sCmdRecvPkt_t)) return false;
+      length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
+      if(length <= LARK_FRAME_MAX_LEN){
+        if(rcvpkt->cmd == _reqCmd) return true;
+        if(rcvpkt->cmd <= CMD_END) _reqMismatch = true;
       }
-      default:
-        restData();
-        delay(50);
-        break;
-    }
     }
-    
-    delay(50);
-    //yield();
-  }
-  if(errorCode) *errorCode = ERR_CODE_RES_TIMEOUT; //Receive packet timeout
-  free(recvPktPtr);
-  DBG("Time out!");
-  DBG(millis() - t);
-  return NULL;
+    //Not a header of this command, slide the window by one byte
+    memmove(_pktBuf, _pktBuf + 1, --_hdrLen);
+    _scanSkipped++;
+    _reqSkipped++;
+  }
+  return false;
 }
 
-void DFRobot_LarkWeatherStation::restData(void){
-  uint16_t length = 0;
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  //if(sendpkt == NULL) return "";
-  sendpkt->cmd = CMD_RESET_DATA;
-  sendpkt->argsNumL = 0;
-  sendpkt->argsNumH = 0;
-  length += sizeof(sCmdSendPkt_t);
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
+eRequestStatus_t DFRobot_LarkWeatherStation::resync(void)
+{
+  if(_reqMismatch){
+    DBG("Response pkt is error!");
+    return failRequest(ERR_CODE_RES_PKT);
+  }
+  //No header followed the noise, ask the device to send the response again
+  recvFlush();
+  restData();
+  _reqResets++;
+  _hdrLen = 0;
+  _scanSkipped = 0;
+  _pollGap = LARK_POLL_MAX_MS;
+  return eRequestBusy;
 }
 
-uint8_t DFRobot_LarkWeatherStation::setTime(uint16_t year,uint8_t month,uint8_t day,uint8_t hour,uint8_t minute,uint8_t second){
-  uint16_t length = 7;
-  uint8_t errorCode;
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  if(sendpkt == NULL) return "";
-  sendpkt->cmd = CMD_SET_TIME;
-  sendpkt->argsNumL = length & 0xFF;
-  sendpkt->argsNumH = (length >> 8) & 0xFF;
-  sendpkt->args[0] = (year-2000);
-  sendpkt->args[1] = month;
-  sendpkt->args[2] = day;
-  sendpkt->args[3] = 0;
-  sendpkt->args[4] = hour;
-  sendpkt->args[5] = minute;
-  sendpkt->args[6] = second;
-    
-  length += sizeof(sCmdSendPkt_t);
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
-  delay(100);
-  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)recvPacket(CMD_SET_TIME, &errorCode);
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_FAILED)) errorCode = rcvpkt->buf[0];
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_SUCCESS)){
-    length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
-    if(rcvpkt) free(rcvpkt);
-    DBG("set time");
-    return 1;
+eRequestStatus_t DFRobot_LarkWeatherStation::finishRequest(void)
+{
+  _reqState = eStateDone;
+  recordPolls();
+  return eRequestDone;
+}
+
+void DFRobot_LarkWeatherStation::recordPolls(void)
+{
+#if LARK_POLL_STATS
+  sPollStats_t *stats = &_pollStats[_reqCmd];
+  stats->requests++;
+  stats->polls += _reqPolls;
+  stats->resets += _reqResets;
+  stats->skipped += _reqSkipped;
+  if(_reqPolls > stats->maxPolls) stats->maxPolls = _reqPolls;
+  if(_reqReadyMs > stats->maxMs) stats->maxMs = _reqReadyMs;
+#endif
+#if LARK_COMMAND_STATS
+  sCommandStats_t *calls = &_stats[_reqCmd];
+  uint32_t elapsed = (millis() - _reqTick) >> 2;
+  uint8_t bucket = 0;
+  calls->calls++;
+  if(_reqState == eStateDone){
+    calls->ok++;
+  }else{
+    calls->failed++;
+    calls->errors[_reqError < LARK_STATS_ERRORS ? _reqError : 0]++;
   }
-  return 0;
-  
+  calls->resets += _reqResets;
+  calls->polls += _reqPolls;
+  //Bucket by the bit length of elapsed / 4
+  while(elapsed && (bucket < LARK_STATS_BUCKETS - 1)){
+    elapsed >>= 1;
+    bucket++;
+  }
+  calls->latency[bucket]++;
+#endif
 }
 
-String DFRobot_LarkWeatherStation::getTimeStamp(){
+bool DFRobot_LarkWeatherStation::setLatencyHint(uint8_t cmd, uint16_t ms)
+{
+  if(cmd > CMD_END) return false;
+  _latencyHint[cmd] = ms;
+  return true;
+}
+
+uint16_t DFRobot_LarkWeatherStation::getLatencyHint(uint8_t cmd)
+{
+  if(cmd > CMD_END) return 0;
+  return _latencyHint[cmd];
+}
+
+bool DFRobot_LarkWeatherStation::getPollStats(uint8_t cmd, sPollStats_t *stats)
+{
+#if LARK_POLL_STATS
+  if((cmd > CMD_END) || (stats == NULL)) return false;
+  *stats = _pollStats[cmd];
+  return true;
+#else
+  (void)cmd;
+  (void)stats;
+  return false;
+#endif
+}
+
+void DFRobot_LarkWeatherStation::clearPollStats(void)
+{
+#if LARK_POLL_STATS
+  memset(_pollStats, 0, sizeof(_pollStats));
+#endif
+}
+
+bool DFRobot_LarkWeatherStation::getStats(uint8_t cmd, sCommandStats_t *stats)
+{
+#if LARK_COMMAND_STATS
+  if((cmd > CMD_END) || (stats == NULL)) return false;
+  *stats = _stats[cmd];
+  return true;
+#else
+  (void)cmd;
+  (void)stats;
+  return false;
+#endif
+}
+
+void DFRobot_LarkWeatherStation::clearStats(void)
+{
+#if LARK_COMMAND_STATS
+  memset(_stats, 0, sizeof(_stats));
+#endif
+}
+
+const uint8_t *DFRobot_LarkWeatherStation::response(uint16_t *length)
+{
+  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)_pktBuf;
+  if(_reqState != eStateDone) return NULL;
+  if(length) *length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
+  return rcvpkt->buf;
+}
+
+void DFRobot_LarkWeatherStation::endRequest(void)
+{
+  _reqState = eStateIdle;
+}
+
+uint8_t DFRobot_LarkWeatherStation::lastError(void)
+{
+  return _reqError;
+}
+
+uint32_t DFRobot_LarkWeatherStation::pollDelay(void)
+{
+  uint32_t elapsed = millis() - _reqTick;
+  uint32_t gap;
+  switch(_reqState){
+    case eStateWait:
+      return (elapsed < _reqDelay) ? _reqDelay - elapsed : 0;
+    case eStateStatus:
+      gap = millis() - _pollTick;
+      if(gap < _pollGap) return _pollGap - gap;
+      if(_scanSkipped){
+        //Silence after noise requests the response again
+        gap = (gap < LARK_RESYNC_IDLE_MS) ? LARK_RESYNC_IDLE_MS - gap : 0;
+        elapsed = (elapsed < _reqLimit) ? _reqLimit - elapsed : 0;
+        return (elapsed < gap) ? elapsed : gap;
+      }
+      // fall through
+    case eStateBody:
+      gap = millis() - _pollTick;
+      if(gap < _pollGap) return _pollGap - gap;
+      //Waiting for bytes, only the timeout is due
+      return (elapsed < _reqLimit) ? _reqLimit - elapsed : 0;
+    default:
+      return 0;
+  }
+}
+
+pCmdRecvPkt_t DFRobot_LarkWeatherStation::execute(uint8_t cmd, const void *args, uint16_t len)
+{
+  if(!startRequest(cmd, args, len)) return NULL;
+  return waitRequest();
+}
+
+pCmdRecvPkt_t DFRobot_LarkWeatherStation::execute(const sSensorPacket_t *packet)
+{
+  if(!startPacket(packet)) return NULL;
+  return waitRequest();
+}
+
+pCmdRecvPkt_t DFRobot_LarkWeatherStation::waitRequest(void)
+{
+  eRequestStatus_t status;
+  while((status = poll()) == eRequestBusy){
+    delay(1);
+  }
+  if(status != eRequestDone) return NULL;
+  return (pCmdRecvPkt_t)_pktBuf;
+}
+
+String DFRobot_LarkWeatherStation::executeString(uint8_t cmd, const void *args, uint16_t len)
+{
   String values = "";
-  uint8_t errorCode;
-  uint16_t length = 0;
-
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  if(sendpkt == NULL) return "";
-  sendpkt->cmd = CME_GET_TIME;
-  sendpkt->argsNumL = 0;
-  sendpkt->argsNumH = 0;
- 
-  length += sizeof(sCmdSendPkt_t);
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
-  delay(100);
-  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)recvPacket(CME_GET_TIME, &errorCode);
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_FAILED)) errorCode = rcvpkt->buf[0];
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_SUCCESS)){
-    length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
-    char sku[length + 1];
-    memcpy(sku, rcvpkt->buf, length);
-    sku[length] = '\0';
-    values = String(sku);
-  }
-  if(rcvpkt) free(rcvpkt);
+  pCmdRecvPkt_t rcvpkt = execute(cmd, args, len);
+  if(rcvpkt != NULL){
+    values = String((const char *)rcvpkt->buf);
+    endRequest();
+  }
   return values;
 }
 
+int DFRobot_LarkWeatherStation::executeText(uint8_t cmd, const void *args, uint16_t len, char *out, size_t cap)
+{
+  int ret;
+  pCmdRecvPkt_t rcvpkt = execute(cmd, args, len);
+  if(rcvpkt == NULL) return -1;
+  ret = copyText(out, cap, (const char *)rcvpkt->buf, (rcvpkt->lenH << 8) | rcvpkt->lenL);
+  endRequest();
+  return ret;
+}
+
+uint8_t DFRobot_LarkWeatherStation::executeStatus(uint8_t cmd, const void *args, uint16_t len)
+{
+  if(execute(cmd, args, len) == NULL) return 0;
+  endRequest();
+  return 1;
+}
+
+void DFRobot_LarkWeatherStation::restData(void){
+  sendPacket((void *)resetPacket, sizeof(resetPacket), true);
+}
+
+uint8_t DFRobot_LarkWeatherStation::setTime(uint16_t year,uint8_t month,uint8_t day,uint8_t hour,uint8_t minute,uint8_t second){
+  sTime_t time = {year, month, day, hour, minute, second, 0};
+  if(executeValue<CMD_SET_TIME>(time) == 0) return 0;
+  DBG("set time");
+  return 1;
+}
+
+String DFRobot_LarkWeatherStation::getTimeStamp(){
+  return executeString(CME_GET_TIME, NULL, 0);
+}
+
+int DFRobot_LarkWeatherStation::getTimeStamp(char *out, size_t cap){
+  return executeText(CME_GET_TIME, NULL, 0, out, cap);
+}
+
+bool DFRobot_LarkWeatherStation::getTime(sTime_t &time){
+  char text[24];
+  if(getTimeStamp(text, sizeof(text)) < 0) return false;
+  snapshotTime(&time, text);
+  if((time.year < 2000) || (time.month < 1) || (time.month > 12) || (time.day < 1) || (time.day > 31) ||
+     (time.hour > 23) || (time.minute > 59) || (time.second > 59)){
+    _reqError = ERR_CODE_RES_PKT;
+    return false;
+  }
+  //Days since 1970-01-01 are known to be a Thursday
+  time.week = (timeToEpoch(time) / 86400 + 4) % 7;
+  return true;
+}
+
+bool DFRobot_LarkWeatherStation::getEpoch(uint32_t *epoch){
+  sTime_t time;
+  if(!getTime(time)) return false;
+  *epoch = timeToEpoch(time);
+  return true;
+}
+
+uint8_t DFRobot_LarkWeatherStation::setEpoch(uint32_t epoch){
+  sTime_t time;
+  epochToTime(epoch, time);
+  return setTime(time.year, time.month, time.day, time.hour, time.minute, time.second);
+}
+
+uint32_t DFRobot_LarkWeatherStation::timeToEpoch(const sTime_t &time){
+  //Days since 1970-01-01 of the civil date, years counted from March so the leap day is last
+  uint32_t y = time.year - (time.month <= 2);
+  uint32_t era = y / 400;
+  uint32_t yoe = y - era * 400;
+  uint32_t doy = (153 * (time.month + (time.month > 2 ? -3 : 9)) + 2) / 5 + time.day - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  uint32_t days = era * 146097 + doe - 719468;
+  return days * 86400 + time.hour * 3600UL + time.minute * 60UL + time.second;
+}
+
+void DFRobot_LarkWeatherStation::epochToTime(uint32_t epoch, sTime_t &time){
+  uint32_t days = epoch / 86400, rem = epoch % 86400;
+  uint32_t z = days + 719468;
+  uint32_t era = z / 146097;
+  uint32_t doe = z - era * 146097;
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t mp = (5 * doy + 2) / 153;
+  time.day = doy - (153 * mp + 2) / 5 + 1;
+  time.month = mp < 10 ? mp + 3 : mp - 9;
+  time.year = yoe + era * 400 + (time.month <= 2);
+  time.hour = rem / 3600;
+  time.minute = rem % 3600 / 60;
+  time.second = rem % 60;
+  time.week = (days + 4) % 7;
+}
+
 DFRobot_LarkWeatherStation::DFRobot_LarkWeatherStation()
-  :_timeout(DEBUG_TIMEOUT_MS){}
+  :_timeout(DEBUG_TIMEOUT_MS),_reqState(eStateIdle),_reqCmd(0),_reqError(ERR_CODE_NONE),_reqSpeculate(0),
+   _sendLen(0),_sendPkt(_pktBuf),_bodySink(NULL),_bodyCtx(NULL),_cacheMaxAge(0),_cacheHits(0),_cacheMisses(0),
+   _samplePeriod(0),_sampleTick(0),_sampleStart(0),_sampleLast(0),_sampleStamp(0),_sampleDropped(0),_sampleFailed(0),
+   _sampleFields(LARK_SAMPLE_FIELDS),_samplePolicy(eSampleOverwrite),_sampleBusy(false),_configStore(NULL),_configCtx(NULL),
+   _ringHead(0),_ringCount(0){
+  memset(_cache, 0, sizeof(_cache));
+  for(uint8_t cmd = 0; cmd <= CMD_END; cmd++){
+    sCommandInfo_t info;
+    commandInfo(cmd, &info);
+    _latencyHint[cmd] = info.latency;
+  }
+  clearPollStats();
+  clearStats();
+  memset(&_config, 0, sizeof(_config));
+}
 
 DFRobot_LarkWeatherStation::~DFRobot_LarkWeatherStation(){}
 
 int DFRobot_LarkWeatherStation::begin(uint32_t freq){
   return init(freq);
 }
+#if defined(ARDUINO)
 DFRobot_LarkWeatherStation_I2C::DFRobot_LarkWeatherStation_I2C(uint8_t addr, TwoWire *pWire)
   :DFRobot_LarkWeatherStation(),_pWire(pWire),_addr(addr){
   
@@ -451,20 +1386,18 @@ void DFRobot_LarkWeatherStation_I2C::sendPacket(void *pkt, int length, bool stop
   uint8_t *pBuf = (uint8_t *)pkt;
   int remain = length;
   if((pkt == NULL) || (length == 0)) return;
-  _pWire->beginTransmission(_addr);
   while(remain){
-     //DBG("a");
-    length = (remain > IIC_MAX_TRANSFER) ? IIC_MAX_TRANSFER : remain;
+    length = (remain > LARK_I2C_CHUNK) ? LARK_I2C_CHUNK : remain;
+    _pWire->beginTransmission(_addr);
     _pWire->write(pBuf, length);
     remain -= length;
     pBuf += length;
 #if defined(ESP32)
-    if(remain) _pWire->endTransmission(true);
+    _pWire->endTransmission(true);
 #else
-    if(remain) _pWire->endTransmission(false);
+    _pWire->endTransmission(remain == 0);
 #endif
   }
-  _pWire->endTransmission();
 }
 
 int DFRobot_LarkWeatherStation_I2C::recvData(void *data, int len){
@@ -475,25 +1408,22 @@ int DFRobot_LarkWeatherStation_I2C::recvData(void *data, int len){
     DBG("pBuf ERROR!! : null pointer");
     return 0;
   }
-  //DBG(len);
+  //One transaction per Wire buffer, a repeated start between them
   while(remain){
-     //DBG("c");
-    len = remain > I2C_ACHE_MAX_LEN ? I2C_ACHE_MAX_LEN : remain;
+    len = remain > LARK_I2C_CHUNK ? LARK_I2C_CHUNK : remain;
     remain -= len;
 #if defined(ESP32)
-    if(remain) {_pWire->requestFrom(_addr, len, true);}
+    len = _pWire->requestFrom((int)_addr, len, 1);
 #else
-    if(remain){ _pWire->requestFrom(_addr, len, false);}
+    len = _pWire->requestFrom((int)_addr, len, (int)(remain == 0));
 #endif
-    else{_pWire->requestFrom(_addr, len, true);}
     for(int i = 0; i < len; i++){
       pBuf[i] = _pWire->read();
-      //DBG(pBuf[i],HEX);
-      //delay(1);
-      yield();
     }
     pBuf += len;
     total += len;
+    yield();
+    if(len == 0) break;
   }
   return total;
 }
@@ -524,13 +1454,9 @@ int DFRobot_LarkWeatherStation_UART::init(uint32_t freq){
 
 void DFRobot_LarkWeatherStation_UART::sendPacket(void *pkt, int length, bool stop){
   uint8_t *pBuf = (uint8_t *)pkt;
-  int remain = length;
   if((pkt == NULL) || (length == 0)) return;
-  for(uint8_t i = 0; i < remain; i++){
-    _s->write(pBuf[i]);
-    delay(1);
-  }
-   
+  //One bulk write, the serial driver paces the bytes
+  _s->write(pBuf, length);
 }
 
 int DFRobot_LarkWeatherStation_UART::recvData(void *data, int len)
@@ -559,21 +1485,16 @@ int DFRobot_LarkWeatherStation_UART::recvData(void *data, int len)
   // }
 
   uint8_t *pBuf = (uint8_t *)data;
-  int remain = len;
-  int total = 0;
   if(pBuf == NULL){
     DBG("pBuf ERROR!! : null pointer");
     return 0;
   }
-  
-  while(remain){
-    len = remain > I2C_ACHE_MAX_LEN ? I2C_ACHE_MAX_LEN : remain;
-    remain -= len;
-    _s->readBytes(pBuf, len);
-    pBuf += len;
-    total += len;
-  }
-  return total;
+  return _s->readBytes(pBuf, len);
+}
+
+int DFRobot_LarkWeatherStation_UART::recvAvailable(void)
+{
+  return _s->available();
 }
 
 void DFRobot_LarkWeatherStation_UART::recvFlush()
@@ -586,167 +1507,310 @@ void DFRobot_LarkWeatherStation_UART::recvFlush()
 void DFRobot_LarkWeatherStation_UART::sendFlush(){
   
 }
+#endif
 
-uint8_t DFRobot_LarkWeatherStation::configDTU(char* dtuswitch, char* method){
-  uint16_t length;
-  uint8_t errorCode;
-  String str = String(dtuswitch) +"," + String(method);
-  length = strlen(str.c_str());
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  if(sendpkt == NULL) return "";
-  sendpkt->cmd = CMD_DTU;
-  sendpkt->argsNumL = length & 0xFF;
-  sendpkt->argsNumH = (length >> 8) & 0xFF;
-  memcpy(sendpkt->args, str.c_str(), strlen(str.c_str()));
-  length += sizeof(sCmdSendPkt_t);
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
-  delay(100);
-  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)recvPacket(CMD_DTU, &errorCode);
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_FAILED)) errorCode = rcvpkt->buf[0];
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_SUCCESS)){
-    length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
-    if(rcvpkt) free(rcvpkt);
-    DBG("configDTU");
-    return 1;
+/**
+ * @fn joinArgs
+ * @brief Build "a<sep>b<sep>c" into the request packet, replaces String concatenation
+ *
+ * @return Byte number without terminator, -1 if it does not fit
+ */
+static int joinArgs(uint8_t *dst, size_t cap, char sep, const char *a, const char *b, const char *c)
+{
+  const char *parts[3] = {a, b, c};
+  size_t n = 0, len;
+  for(uint8_t i = 0; i < 3; i++){
+    if((i == 2) && (c == NULL)) break;
+    if(i){
+      if(n >= cap) return -1;
+      dst[n++] = sep;
+    }
+    len = parts[i] ? strlen(parts[i]) : 0;
+    if(n + len > cap) return -1;
+    if(len) memcpy(dst + n, parts[i], len);
+    n += len;
   }
-  return 0;
+  return n;
+}
+
+/**
+ * @fn configHash
+ * @brief FNV-1a hash of a config command and its arguments, never 0 which marks an unknown item
+ */
+static uint32_t configHash(uint8_t cmd, const uint8_t *data, uint16_t length)
+{
+  uint32_t hash = 2166136261UL;
+  hash = (hash ^ cmd) * 16777619UL;
+  for(uint16_t i = 0; i < length; i++) hash = (hash ^ data[i]) * 16777619UL;
+  return hash ? hash : 1;
+}
+
+static uint32_t shadowCheck(const sConfigShadow_t *shadow)
+{
+  return configHash(0xff, (const uint8_t *)shadow->hash, sizeof(shadow->hash));
+}
+
+int DFRobot_LarkWeatherStation::configArgs(char sep, const char *a, const char *b, const char *c)
+{
+  int len;
+  //The packet buffer still belongs to a request in progress
+  if((_reqState != eStateIdle) && (_reqState != eStateDone) && (_reqState != eStateError)) return -1;
+  len = joinArgs(((pCmdSendPkt_t)_pktBuf)->args, sizeof(_pktBuf) - sizeof(sCmdSendPkt_t), sep, a, b, c);
+  if(len < 0) _reqError = ERR_CODE_M_NO_SPACE;
+  return len;
+}
+
+uint8_t DFRobot_LarkWeatherStation::sendConfig(uint8_t item, uint8_t cmd, int len)
+{
+  uint8_t *args = ((pCmdSendPkt_t)_pktBuf)->args;
+  uint32_t hash;
+  if(len < 0) return 0;
+  hash = configHash(cmd, args, len);
+  //The arguments are built in place, execute() sends them without copying
+  if(executeStatus(cmd, args, len) == 0) return 0;
+  if(item < LARK_CONFIG_ITEMS) _config.hash[item] = hash;
+  return 1;
+}
+
+void DFRobot_LarkWeatherStation::configChanged(void)
+{
+  _config.check = shadowCheck(&_config);
+  if(_configStore) _configStore(_configCtx, &_config);
+}
+
+uint8_t DFRobot_LarkWeatherStation::configDTU(char* dtuswitch, char* method){
+  if(sendConfig(LARK_CONFIG_DTU, CMD_DTU, configArgs(',', dtuswitch, method)) == 0) return 0;
+  configChanged();
+  DBG("configDTU");
+  return 1;
 }
 
 uint8_t DFRobot_LarkWeatherStation::configWIFI(char* SSID, char* PWD){
-  uint16_t length;
-  uint8_t errorCode;
-  String str = String(SSID) +"," + String(PWD);
-  length = strlen(str.c_str());
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  if(sendpkt == NULL) return "";
-  sendpkt->cmd = CMD_WIFI;
-  sendpkt->argsNumL = length & 0xFF;
-  sendpkt->argsNumH = (length >> 8) & 0xFF;
-  memcpy(sendpkt->args, str.c_str(), strlen(str.c_str()));
-  length += sizeof(sCmdSendPkt_t);
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
-  delay(100);
-  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)recvPacket(CMD_WIFI, &errorCode);
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_FAILED)) errorCode = rcvpkt->buf[0];
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_SUCCESS)){
-    length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
-    if(rcvpkt) free(rcvpkt);
-    DBG("configWIFI");
-    return 1;
-  }
-  return 0;
+  if(sendConfig(LARK_CONFIG_WIFI, CMD_WIFI, configArgs(',', SSID, PWD)) == 0) return 0;
+  configChanged();
+  DBG("configWIFI");
+  return 1;
 } 
 uint8_t DFRobot_LarkWeatherStation::configLora(char* DEUI, char* EUI,char* KEY){
-  uint16_t length;
-  uint8_t errorCode;
-  String str = String(DEUI) +"," + String(EUI) + "," + String(KEY);
-  length = strlen(str.c_str());
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  if(sendpkt == NULL) return "";
-  sendpkt->cmd = CMD_LORA;
-  sendpkt->argsNumL = length & 0xFF;
-  sendpkt->argsNumH = (length >> 8) & 0xFF;
-  memcpy(sendpkt->args, str.c_str(), strlen(str.c_str()));
-  length += sizeof(sCmdSendPkt_t);
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
-  delay(100);
-  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)recvPacket(CMD_LORA, &errorCode);
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_FAILED)) errorCode = rcvpkt->buf[0];
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_SUCCESS)){
-    length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
-    if(rcvpkt) free(rcvpkt);
-    DBG("configLora");
-    return 1;
-  }
-  return 0;
+  if(sendConfig(LARK_CONFIG_LORA, CMD_LORA, configArgs(',', DEUI, EUI, KEY)) == 0) return 0;
+  configChanged();
+  DBG("configLora");
+  return 1;
 }
 
 uint8_t DFRobot_LarkWeatherStation::configMQTT1(char* Server, char* Server_IP,char* Save){
-  uint16_t length;
-  uint8_t errorCode;
-  String str = String(Server) +"," + String(Server_IP) + "," + String(Save);
-  length = strlen(str.c_str());
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  if(sendpkt == NULL) return "";
-  sendpkt->cmd = CMD_MQTT1;
-  sendpkt->argsNumL = length & 0xFF;
-  sendpkt->argsNumH = (length >> 8) & 0xFF;
-  memcpy(sendpkt->args, str.c_str(), strlen(str.c_str()));
-  length += sizeof(sCmdSendPkt_t);
-  
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
-  delay(100);
-  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)recvPacket(CMD_MQTT1, &errorCode);
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_FAILED)) errorCode = rcvpkt->buf[0];
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_SUCCESS)){
-    length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
-    if(rcvpkt) free(rcvpkt);
-    DBG("configMQTT1");
-    return 1;
-  }
-  return 0;
+  if(sendConfig(LARK_CONFIG_MQTT1, CMD_MQTT1, configArgs(',', Server, Server_IP, Save)) == 0) return 0;
+  configChanged();
+  DBG("configMQTT1");
+  return 1;
 }
 
 uint8_t DFRobot_LarkWeatherStation::configMQTT2(char* Iot_ID,char* Iot_PWD){
-  uint16_t length;
-  uint8_t errorCode;
-  String str = String(Iot_PWD) + "," + String(Iot_ID);
-  length = strlen(str.c_str());
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  if(sendpkt == NULL) return "";
-  sendpkt->cmd = CMD_MQTT2;
-  sendpkt->argsNumL = length & 0xFF;
-  sendpkt->argsNumH = (length >> 8) & 0xFF;
-  memcpy(sendpkt->args, str.c_str(), strlen(str.c_str()));
-  length += sizeof(sCmdSendPkt_t);
-  
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
-  delay(100);
-  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)recvPacket(CMD_MQTT2, &errorCode);
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_FAILED)) errorCode = rcvpkt->buf[0];
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_SUCCESS)){
-    length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
-    if(rcvpkt) free(rcvpkt);
-    DBG("configMQTT2");
-    return 1;
-  }
-  return 0;
+  if(sendConfig(LARK_CONFIG_MQTT2, CMD_MQTT2, configArgs(',', Iot_PWD, Iot_ID)) == 0) return 0;
+  configChanged();
+  DBG("configMQTT2");
+  return 1;
 }
 
 uint8_t DFRobot_LarkWeatherStation::configTopic(char* name,char* chan){
-  uint16_t length;
-  uint8_t errorCode;
-  String str = String(name) + ":" + String(chan);
-  length = strlen(str.c_str());
-  pCmdSendPkt_t sendpkt = NULL;
-  sendpkt = (pCmdSendPkt_t)malloc(sizeof(sCmdSendPkt_t) + length);
-  if(sendpkt == NULL) return "";
-  sendpkt->cmd = CMD_TOP;
-  sendpkt->argsNumL = length & 0xFF;
-  sendpkt->argsNumH = (length >> 8) & 0xFF;
-  memcpy(sendpkt->args, str.c_str(), strlen(str.c_str()));
-  length += sizeof(sCmdSendPkt_t);
-  
-  sendPacket(sendpkt, length, true);
-  free(sendpkt);
-  delay(100);
-  pCmdRecvPkt_t rcvpkt = (pCmdRecvPkt_t)recvPacket(CMD_TOP, &errorCode);
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_FAILED)) errorCode = rcvpkt->buf[0];
-  if((rcvpkt != NULL) && (rcvpkt->status == STATUS_SUCCESS)){
-    length = (rcvpkt->lenH << 8) | rcvpkt->lenL;
-    if(rcvpkt) free(rcvpkt);
-    DBG("configTopic");
-    return 1;
+  //Which topic slot this is is unknown, make applyConfig() write its topics again
+  for(uint8_t i = 0; i < LARK_CONFIG_TOPICS; i++) _config.hash[LARK_CONFIG_TOPIC + i] = 0;
+  if(sendConfig(0xff, CMD_TOP, configArgs(':', name, chan)) == 0){
+    configChanged();
+    return 0;
   }
-  return 0;
-}
\ No newline at end of file
+  configChanged();
+  DBG("configTopic");
+  return 1;
+}
+
+int DFRobot_LarkWeatherStation::applyConfig(const sStationConfig_t &config)
+{
+  typedef struct{
+    uint8_t cmd;
+    char sep;
+    const char *a, *b, *c;
+  }sConfigItem_t;
+  sConfigItem_t items[LARK_CONFIG_ITEMS] = {
+    {CMD_DTU, ',', config.dtuSwitch, config.dtuMethod, NULL},
+    {CMD_WIFI, ',', config.ssid, config.password, NULL},
+    {CMD_LORA, ',', config.loraDevEui, config.loraEui, config.loraKey},
+    {CMD_MQTT1, ',', config.mqttServer, config.mqttServerIp, config.mqttSave},
+    {CMD_MQTT2, ',', config.iotPwd, config.iotId, NULL},
+  };
+  int sent = 0, len;
+  bool topics = true;
+  for(uint8_t i = 0; i < LARK_CONFIG_TOPICS; i++){
+    topics = topics && (config.topicName[i] != NULL);
+    items[LARK_CONFIG_TOPIC + i].cmd = CMD_TOP;
+    items[LARK_CONFIG_TOPIC + i].sep = ':';
+    items[LARK_CONFIG_TOPIC + i].a = topics ? config.topicName[i] : NULL;
+    items[LARK_CONFIG_TOPIC + i].b = config.topicKey[i];
+    items[LARK_CONFIG_TOPIC + i].c = NULL;
+  }
+  for(uint8_t i = 0; i < LARK_CONFIG_ITEMS; i++){
+    sConfigItem_t *item = &items[i];
+    if(item->a == NULL) continue;
+    len = configArgs(item->sep, item->a, item->b, item->c);
+    if((len >= 0) && (_config.hash[i] == configHash(item->cmd, ((pCmdSendPkt_t)_pktBuf)->args, len))) continue;
+    if(sendConfig(i, item->cmd, len) == 0){
+      if(sent) configChanged();
+      return -1;
+    }
+    sent++;
+  }
+  if(sent) configChanged();
+  return sent;
+}
+
+void DFRobot_LarkWeatherStation::setConfigStore(configLoad_t load, configStore_t store, void *ctx)
+{
+  _configStore = store;
+  _configCtx = ctx;
+  if((load == NULL) || !load(ctx, &_config) || (_config.check != shadowCheck(&_config))){
+    memset(&_config, 0, sizeof(_config));
+  }
+}
+
+void DFRobot_LarkWeatherStation::clearConfigShadow(void)
+{
+  memset(&_config, 0, sizeof(_config));
+  configChanged();
+}
+
+/** Command of each calibration step, indexed by eCalibrationStep_t - 1 */
+static const uint8_t calibrationCmd[] = {CMD_RADIUS_DATA, CMD_SPEED1_DATA, CMD_SPEED2_DATA, CMD_CALIBRATOR};
+
+DFRobot_LarkWeatherStation_Calibration::DFRobot_LarkWeatherStation_Calibration(DFRobot_LarkWeatherStation *station)
+  :_station(station),_stepCb(NULL),_resultCb(NULL),_ctx(NULL),_tick(0),
+   _step(eCalibrationIdle),_finished(0),_error(ERR_CODE_NONE),_busy(false)
+{
+  memset(_value, 0, sizeof(_value));
+  memset(&_result, 0, sizeof(_result));
+}
+
+void DFRobot_LarkWeatherStation_Calibration::setCallbacks(calibrationStep_t step, calibrationResult_t result, void *ctx)
+{
+  _stepCb = step;
+  _resultCb = result;
+  _ctx = ctx;
+}
+
+bool DFRobot_LarkWeatherStation_Calibration::begin(float radius, float speed1, float speed2)
+{
+  uint8_t args[2];
+  if((_station == NULL) || ((_step > eCalibrationIdle) && (_step < eCalibrationDone))) return false;
+  if((radius <= 0) || !centiArgs(radius, args) || !centiArgs(speed1, args) || !centiArgs(speed2, args)) return false;
+  _value[0] = radius;
+  _value[1] = speed1;
+  _value[2] = speed2;
+  memset(&_result, 0, sizeof(_result));
+  _tick = millis();
+  _step = eCalibrationRadius;
+  _finished = 0;
+  _error = ERR_CODE_NONE;
+  _busy = false;
+  return true;
+}
+
+bool DFRobot_LarkWeatherStation_Calibration::run(void)
+{
+  eRequestStatus_t status;
+  if((_step == eCalibrationIdle) || (_step >= eCalibrationDone)) return false;
+  if(!_busy){
+    uint8_t cmd = calibrationCmd[_step - 1];
+    uint8_t args[2];
+    uint16_t len = 0;
+    if((int32_t)(millis() - _tick) < 0) return false;
+    if(cmd != CMD_CALIBRATOR){
+      centiArgs(_value[_step - 1], args);
+      len = sizeof(args);
+    }
+    //Another request is in progress, try again on the next call
+    if(!_station->startRequest(cmd, args, len)) return false;
+    _tick = millis();
+    _busy = true;
+  }
+  status = _station->poll();
+  if(status == eRequestBusy) return false;
+  _busy = false;
+  finishStep(status);
+  return _step >= eCalibrationDone;
+}
+
+void DFRobot_LarkWeatherStation_Calibration::finishStep(eRequestStatus_t status)
+{
+  eCalibrationStep_t step = (eCalibrationStep_t)_step;
+  if(status != eRequestDone){
+    _error = _station->lastError();
+    if(_error == ERR_CODE_NONE) _error = ERR_CODE_CMD_PKT; //The request was ended by other code
+    _station->endRequest();
+    _step = eCalibrationError;
+    if(_stepCb) _stepCb(_ctx, step, _error, progress());
+    if(_resultCb) _resultCb(_ctx, NULL);
+    return;
+  }
+  if(step == eCalibrationCalculate){
+    uint16_t length = 0, valueLen;
+    const char *text = (const char *)_station->response(&length);
+    const char *value;
+    if(findField(text, length, "Radius", &value, &valueLen) && parseNumber(value, &_result.radius)) _result.valid |= LARK_CALIBRATION_RADIUS;
+    if(findField(text, length, "K", &value, &valueLen) && parseNumber(value, &_result.k)) _result.valid |= LARK_CALIBRATION_K;
+    if(findField(text, length, "B", &value, &valueLen) && parseNumber(value, &_result.b)) _result.valid |= LARK_CALIBRATION_B;
+  }
+  _station->endRequest();
+  _finished++;
+  _step++;
+  _tick = millis() + LARK_CALIBRATION_GAP_MS;
+  if(_stepCb) _stepCb(_ctx, step, ERR_CODE_NONE, progress());
+  if((_step == eCalibrationDone) && _resultCb) _resultCb(_ctx, &_result);
+}
+
+void DFRobot_LarkWeatherStation_Calibration::cancel(void)
+{
+  if(_busy){
+    _station->endRequest();
+    _busy = false;
+  }
+  if((_step > eCalibrationIdle) && (_step < eCalibrationDone)) _step = eCalibrationError;
+}
+
+bool DFRobot_LarkWeatherStation_Calibration::busy(void)
+{
+  return _busy;
+}
+
+eCalibrationStep_t DFRobot_LarkWeatherStation_Calibration::step(void)
+{
+  return (eCalibrationStep_t)_step;
+}
+
+uint8_t DFRobot_LarkWeatherStation_Calibration::progress(void)
+{
+  uint32_t total = 0, done = 0;
+  if(_step == eCalibrationIdle) return 0;
+  if(_step == eCalibrationDone) return 100;
+  for(uint8_t i = 0; i < sizeof(calibrationCmd); i++){
+    uint32_t expected = _station->getLatencyHint(calibrationCmd[i]) + 1;
+    total += expected;
+    if(i < _finished){
+      done += expected;
+    }else if((i == _finished) && _busy){
+      uint32_t elapsed = millis() - _tick;
+      done += (elapsed < expected) ? elapsed : expected - 1;
+    }
+  }
+  return done * 100 / total;
+}
+
+bool DFRobot_LarkWeatherStation_Calibration::getResult(sCalibration_t *result)
+{
+  if(_step != eCalibrationDone) return false;
+  if(result) *result = _result;
+  return true;
+}
+
+uint8_t DFRobot_LarkWeatherStation_Calibration::lastError(void)
+{
+  return _error;
+}
@@ -11,6 +11,7 @@
 #ifndef _DFROBOT_LARKWEATHERSTATION_H_
 #define _DFROBOT_LARKWEATHERSTATION_H_
 
+#if defined(ARDUINO)
 #include "Arduino.h"
 #include "Wire.h"
 #include "DFRobot_RTU.h"
@@ -21,6 +22,9 @@
 #else
 #include "HardwareSerial.h"
 #endif
+#else
+#include "linux/DFRobot_LarkWeatherStation_Port.h"
+#endif
 
 //#define ENABLE_DBG ///< 打开这个宏, 可以看到程序的详细运行过程
 #ifdef ENABLE_DBG
@@ -29,6 +33,190 @@
 #define DBG(...)
 #endif
 
+#define CMD_GET_DATA                0x00 ///< Return name based on the passed name
+#define CMD_GET_ALL_DATA            0x01 ///< Get all onboard sensor data
+#define CMD_SET_TIME                0x02 ///< Set onboard RTC time
+#define CME_GET_TIME                0x03 ///< Get onboard RTC time
+#define CMD_GET_UNIT                0x04 ///< Get sensor units
+#define CMD_GET_VERSION             0x05 ///< Get version number
+#define CMD_RESET_DATA              0x06 ///< Re-transmit data
+#define CMD_RADIUS_DATA             0x07 ///< Set cup radius
+#define CMD_SPEED1_DATA             0x08 ///< Set standard wind speed 1
+#define CMD_SPEED2_DATA             0x09 ///< Set standard wind speed 2
+#define CMD_CALIBRATOR              0x0a ///< Start calibration calculation
+
+#define CMD_DTU                     0x0c ///< DTU configuration
+#define CMD_WIFI                    0x0d ///< WiFi configuration
+#define CMD_LORA                    0x0e ///< LoRa configuration
+#define CMD_MQTT1                   0x10 ///< MQTT configuration
+#define CMD_MQTT2                   0x11 ///< MQTT configuration
+#define CMD_TOP                     0x12 ///< TOPIC configuration
+#define CMD_END             CMD_TOP
+
+#define ERR_CODE_NONE               0x00 ///< Normal communication 
+#define ERR_CODE_CMD_INVAILED       0x01 ///< Invalid command
+#define ERR_CODE_RES_PKT            0x02 ///< Response packet error
+#define ERR_CODE_M_NO_SPACE         0x03 ///< Insufficient memory of I2C controller(master)
+#define ERR_CODE_RES_TIMEOUT        0x04 ///< Response packet reception timeout
+#define ERR_CODE_CMD_PKT            0x05 ///< Invalid command packet or unmatched command
+#define ERR_CODE_SLAVE_BREAK        0x06 ///< Peripheral(slave) fault
+#define ERR_CODE_ARGS               0x07 ///< Set wrong parameter
+#define ERR_CODE_SKU                0x08 ///< The SKU is an invalid SKU, or unsupported by SCI Acquisition Module
+#define ERR_CODE_S_NO_SPACE         0x09 ///< Insufficient memory of I2C peripheral(slave)
+#define ERR_CODE_I2C_ADRESS         0x0A ///< Invalid I2C address
+
+#define STATUS_SUCCESS      0x53  ///< Status of successful response   
+#define STATUS_FAILED       0x63  ///< Status of failed response 
+
+#ifndef LARK_CACHE_SIZE
+#if defined(__AVR__)
+#define LARK_CACHE_SIZE             4      ///< Number of keys kept in the value/unit cache
+#else
+#define LARK_CACHE_SIZE             8      ///< Number of keys kept in the value/unit cache
+#endif
+#endif
+#ifndef LARK_PAYLOAD_MAX_LEN
+#if defined(__AVR__)
+#define LARK_PAYLOAD_MAX_LEN        120    ///< Longest request argument list or response payload
+#else
+#define LARK_PAYLOAD_MAX_LEN        1000   ///< Longest request argument list or response payload
+#endif
+#endif
+#ifndef LARK_POLL_STATS
+#if defined(__AVR__)
+#define LARK_POLL_STATS             0      ///< Keep per-command poll statistics
+#else
+#define LARK_POLL_STATS             1      ///< Keep per-command poll statistics
+#endif
+#endif
+#ifndef LARK_COMMAND_STATS
+#if defined(__AVR__)
+#define LARK_COMMAND_STATS          0      ///< Keep per-command call, error and latency statistics
+#else
+#define LARK_COMMAND_STATS          1      ///< Keep per-command call, error and latency statistics
+#endif
+#endif
+#define LARK_STATS_ERRORS           (ERR_CODE_I2C_ADRESS + 1) ///< Error codes counted one by one, others share slot 0
+#define LARK_STATS_BUCKETS          10     ///< Latency buckets: below 4 ms, then doubling up to 1024 ms and above
+#ifndef LARK_POLL_MIN_MS
+#define LARK_POLL_MIN_MS            2      ///< First gap between two status polls
+#endif
+#ifndef LARK_POLL_MAX_MS
+#define LARK_POLL_MAX_MS            50     ///< Largest gap between two status polls
+#endif
+#ifndef LARK_I2C_CHUNK
+#if defined(ESP32) || defined(ESP8266)
+#define LARK_I2C_CHUNK              128    ///< Bytes per I2C transaction, the Wire buffer size of the platform
+#elif defined(ARDUINO_ARCH_RP2040)
+#define LARK_I2C_CHUNK              256    ///< Bytes per I2C transaction, the Wire buffer size of the platform
+#elif defined(ARDUINO)
+#define LARK_I2C_CHUNK              32     ///< Bytes per I2C transaction, the Wire buffer size of the platform
+#else
+#define LARK_I2C_CHUNK              256    ///< Bytes per I2C transaction, i2c-dev takes far more
+#endif
+#endif
+#ifndef LARK_I2C_SPECULATIVE
+#define LARK_I2C_SPECULATIVE        8      ///< Payload bytes read with the header while the device answers at once
+#endif
+#ifndef LARK_SAMPLE_RING_SIZE
+#if defined(__AVR__)
+#define LARK_SAMPLE_RING_SIZE       8      ///< Records kept by continuous acquisition
+#else
+#define LARK_SAMPLE_RING_SIZE       256    ///< Records kept by continuous acquisition
+#endif
+#endif
+#define LARK_SAMPLE_TICK_MS         10     ///< Unit of sSampleRecord_t.delta
+#define LARK_FRAME_MAX_LEN          4096   ///< Longest payload a plausible response header announces
+#define LARK_RESYNC_MAX_SKIP        64     ///< Noise bytes skipped before the response is requested again
+#define LARK_RESYNC_IDLE_MS         20     ///< Silence after noise before the response is requested again
+#define LARK_LATENCY_AUTO           0xffffffff ///< Wait for the latency hint of the command before the first poll
+#define LARK_CACHE_KEY_LEN          10     ///< Longest cached key including terminator
+#define LARK_CACHE_VALUE_LEN        12     ///< Longest cached value including terminator
+#define LARK_CACHE_UNIT_LEN         8      ///< Longest cached unit including terminator
+#define LARK_CACHE_VALUE            0x01   ///< sCacheEntry_t.value holds a value
+#define LARK_CACHE_UNIT             0x02   ///< sCacheEntry_t.unit holds a unit
+#ifndef LARK_FLASH_DIRECT
+#if defined(__AVR__) || defined(ESP8266)
+#define LARK_FLASH_DIRECT           0      ///< Constant packets are copied to RAM before sending, flash is not byte addressable
+#else
+#define LARK_FLASH_DIRECT           1      ///< Constant packets are sent straight from flash
+#endif
+#endif
+
+typedef struct{
+  uint8_t cmd;      /**< Command                     */
+  uint8_t argsNumL; /**< Low byte of parameter number after the command    */
+  uint8_t argsNumH; /**< High byte of parameter number after the command    */
+  uint8_t args[0];  /**< The array with 0-data length, its size depends on the value of the previous variables argsNumL and argsNumH     */
+}__attribute__ ((packed)) sCmdSendPkt_t, *pCmdSendPkt_t;
+
+typedef struct{
+  uint8_t status;   /**< Response packet status, 0x53, response succeeded, 0x63, response failed */
+  uint8_t cmd;      /**< Response packet command */
+  uint8_t lenL;     /**< Low byte of the buf array length excluding packet header */
+  uint8_t lenH;     /**< High byte of the buf array length excluding packet header */
+  uint8_t buf[0];   /**< The array with 0-data length, its size depends on the value of the previous variables lenL and lenH */
+}__attribute__ ((packed)) sCmdRecvPkt_t, *pCmdRecvPkt_t;
+
+/**
+ * @brief Sensors of the station, their request packets are built at compile time
+ */
+typedef enum{
+  eSensorTemp = 0,    /**< "Temp", temperature */
+  eSensorHumi,        /**< "Humi", relative humidity */
+  eSensorSpeed,       /**< "Speed", wind speed */
+  eSensorDir,         /**< "Dir", wind direction */
+  eSensorAltitude,    /**< "Altitude", altitude */
+  eSensorPressure,    /**< "Pressure", atmospheric pressure */
+  eSensorEnd,         /**< Number of sensors */
+}eSensor_t;
+
+typedef struct{
+  uint8_t cmd;                    /**< CMD_GET_DATA or CMD_GET_UNIT */
+  uint8_t argsNumL;               /**< Byte number of the key */
+  uint8_t argsNumH;               /**< Always 0 */
+  char key[LARK_CACHE_KEY_LEN];   /**< Key, the packet ends before its terminator */
+}__attribute__ ((packed)) sSensorPacket_t;
+
+typedef struct{
+  char key[LARK_CACHE_KEY_LEN];      /**< Key name, empty when the entry is free */
+  char value[LARK_CACHE_VALUE_LEN];  /**< Last value read from the device */
+  char unit[LARK_CACHE_UNIT_LEN];    /**< Unit of the key, valid for the whole session */
+  uint32_t stamp;                    /**< millis() when the value was read */
+  uint32_t maxAge;                   /**< Time a value is reused, 0 disables value caching */
+  uint8_t valid;                     /**< LARK_CACHE_VALUE and/or LARK_CACHE_UNIT */
+}sCacheEntry_t;
+
+/**
+ * @enum eRequestStatus_t
+ * @brief Status of a non-blocking request, returned by poll()
+ */
+typedef enum{
+  eRequestIdle = 0, /**< No request has been started */
+  eRequestBusy,     /**< The request is in progress, call poll() again later */
+  eRequestDone,     /**< The response was received successfully */
+  eRequestError,    /**< The request failed, see lastError() */
+}eRequestStatus_t;
+
+typedef struct{
+  uint32_t requests;  /**< Exchanges that reached the status poll or failed after sending */
+  uint32_t polls;     /**< Status bytes read, including not ready and corrupted ones */
+  uint32_t resets;    /**< Retransmissions requested when no valid header followed the noise */
+  uint32_t skipped;   /**< Noise bytes discarded while looking for the response header */
+  uint16_t maxPolls;  /**< Most status bytes read by one exchange */
+  uint16_t maxMs;     /**< Longest time from sending the command to a valid status byte */
+}sPollStats_t;
+
+typedef struct{
+  uint32_t calls;                           /**< Requests started, including those rejected before sending */
+  uint32_t ok;                              /**< Exchanges that returned a response */
+  uint32_t failed;                          /**< Exchanges that ended with an error */
+  uint32_t errors[LARK_STATS_ERRORS];       /**< Failures by ERR_CODE_*, slot 0 counts codes above ERR_CODE_I2C_ADRESS */
+  uint32_t resets;                          /**< restData() retransmissions requested */
+  uint32_t polls;                           /**< Status bytes read */
+  uint32_t latency[LARK_STATS_BUCKETS];     /**< Exchanges by time from sending to the end, bucket i > 0 holds 2^(i+1) to 2^(i+2) - 1 ms, the last one all above */
+}sCommandStats_t;
+
 typedef struct{
     uint16_t year;
     uint16_t  month;
@@ -39,6 +227,152 @@ typedef struct{
     uint16_t  week;
   }sTime_t;
 
+#define LARK_SNAPSHOT_TEMP          0x01   ///< sWeatherSnapshot_t.temp is valid
+#define LARK_SNAPSHOT_HUMI          0x02   ///< sWeatherSnapshot_t.humidity is valid
+#define LARK_SNAPSHOT_SPEED         0x04   ///< sWeatherSnapshot_t.speed is valid
+#define LARK_SNAPSHOT_DIR           0x08   ///< sWeatherSnapshot_t.direction is valid
+#define LARK_SNAPSHOT_ALTITUDE      0x10   ///< sWeatherSnapshot_t.altitude is valid
+#define LARK_SNAPSHOT_PRESSURE      0x20   ///< sWeatherSnapshot_t.pressure is valid
+#define LARK_SNAPSHOT_TIME          0x40   ///< sWeatherSnapshot_t.time is valid
+
+typedef struct{
+  float temp;        /**< Temperature */
+  float humidity;    /**< Relative humidity */
+  float speed;       /**< Wind speed */
+  float direction;   /**< Wind direction in degrees, compass points are converted */
+  float altitude;    /**< Altitude */
+  float pressure;    /**< Atmospheric pressure */
+  sTime_t time;      /**< RTC time of the sample */
+  uint8_t valid;     /**< LARK_SNAPSHOT_* bits of the fields found in the response */
+}sWeatherSnapshot_t;
+
+#define LARK_SAMPLE_FIELDS          0x3f   ///< Every LARK_SNAPSHOT_* field a sample record can hold
+
+typedef struct{
+  uint16_t delta;      /**< Time since the previous record in LARK_SAMPLE_TICK_MS units, saturated at 0xffff */
+  int16_t temp;        /**< Temperature in 0.01 C */
+  uint16_t humidity;   /**< Relative humidity in 0.01 %RH */
+  uint16_t speed;      /**< Wind speed in 0.01 m/s */
+  uint16_t direction;  /**< Wind direction in 0.1 degree */
+  int16_t altitude;    /**< Altitude in m */
+  uint16_t pressure;   /**< Atmospheric pressure in 0.1 hPa */
+  uint8_t valid;       /**< LARK_SNAPSHOT_* bits of the fields that were requested and found */
+}__attribute__ ((packed)) sSampleRecord_t;
+
+/**
+ * @enum eSamplePolicy_t
+ * @brief What continuous acquisition does when the sample ring is full
+ */
+typedef enum{
+  eSampleOverwrite = 0, /**< Drop the oldest record */
+  eSampleBlock,         /**< Skip samples until records are drained */
+}eSamplePolicy_t;
+
+typedef struct{
+  char entry[32];              /**< Current "name:value" entry, longer entries are truncated */
+  uint8_t length;              /**< Byte number in entry */
+  sWeatherSnapshot_t *out;     /**< Decoded fields */
+}sSnapshotParser_t;
+
+#ifndef LARK_CONFIG_TOPICS
+#if defined(__AVR__)
+#define LARK_CONFIG_TOPICS          2      ///< Topics applyConfig() can manage
+#else
+#define LARK_CONFIG_TOPICS          4      ///< Topics applyConfig() can manage
+#endif
+#endif
+#define LARK_CONFIG_DTU             0      ///< sConfigShadow_t.hash index of the DTU settings
+#define LARK_CONFIG_WIFI            1      ///< sConfigShadow_t.hash index of the WiFi settings
+#define LARK_CONFIG_LORA            2      ///< sConfigShadow_t.hash index of the LoRa settings
+#define LARK_CONFIG_MQTT1           3      ///< sConfigShadow_t.hash index of the MQTT server
+#define LARK_CONFIG_MQTT2           4      ///< sConfigShadow_t.hash index of the MQTT login
+#define LARK_CONFIG_TOPIC           5      ///< sConfigShadow_t.hash index of the first topic
+#define LARK_CONFIG_ITEMS           (LARK_CONFIG_TOPIC + LARK_CONFIG_TOPICS)
+
+/**
+ * @brief Complete station configuration for applyConfig(), a NULL first field leaves that group unmanaged
+ */
+typedef struct{
+  const char *dtuSwitch;                       /**< DTU switch, "on" or "off" */
+  const char *dtuMethod;                       /**< DTU operation mode, e.g. "wifi" */
+  const char *ssid;                            /**< WiFi name */
+  const char *password;                        /**< WiFi password */
+  const char *loraDevEui;                      /**< LoRa gateway */
+  const char *loraEui;                         /**< LoRa node */
+  const char *loraKey;                         /**< LoRa key */
+  const char *mqttServer;                      /**< MQTT platform */
+  const char *mqttServerIp;                    /**< MQTT platform IP */
+  const char *mqttSave;                        /**< Whether to save transmitted data */
+  const char *iotId;                           /**< MQTT login username */
+  const char *iotPwd;                          /**< MQTT login password */
+  const char *topicName[LARK_CONFIG_TOPICS];   /**< Topic names, NULL ends the list */
+  const char *topicKey[LARK_CONFIG_TOPICS];    /**< Topic keys */
+}sStationConfig_t;
+
+typedef struct{
+  uint32_t hash[LARK_CONFIG_ITEMS];  /**< Hash of the arguments last written per LARK_CONFIG_* item, 0 when unknown */
+  uint32_t check;                    /**< Hash of hash[], detects blank or damaged storage */
+}sConfigShadow_t;
+
+/**
+ * @brief Load the persisted config shadow
+ * @return Whether shadow was filled
+ */
+typedef bool (*configLoad_t)(void *ctx, sConfigShadow_t *shadow);
+/**
+ * @brief Persist the config shadow, called after applyConfig() or a config* call changed it
+ */
+typedef void (*configStore_t)(void *ctx, const sConfigShadow_t *shadow);
+
+#define LARK_CALIBRATION_GAP_MS     100    ///< Pause between two calibration steps, other reads can be made in it
+
+/**
+ * @enum eCalibrationStep_t
+ * @brief Steps of an anemometer calibration job, in order
+ */
+typedef enum{
+  eCalibrationIdle = 0,   /**< No job started */
+  eCalibrationRadius,     /**< Setting the cup radius */
+  eCalibrationSpeed1,     /**< Measuring at standard wind speed 1 */
+  eCalibrationSpeed2,     /**< Measuring at standard wind speed 2 */
+  eCalibrationCalculate,  /**< Calculating the coefficients */
+  eCalibrationDone,       /**< Coefficients available */
+  eCalibrationError,      /**< A step failed or the job was cancelled */
+}eCalibrationStep_t;
+
+#define LARK_CALIBRATION_RADIUS     0x01   ///< sCalibration_t.radius is valid
+#define LARK_CALIBRATION_K          0x02   ///< sCalibration_t.k is valid
+#define LARK_CALIBRATION_B          0x04   ///< sCalibration_t.b is valid
+
+typedef struct{
+  float radius;   /**< Cup radius the station used */
+  float k;        /**< Slope of the wind speed correction */
+  float b;        /**< Offset of the wind speed correction */
+  uint8_t valid;  /**< LARK_CALIBRATION_* bits of the fields found in the response */
+}sCalibration_t;
+
+/**
+ * @brief Called when a calibration step finished
+ *
+ * @param ctx      Context passed to setCallbacks()
+ * @param step     Step that finished
+ * @param error    ERR_CODE_NONE or the error of the step
+ * @param progress Percentage of the job done
+ */
+typedef void (*calibrationStep_t)(void *ctx, eCalibrationStep_t step, uint8_t error, uint8_t progress);
+/**
+ * @brief Called once when the calibration job ended, after the step callback of the last step
+ *
+ * @param ctx    Context passed to setCallbacks()
+ * @param result Parsed coefficients, NULL if the job failed
+ */
+typedef void (*calibrationResult_t)(void *ctx, const sCalibration_t *result);
+
+
+/**
+ * @brief Argument type of a command with fixed arguments, defined for those commands only
+ */
+template<uint8_t cmd> struct sCommandArg;
 
 class DFRobot_LarkWeatherStation{
 public:
@@ -53,7 +387,7 @@ public:
    * @fn  ~DFRobot_RP2040_SCI
    * @brief DFRobot_RP2040_SCI Class Destructor. 
    */
-  ~DFRobot_LarkWeatherStation();
+  virtual ~DFRobot_LarkWeatherStation();
 
   /**
    * @fn begin
@@ -73,7 +407,35 @@ public:
    * @param keys Data to be obtained
    * @return String Returns the acquired data
    */
-  String getValue(char *keys);
+  String getValue(const char *keys);
+  /**
+   * @fn getValue
+   * @brief Get sensor data into a caller buffer, no heap memory is used
+   *
+   * @param keys Data to be obtained
+   * @param out  Buffer receiving the NUL terminated data
+   * @param cap  Size of the buffer, longer data is truncated
+   * @return Byte number written without the terminator, -1 if the read failed
+   */
+  int getValue(const char *keys, char *out, size_t cap);
+  /**
+   * @fn getValue
+   * @brief Get sensor data, the request packet is sent as stored in flash
+   *
+   * @param sensor Data to be obtained
+   * @return String Returns the acquired data
+   */
+  String getValue(eSensor_t sensor);
+  /**
+   * @fn getValue
+   * @brief Get sensor data into a caller buffer, the request packet is sent as stored in flash
+   *
+   * @param sensor Data to be obtained
+   * @param out    Buffer receiving the NUL terminated data
+   * @param cap    Size of the buffer, longer data is truncated
+   * @return Byte number written without the terminator, -1 if the read failed
+   */
+  int getValue(eSensor_t sensor, char *out, size_t cap);
   /**
    * @fn getUnit
    * @brief Get data unit
@@ -81,7 +443,35 @@ public:
    * @param keys Data for which units need to be obtained
    * @return String Returns the obtained units
    */
-  String getUnit(char *keys);
+  String getUnit(const char *keys);
+  /**
+   * @fn getUnit
+   * @brief Get data unit into a caller buffer, no heap memory is used
+   *
+   * @param keys Data for which units need to be obtained
+   * @param out  Buffer receiving the NUL terminated unit
+   * @param cap  Size of the buffer, longer data is truncated
+   * @return Byte number written without the terminator, -1 if the read failed
+   */
+  int getUnit(const char *keys, char *out, size_t cap);
+  /**
+   * @fn getUnit
+   * @brief Get data unit, the request packet is sent as stored in flash
+   *
+   * @param sensor Data for which units need to be obtained
+   * @return String Returns the obtained units
+   */
+  String getUnit(eSensor_t sensor);
+  /**
+   * @fn getUnit
+   * @brief Get data unit into a caller buffer, the request packet is sent as stored in flash
+   *
+   * @param sensor Data for which units need to be obtained
+   * @param out    Buffer receiving the NUL terminated unit
+   * @param cap    Size of the buffer, longer data is truncated
+   * @return Byte number written without the terminator, -1 if the read failed
+   */
+  int getUnit(eSensor_t sensor, char *out, size_t cap);
   /**
    * @fn getInformation
    * @brief Get all data
@@ -90,6 +480,163 @@ public:
    * @return String Returns all the acquired data
    */
   String getInformation(bool state);
+  /**
+   * @fn getInformation
+   * @brief Get all data into a caller buffer, no heap memory is used
+   *
+   * @param state true: include timestamp, false: do not include timestamp
+   * @param out   Buffer receiving the NUL terminated data
+   * @param cap   Size of the buffer, longer data is truncated
+   * @return Byte number written without the terminator, -1 if the read failed
+   */
+  int getInformation(bool state, char *out, size_t cap);
+  /**
+   * @fn getValues
+   * @brief Get several sensor data in one exchange
+   * @n     The fields are taken from one CMD_GET_ALL_DATA response, keys missing there are read one by one
+   *
+   * @param keys   Data to be obtained
+   * @param n      Number of keys
+   * @param values Returns the acquired data, an empty string for keys that could not be read
+   * @return Number of keys that were read
+   */
+  uint8_t getValues(const char* const keys[], uint8_t n, String values[]);
+  /**
+   * @fn getValues
+   * @brief Get several sensor data in one exchange into caller buffers, no heap memory is used
+   *
+   * @param keys   Data to be obtained
+   * @param n      Number of keys
+   * @param values Buffers receiving the NUL terminated data, an empty string for keys that could not be read
+   * @param cap    Size of each buffer
+   * @return Number of keys that were read
+   */
+  uint8_t getValues(const char* const keys[], uint8_t n, char *values[], size_t cap);
+  /**
+   * @fn getSnapshot
+   * @brief Get all data decoded into numbers
+   * @n     The response is parsed field by field while it is received, so its length is not limited by the packet buffer
+   *
+   * @param snapshot Returns the decoded data, check snapshot.valid for the fields that were found
+   * @param state    true: include timestamp, false: do not include timestamp
+   * @return Whether the exchange succeeded
+   */
+  bool getSnapshot(sWeatherSnapshot_t &snapshot, bool state = true);
+  /**
+   * @fn startContinuous
+   * @brief Sample all data at a fixed period into the sample ring, driven by runContinuous()
+   * @n     While a sample is being read other commands fail with lastError() unchanged, call them between samples
+   *
+   * @param periodMs Time between two samples
+   * @param fields   LARK_SNAPSHOT_* bits of the fields to keep, the others are stored as 0
+   * @param policy   eSampleOverwrite or eSampleBlock
+   * @return Whether acquisition started, false if the period is 0
+   */
+  bool startContinuous(uint32_t periodMs, uint8_t fields = LARK_SAMPLE_FIELDS, eSamplePolicy_t policy = eSampleOverwrite);
+  /**
+   * @fn stopContinuous
+   * @brief Stop continuous acquisition, an unfinished sample is abandoned and recorded records are kept
+   */
+  void stopContinuous(void);
+  /**
+   * @fn runContinuous
+   * @brief Advance continuous acquisition, call it from loop(), returns immediately
+   *
+   * @return Whether a record was added to the sample ring
+   */
+  bool runContinuous(void);
+  /**
+   * @fn drain
+   * @brief Move the oldest records out of the sample ring
+   *
+   * @param dst   Buffer receiving the records
+   * @param max   Size of dst in records
+   * @param stamp Returns millis() of the first record returned, may be NULL
+   * @return Number of records copied
+   */
+  uint16_t drain(sSampleRecord_t *dst, uint16_t max, uint32_t *stamp = NULL);
+  /**
+   * @fn samplesAvailable
+   * @brief Number of records waiting in the sample ring
+   */
+  uint16_t samplesAvailable(void);
+  /**
+   * @fn getSampleStats
+   * @brief Get the continuous acquisition loss counters
+   *
+   * @param dropped Returns records overwritten or samples skipped because the ring was full, may be NULL
+   * @param failed  Returns samples whose exchange failed, may be NULL
+   */
+  void getSampleStats(uint32_t *dropped, uint32_t *failed);
+  /**
+   * @fn setMaxAge
+   * @brief Set how long a value read from the device is reused by getValue()/getValues()
+   * @n     Units are always cached for the whole session
+   *
+   * @param key      Data name, NULL sets the default for keys without their own setting
+   * @param maxAgeMs Time in ms a value stays valid, 0 always reads from the device
+   * @return Whether the setting was stored, false if the cache is full
+   */
+  bool setMaxAge(const char *key, uint32_t maxAgeMs);
+  /**
+   * @fn clearCache
+   * @brief Drop every cached value and unit, the max-age settings are kept
+   */
+  void clearCache(void);
+  /**
+   * @fn getCacheStats
+   * @brief Get the cache hit and miss counters
+   *
+   * @param hits   Returns reads answered from the cache, may be NULL
+   * @param misses Returns reads that went to the device, may be NULL
+   */
+  void getCacheStats(uint32_t *hits, uint32_t *misses);
+  /**
+   * @fn setLatencyHint
+   * @brief Set how long a command is expected to take before its first status poll
+   * @n     Polls then back off from LARK_POLL_MIN_MS to LARK_POLL_MAX_MS until the device is ready
+   *
+   * @param cmd Command, CMD_GET_DATA to CMD_END
+   * @param ms  Expected processing time in ms
+   * @return Whether the command is valid
+   */
+  bool setLatencyHint(uint8_t cmd, uint16_t ms);
+  /**
+   * @fn getLatencyHint
+   * @brief Get the expected processing time of a command
+   *
+   * @param cmd Command
+   * @return Time in ms, 0 for an invalid command
+   */
+  uint16_t getLatencyHint(uint8_t cmd);
+  /**
+   * @fn getPollStats
+   * @brief Get how many status polls the exchanges of a command needed
+   *
+   * @param cmd   Command
+   * @param stats Returns the counters
+   * @return Whether counters are available, false for an invalid command or when LARK_POLL_STATS is 0
+   */
+  bool getPollStats(uint8_t cmd, sPollStats_t *stats);
+  /**
+   * @fn clearPollStats
+   * @brief Reset the poll statistics of every command
+   */
+  void clearPollStats(void);
+  /**
+   * @fn getStats
+   * @brief Get the call counts, failures by error code and latency histogram of a command
+   *
+   * @param cmd   Command
+   * @param stats Returns the statistics
+   * @return Whether statistics are available, false for an invalid command or when LARK_COMMAND_STATS is 0
+   */
+  bool getStats(uint8_t cmd, sCommandStats_t *stats);
+  /**
+   * @fn clearStats
+   * @brief Reset the statistics of every command
+   */
+  void clearStats(void);
   /**
    * @fn setTime
    * @brief Set RTC time
@@ -110,6 +657,47 @@ public:
   * @return Returns the acquired RTC time
   */
   String getTimeStamp(void);
+ /**
+  * @fn getTimeStamp
+  * @brief Get RTC time into a caller buffer, no heap memory is used
+  *
+  * @param out Buffer receiving the NUL terminated time
+  * @param cap Size of the buffer
+  * @return Byte number written without the terminator, -1 if the read failed
+  */
+  int getTimeStamp(char *out, size_t cap);
+ /**
+  * @fn getTime
+  * @brief Get RTC time decoded into its fields, no String is built
+  *
+  * @param time Returns the time, week is the day of the week with 0 for Sunday
+  * @return Whether a valid time was read
+  */
+  bool getTime(sTime_t &time);
+ /**
+  * @fn getEpoch
+  * @brief Get RTC time as seconds since 1970-01-01
+  *
+  * @param epoch Returns the seconds
+  * @return Whether a valid time was read
+  */
+  bool getEpoch(uint32_t *epoch);
+ /**
+  * @fn setEpoch
+  * @brief Set RTC time from seconds since 1970-01-01, the station takes it when the command arrives
+  * @return Returns the set status
+  */
+  uint8_t setEpoch(uint32_t epoch);
+ /**
+  * @fn timeToEpoch
+  * @brief Seconds since 1970-01-01 of a time from 2000 on, week is ignored
+  */
+  static uint32_t timeToEpoch(const sTime_t &time);
+ /**
+  * @fn epochToTime
+  * @brief Fields of seconds since 1970-01-01, including the day of the week
+  */
+  static void epochToTime(uint32_t epoch, sTime_t &time);
   /**
    * @fn setRadius
    * @brief Set the radius of the anemometer cup.
@@ -188,23 +776,88 @@ public:
    * @param chan Key
    */
   uint8_t configTopic(char* name, char* chan);
+  /**
+   * @fn applyConfig
+   * @brief Bring the station to a complete configuration, only the commands whose arguments changed are sent
+   * @n     The arguments last written are remembered as hashes in a shadow that setConfigStore() can persist,
+   * @n     so a node applying the same configuration at every boot sends nothing
+   *
+   * @param config Configuration
+   * @return Number of commands sent, -1 if one failed, see lastError(), the successful ones are remembered
+   */
+  int applyConfig(const sStationConfig_t &config);
+  /**
+   * @fn setConfigStore
+   * @brief Persist the config shadow through user callbacks, e.g. to EEPROM, load is called at once
+   *
+   * @param load  Reads the shadow, may be NULL
+   * @param store Writes the shadow, may be NULL
+   * @param ctx   Passed to the callbacks
+   */
+  void setConfigStore(configLoad_t load, configStore_t store, void *ctx);
+  /**
+   * @fn clearConfigShadow
+   * @brief Forget what was written, the next applyConfig() sends every command, e.g. after a factory reset
+   */
+  void clearConfigShadow(void);
 
 
   void projectMode(void);
 
+  /**
+   * @fn startRequest
+   * @brief Start a non-blocking command exchange, it is driven by poll()
+   *
+   * @param cmd     Command
+   * @param args    Command arguments, copied before returning
+   * @param len     Byte number of the arguments
+   * @param delayMs Time before the first status poll, LARK_LATENCY_AUTO uses the latency hint of the command
+   * @return Start status
+   * @n      true   Request started
+   * @n      false  Another request is in progress or memory is insufficient
+   */
+  bool startRequest(uint8_t cmd, const void *args = NULL, uint16_t len = 0, uint32_t delayMs = LARK_LATENCY_AUTO);
+  /**
+   * @fn poll
+   * @brief Advance the current request through send/wait/header/body states, returns immediately
+   *
+   * @return eRequestStatus_t Status of the current request
+   */
+  eRequestStatus_t poll(void);
+  /**
+   * @fn response
+   * @brief Get the payload of the finished request
+   *
+   * @param length Byte number of the payload, may be NULL
+   * @return NUL terminated payload, valid until the next startRequest()
+   * @n      NULL  No successful response is available
+   */
+  const uint8_t *response(uint16_t *length);
+  /**
+   * @fn endRequest
+   * @brief Abandon the current request and return to idle
+   */
+  void endRequest(void);
+  /**
+   * @fn lastError
+   * @brief Get the error code of the last request
+   *
+   * @return ERR_CODE_NONE or one of the ERR_CODE_* values
+   */
+  uint8_t lastError(void);
+  /**
+   * @fn pollDelay
+   * @brief Time until poll() has time driven work, for event loops that wait on the interface
+   * @n     Until then only received bytes can advance the request
+   *
+   * @return Time in ms, 0 when poll() should be called now
+   */
+  uint32_t pollDelay(void);
+
 protected:
-  // uint32_t getRefreshRate_ms(uint8_t rate);
-  // /**
-  //  * @fn recvPacket
-  //  * @brief Receive and parse the response data packet
-  //  * 
-  //  * @param cmd       Command to receive packet
-  //  * @param errorCode Receive error code
-  //  * @return Pointer array
-  //  * @n      NULL    indicates receiving packet failed
-  //  * @n      Non-NULL  response packet pointer
-  //  */
-  void *recvPacket(uint8_t cmd, uint8_t *errorCode);
+  friend class DFRobot_LarkWeatherStation_Capture; ///< Forwards the transport calls of the station it records
+  typedef void (*bodySink_t)(void *ctx, const uint8_t *data, uint16_t length);
+
   /**
    * @fn init
    * @brief Pure virtual function, interface init
@@ -246,15 +899,245 @@ protected:
    * @brief Clear send cache
    */
   virtual void sendFlush() = 0;
-
-  
+  /**
+   * @fn recvAvailable
+   * @brief Byte number that can be read without blocking
+   * @n     Polled interfaces always answer, the device returns 0xff when it is not ready
+   *
+   * @return Readable byte number
+   */
+  virtual int recvAvailable(void){ return 0x7fff; }
 
   void restData(void);
 
+  /**
+   * @fn execute
+   * @brief Blocking command exchange built on startRequest() and poll()
+   *
+   * @param cmd     Command
+   * @param args    Command arguments
+   * @param len     Byte number of the arguments
+   * @return Response packet in the class packet buffer, NULL if the exchange failed
+   */
+  pCmdRecvPkt_t execute(uint8_t cmd, const void *args, uint16_t len);
+  /**
+   * @fn execute
+   * @brief Blocking exchange of a constant request packet in flash
+   */
+  pCmdRecvPkt_t execute(const sSensorPacket_t *packet);
+  /**
+   * @fn executeString
+   * @brief Blocking command exchange returning the payload as a string
+   */
+  String executeString(uint8_t cmd, const void *args, uint16_t len);
+  /**
+   * @fn executeStatus
+   * @brief Blocking command exchange returning 1 on success and 0 on failure
+   */
+  uint8_t executeStatus(uint8_t cmd, const void *args, uint16_t len);
+  /**
+   * @fn executeValue
+   * @brief Encode the typed argument of cmd and run it, returns 0 without sending when the value is out of range.
+   * @n    Commands without a sCommandArg type do not compile.
+   */
+  template<uint8_t cmd> uint8_t executeValue(const typename sCommandArg<cmd>::type &value);
+  /**
+   * @fn executeArgs
+   * @brief Encoding and exchange of executeValue(), one copy per argument type
+   */
+  template<typename T> uint8_t executeArgs(uint8_t cmd, const T &value);
+  /**
+   * @fn executeText
+   * @brief Blocking command exchange copying the payload into a caller buffer
+   * @return Byte number written without the terminator, -1 if the exchange failed
+   */
+  int executeText(uint8_t cmd, const void *args, uint16_t len, char *out, size_t cap);
+  /**
+   * @fn setBodySink
+   * @brief Hand the payload of the next successful responses to sink while it is received instead of buffering it
+   *
+   * @param sink Called with each received chunk, NULL buffers the payload again
+   * @param ctx  Passed to sink
+   */
+  void setBodySink(bodySink_t sink, void *ctx);
+
 private:
+  /**
+   * @enum eRequestState_t
+   * @brief Internal states of the request state machine
+   */
+  typedef enum{
+    eStateIdle = 0,
+    eStateSend,
+    eStateWait,
+    eStateStatus,
+    eStateBody,
+    eStateDone,
+    eStateError,
+  }eRequestState_t;
+
+  eRequestStatus_t failRequest(uint8_t errorCode);
+  eRequestStatus_t finishRequest(void);
+  bool scanHeader(void);
+  eRequestStatus_t resync(void);
+  eRequestStatus_t recvStalled(void);
+  void recordPolls(void);
+  typedef void (*fieldSink_t)(void *ctx, uint8_t index, const char *value, uint16_t length);
+
+  uint8_t fetchValues(const char* const keys[], uint8_t n, fieldSink_t sink, void *ctx);
+  sCacheEntry_t *cacheFind(const char *key, bool create);
+  const char *cacheValue(const char *key);
+  bool prepareRequest(uint8_t cmd, uint16_t len, uint32_t delayMs);
+  bool startPacket(const sSensorPacket_t *packet);
+  pCmdRecvPkt_t waitRequest(void);
+  String valueString(const char *key, const sSensorPacket_t *packet);
+  int valueText(const char *key, const sSensorPacket_t *packet, char *out, size_t cap);
+  String unitString(const char *key, const sSensorPacket_t *packet);
+  int unitText(const char *key, const sSensorPacket_t *packet, char *out, size_t cap);
+  const char *readValue(const char *key, uint16_t *length, const sSensorPacket_t *packet = NULL);
+  const char *readUnit(const char *key, uint16_t *length, const sSensorPacket_t *packet = NULL);
+  void cacheStore(const char *key, const char *value, uint16_t length);
+  int configArgs(char sep, const char *a, const char *b, const char *c = NULL);
+  uint8_t sendConfig(uint8_t item, uint8_t cmd, int len);
+  void configChanged(void);
+  void samplePush(uint32_t stamp);
+  void sampleShift(void);
+
   uint32_t _timeout; ///< Time of receive timeout
+  uint8_t _reqState;        ///< eRequestState_t of the current request
+  uint8_t _reqCmd;          ///< Command of the current request
+  uint8_t _reqError;        ///< Error code of the last request
+  uint32_t _reqDelay;       ///< Time before the first status poll of the current command
+  uint32_t _reqLimit;       ///< Time after sending until the current command times out
+  uint32_t _reqTick;        ///< Time the current command was sent
+  uint32_t _pollTick;       ///< Time of the last status poll or stalled read
+  uint32_t _pollGap;        ///< Time to wait before the next status poll or read
+  uint16_t _reqPolls;       ///< Status reads of the current command
+  uint16_t _reqResets;      ///< Retransmissions requested by the current command
+  uint16_t _reqSkipped;     ///< Noise bytes discarded by the current command
+  uint16_t _scanSkipped;    ///< Noise bytes discarded since the last retransmission
+  uint8_t _hdrLen;          ///< Candidate header bytes at the start of _pktBuf
+  uint8_t _reqSpeculate;    ///< Payload bytes read with the header on a polled interface, 0 for status replies
+  bool _reqMismatch;        ///< A well formed header of another command was seen
+  uint16_t _reqReadyMs;     ///< Time from sending to a valid status byte
+  uint16_t _latencyHint[CMD_END + 1]; ///< Expected processing time of each command
+#if LARK_POLL_STATS
+  sPollStats_t _pollStats[CMD_END + 1]; ///< Poll statistics of each command
+#endif
+#if LARK_COMMAND_STATS
+  sCommandStats_t _stats[CMD_END + 1];  ///< Call statistics of each command
+#endif
+  uint16_t _rspRecv;        ///< Received payload byte number
+  uint16_t _sendLen;        ///< Byte number of the request packet
+  const uint8_t *_sendPkt;  ///< Request packet, _pktBuf or a constant packet in flash
+  bodySink_t _bodySink;     ///< Consumer of streamed payloads, NULL to buffer them
+  void *_bodyCtx;           ///< Context of _bodySink
+  uint8_t _pktBuf[sizeof(sCmdRecvPkt_t) + LARK_PAYLOAD_MAX_LEN + 1]; ///< Request packet, then response packet with a terminator
+  sCacheEntry_t _cache[LARK_CACHE_SIZE]; ///< Value and unit cache
+  uint32_t _cacheMaxAge;    ///< Default value max-age of new cache entries
+  uint32_t _cacheHits;      ///< Reads answered from the cache
+  uint32_t _cacheMisses;    ///< Reads that went to the device
+  uint32_t _samplePeriod;   ///< Continuous acquisition period, 0 when stopped
+  uint32_t _sampleTick;     ///< Time the next sample is due
+  uint32_t _sampleStart;    ///< Time the current sample was started
+  uint32_t _sampleLast;     ///< Time of the newest record, origin of its successor's delta
+  uint32_t _sampleStamp;    ///< Time of the oldest record in the ring
+  uint32_t _sampleDropped;  ///< Records lost to a full ring
+  uint32_t _sampleFailed;   ///< Samples whose exchange failed
+  uint8_t _sampleFields;    ///< LARK_SNAPSHOT_* bits kept in the records
+  uint8_t _samplePolicy;    ///< eSamplePolicy_t
+  bool _sampleBusy;         ///< A sample exchange is in progress
+  sWeatherSnapshot_t _sample;          ///< Decoded fields of the current sample
+  sSnapshotParser_t _sampleParser;     ///< Parser of the current sample
+  sConfigShadow_t _config;  ///< Hashes of the configuration written to the station
+  configStore_t _configStore; ///< Persists _config, may be NULL
+  void *_configCtx;         ///< Context of _configStore
+  uint16_t _ringHead;       ///< Index of the oldest record
+  uint16_t _ringCount;      ///< Records in the ring
+  sSampleRecord_t _ring[LARK_SAMPLE_RING_SIZE]; ///< Sample ring
 };
 
+/**
+ * @brief Non-blocking anemometer calibration, sequences radius, speed 1, speed 2 and the calculation
+ * @n     The job only uses the request slot of the station while a step is in progress, blocking reads
+ * @n     and continuous acquisition can run between the steps, whenever busy() is false
+ */
+class DFRobot_LarkWeatherStation_Calibration{
+public:
+  DFRobot_LarkWeatherStation_Calibration(DFRobot_LarkWeatherStation *station);
+  /**
+   * @fn setCallbacks
+   * @brief Set the callbacks reporting the steps and the result
+   *
+   * @param step   Called after every step, may be NULL
+   * @param result Called when the job ended, may be NULL
+   * @param ctx    Passed to the callbacks
+   */
+  void setCallbacks(calibrationStep_t step, calibrationResult_t result, void *ctx);
+  /**
+   * @fn begin
+   * @brief Start a calibration job, it is driven by run()
+   *
+   * @param radius Cup radius
+   * @param speed1 Standard wind speed 1
+   * @param speed2 Standard wind speed 2
+   * @return Whether the job started, false if one is running or an argument is out of range
+   */
+  bool begin(float radius, float speed1, float speed2);
+  /**
+   * @fn run
+   * @brief Advance the job, returns immediately, call it from loop()
+   * @return Whether the job ended during this call
+   */
+  bool run(void);
+  /**
+   * @fn cancel
+   * @brief Abort the job, the step in progress is dropped
+   */
+  void cancel(void);
+  /**
+   * @fn busy
+   * @brief Whether a step holds the request slot of the station
+   */
+  bool busy(void);
+  /**
+   * @fn step
+   * @brief Current step, eCalibrationDone or eCalibrationError once the job ended
+   */
+  eCalibrationStep_t step(void);
+  /**
+   * @fn progress
+   * @brief Percentage of the job done, estimated from the latency hints of the steps
+   */
+  uint8_t progress(void);
+  /**
+   * @fn getResult
+   * @brief Get the coefficients of the finished job
+   * @return Whether the job is done
+   */
+  bool getResult(sCalibration_t *result);
+  /**
+   * @fn lastError
+   * @brief Error of the failed step, ERR_CODE_NONE otherwise
+   */
+  uint8_t lastError(void);
+private:
+  void finishStep(eRequestStatus_t status);
+
+  DFRobot_LarkWeatherStation *_station;
+  calibrationStep_t _stepCb;     ///< Step callback, may be NULL
+  calibrationResult_t _resultCb; ///< Result callback, may be NULL
+  void *_ctx;                    ///< Context of the callbacks
+  float _value[3];               ///< Radius, speed 1 and speed 2
+  sCalibration_t _result;        ///< Parsed coefficients
+  uint32_t _tick;                ///< Time the current step started or the next one may start
+  uint8_t _step;                 ///< eCalibrationStep_t
+  uint8_t _finished;             ///< Steps that finished successfully
+  uint8_t _error;                ///< Error of the failed step
+  bool _busy;                    ///< The current step holds the request slot
+};
+
+#if defined(ARDUINO)
 class DFRobot_LarkWeatherStation_I2C:public DFRobot_LarkWeatherStation {
 
 
@@ -357,9 +1240,18 @@ protected:
    * @brief Clear send cache
    */
   void sendFlush();
+  /**
+   * @fn recvAvailable
+   * @brief Byte number waiting in the serial receive buffer
+   */
+  int recvAvailable(void);
 private:
   uint8_t state = 0;
   Stream *_s;
 };
 
+#else
+#include "linux/DFRobot_LarkWeatherStation_Linux.h"
+#endif
+
 #endif
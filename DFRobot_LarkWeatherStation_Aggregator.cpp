@@ -0,0 +1,199 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Aggregator.cpp
+ * @brief Sliding window min/max/mean/stddev of station samples, updated in O(1) per sample
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation_Aggregator.h"
+#include <math.h>
+
+/** Divisor from the sSampleRecord_t fixed point fields to sWeatherSnapshot_t units */
+static const float fieldScale[LARK_WINDOW_FIELDS] = {100, 100, 100, 10, 1, 10};
+
+static int32_t recordValue(const sSampleRecord_t &record, uint8_t i)
+{
+  switch(i){
+    case 0: return record.temp;
+    case 1: return record.humidity;
+    case 2: return record.speed;
+    case 3: return record.direction;
+    case 4: return record.altitude;
+    default: return record.pressure;
+  }
+}
+
+/**
+ * @fn compAdd
+ * @brief Neumaier summation, keeps the rounding error of every addition so removing old buckets does not drift
+ */
+static void compAdd(sCompSum_t *s, double value)
+{
+  double t = s->sum + value;
+  if(fabs(s->sum) >= fabs(value)){
+    s->comp += (s->sum - t) + value;
+  }else{
+    s->comp += (value - t) + s->sum;
+  }
+  s->sum = t;
+}
+
+static void clearField(sWindowField_t *field)
+{
+  memset(field, 0, sizeof(sWindowField_t));
+}
+
+DFRobot_LarkWeatherStation_Aggregator::DFRobot_LarkWeatherStation_Aggregator()
+  :_windows(0)
+{
+  clear();
+}
+
+int DFRobot_LarkWeatherStation_Aggregator::addWindow(uint32_t spanMs)
+{
+  sWindow_t *window;
+  if((_windows >= LARK_WINDOW_MAX) || (spanMs < LARK_WINDOW_BUCKETS)) return -1;
+  window = &_window[_windows];
+  window->span = spanMs;
+  window->bucketMs = spanMs / LARK_WINDOW_BUCKETS;
+  reset(window);
+  return _windows++;
+}
+
+void DFRobot_LarkWeatherStation_Aggregator::clear(void)
+{
+  for(uint8_t i = 0; i < _windows; i++) reset(&_window[i]);
+  memset(_offset, 0, sizeof(_offset));
+  _offsetSet = 0;
+}
+
+void DFRobot_LarkWeatherStation_Aggregator::reset(sWindow_t *window)
+{
+  window->newest = 0;
+  window->slot = 0;
+  window->started = false;
+  for(uint8_t i = 0; i < LARK_WINDOW_FIELDS; i++) clearField(&window->field[i]);
+}
+
+void DFRobot_LarkWeatherStation_Aggregator::evict(sWindowField_t *field, uint8_t slot)
+{
+  sWindowBucket_t *bucket = &field->bucket[slot];
+  if(bucket->count == 0) return;
+  //The leaving bucket is the oldest one, it can only be at the front of the queues
+  if(field->minCount && (field->minQueue[field->minHead] == slot)){
+    field->minHead = (field->minHead + 1) % LARK_WINDOW_BUCKETS;
+    field->minCount--;
+  }
+  if(field->maxCount && (field->maxQueue[field->maxHead] == slot)){
+    field->maxHead = (field->maxHead + 1) % LARK_WINDOW_BUCKETS;
+    field->maxCount--;
+  }
+  field->count -= bucket->count;
+  if(field->count == 0){
+    //Start over from exact zeros instead of the residue of the subtractions
+    memset(&field->sum, 0, sizeof(sCompSum_t));
+    memset(&field->sumSq, 0, sizeof(sCompSum_t));
+  }else{
+    compAdd(&field->sum, -bucket->sum);
+    compAdd(&field->sumSq, -bucket->sumSq);
+  }
+  memset(bucket, 0, sizeof(sWindowBucket_t));
+}
+
+void DFRobot_LarkWeatherStation_Aggregator::advance(sWindow_t *window, uint32_t steps)
+{
+  uint32_t newest = window->newest + steps * window->bucketMs;
+  if(steps >= LARK_WINDOW_BUCKETS){
+    //Every bucket left the window
+    reset(window);
+    window->started = true;
+    window->newest = newest;
+    return;
+  }
+  window->newest = newest;
+  while(steps--){
+    window->slot = (window->slot + 1) % LARK_WINDOW_BUCKETS;
+    for(uint8_t i = 0; i < LARK_WINDOW_FIELDS; i++) evict(&window->field[i], window->slot);
+  }
+}
+
+void DFRobot_LarkWeatherStation_Aggregator::insert(sWindowField_t *field, uint8_t slot, int32_t value, double shifted)
+{
+  sWindowBucket_t *bucket = &field->bucket[slot];
+  uint8_t back;
+  if((bucket->count == 0) || (value < bucket->min)) bucket->min = value;
+  if((bucket->count == 0) || (value > bucket->max)) bucket->max = value;
+  bucket->count++;
+  bucket->sum += shifted;
+  bucket->sumSq += shifted * shifted;
+  field->count++;
+  compAdd(&field->sum, shifted);
+  compAdd(&field->sumSq, shifted * shifted);
+  //Older buckets that can no longer be the extreme leave the back of the queues, the current one is the newest
+  while(field->minCount){
+    back = field->minQueue[(field->minHead + field->minCount - 1) % LARK_WINDOW_BUCKETS];
+    if(field->bucket[back].min < bucket->min) break;
+    field->minCount--;
+  }
+  field->minQueue[(field->minHead + field->minCount++) % LARK_WINDOW_BUCKETS] = slot;
+  while(field->maxCount){
+    back = field->maxQueue[(field->maxHead + field->maxCount - 1) % LARK_WINDOW_BUCKETS];
+    if(field->bucket[back].max > bucket->max) break;
+    field->maxCount--;
+  }
+  field->maxQueue[(field->maxHead + field->maxCount++) % LARK_WINDOW_BUCKETS] = slot;
+}
+
+void DFRobot_LarkWeatherStation_Aggregator::add(uint32_t stamp, const sSampleRecord_t &record)
+{
+  for(uint8_t i = 0; i < LARK_WINDOW_FIELDS; i++){
+    if((record.valid & (1 << i)) && !(_offsetSet & (1 << i))){
+      _offset[i] = recordValue(record, i);
+      _offsetSet |= 1 << i;
+    }
+  }
+  for(uint8_t w = 0; w < _windows; w++){
+    sWindow_t *window = &_window[w];
+    uint32_t elapsed = stamp - window->newest;
+    if(!window->started){
+      window->started = true;
+      window->newest = stamp;
+    }else if((int32_t)elapsed < 0){
+      continue;
+    }else if(elapsed >= window->bucketMs){
+      advance(window, elapsed / window->bucketMs);
+    }
+    for(uint8_t i = 0; i < LARK_WINDOW_FIELDS; i++){
+      int32_t value;
+      if(!(record.valid & (1 << i))) continue;
+      value = recordValue(record, i);
+      insert(&window->field[i], window->slot, value, (double)(value - _offset[i]));
+    }
+  }
+}
+
+bool DFRobot_LarkWeatherStation_Aggregator::get(uint8_t window, uint8_t field, sWindowStat_t *stat)
+{
+  sWindowField_t *f;
+  double sum, variance;
+  uint8_t i = 0;
+  if((window >= _windows) || (field == 0) || (stat == NULL)) return false;
+  while((i < LARK_WINDOW_FIELDS) && (field != (1 << i))) i++;
+  if(i == LARK_WINDOW_FIELDS) return false;
+  f = &_window[window].field[i];
+  if(f->count == 0) return false;
+  sum = f->sum.sum + f->sum.comp;
+  stat->count = f->count;
+  stat->min = f->bucket[f->minQueue[f->minHead]].min / fieldScale[i];
+  stat->max = f->bucket[f->maxQueue[f->maxHead]].max / fieldScale[i];
+  stat->mean = (_offset[i] + sum / f->count) / fieldScale[i];
+  stat->stddev = 0;
+  if(f->count > 1){
+    variance = ((f->sumSq.sum + f->sumSq.comp) - sum * sum / f->count) / (f->count - 1);
+    if(variance > 0) stat->stddev = sqrt(variance) / fieldScale[i];
+  }
+  return true;
+}
@@ -0,0 +1,130 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Aggregator.h
+ * @brief Sliding window min/max/mean/stddev of station samples, updated in O(1) per sample
+ * @n     Every window is split into LARK_WINDOW_BUCKETS buckets of span / LARK_WINDOW_BUCKETS ms. A bucket keeps
+ * @n     the min, max and sums of its samples; monotonic deques of the bucket minima and maxima give the window
+ * @n     extremes, compensated running sums give the mean and variance. The window slides one bucket at a time
+ * @n     and its memory is fixed, whatever the sample rate.
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#ifndef _DFROBOT_LARKWEATHERSTATION_AGGREGATOR_H_
+#define _DFROBOT_LARKWEATHERSTATION_AGGREGATOR_H_
+
+#include "DFRobot_LarkWeatherStation.h"
+
+#ifndef LARK_WINDOW_MAX
+#if defined(__AVR__)
+#define LARK_WINDOW_MAX             1      ///< Windows one aggregator can keep
+#else
+#define LARK_WINDOW_MAX             4      ///< Windows one aggregator can keep
+#endif
+#endif
+#ifndef LARK_WINDOW_BUCKETS
+#if defined(__AVR__)
+#define LARK_WINDOW_BUCKETS         6      ///< Buckets of a window, at most 255
+#else
+#define LARK_WINDOW_BUCKETS         60     ///< Buckets of a window, at most 255
+#endif
+#endif
+#define LARK_WINDOW_FIELDS          6      ///< Aggregated fields of sSampleRecord_t, in LARK_SNAPSHOT_* bit order
+
+typedef struct{
+  double sum;   /**< Running sum */
+  double comp;  /**< Low order bits lost by sum */
+}sCompSum_t;
+
+typedef struct{
+  int32_t min;      /**< Smallest sample */
+  int32_t max;      /**< Largest sample */
+  double sum;       /**< Sum of the samples minus the field offset */
+  double sumSq;     /**< Sum of their squares */
+  uint16_t count;   /**< Samples in the bucket */
+}sWindowBucket_t;
+
+typedef struct{
+  sWindowBucket_t bucket[LARK_WINDOW_BUCKETS];
+  uint8_t minQueue[LARK_WINDOW_BUCKETS];  /**< Buckets with increasing minima, oldest first */
+  uint8_t maxQueue[LARK_WINDOW_BUCKETS];  /**< Buckets with decreasing maxima, oldest first */
+  uint8_t minHead, minCount;
+  uint8_t maxHead, maxCount;
+  uint32_t count;                         /**< Samples in the window */
+  sCompSum_t sum;                         /**< Sum of the samples minus the field offset */
+  sCompSum_t sumSq;                       /**< Sum of their squares */
+}sWindowField_t;
+
+/**
+ * @brief Buckets follow each other from the first sample on, so their bounds are differences of stamps and stay
+ * @n     right when millis() wraps
+ */
+typedef struct{
+  uint32_t span;        /**< Window length in ms */
+  uint32_t bucketMs;    /**< Bucket length in ms */
+  uint32_t newest;      /**< Start time of the newest bucket */
+  uint8_t slot;         /**< Slot of the newest bucket */
+  bool started;         /**< A sample was added */
+  sWindowField_t field[LARK_WINDOW_FIELDS];
+}sWindow_t;
+
+/**
+ * @brief Aggregates of one field over one window, in the units of sWeatherSnapshot_t
+ */
+typedef struct{
+  float min;
+  float max;
+  float mean;
+  float stddev;     /**< Sample standard deviation, 0 below two samples */
+  uint32_t count;   /**< Samples in the window */
+}sWindowStat_t;
+
+class DFRobot_LarkWeatherStation_Aggregator{
+public:
+  DFRobot_LarkWeatherStation_Aggregator();
+  /**
+   * @fn addWindow
+   * @brief Aggregate over the last spanMs, e.g. 60000, 600000 and 3600000
+   *
+   * @param spanMs Window length, at least LARK_WINDOW_BUCKETS ms
+   * @return Window number, -1 if LARK_WINDOW_MAX windows exist or spanMs is too short
+   */
+  int addWindow(uint32_t spanMs);
+  /**
+   * @fn add
+   * @brief Add a sample to every window
+   *
+   * @param stamp  millis() of the sample, it may wrap; samples older than the newest bucket of a window are ignored by it
+   * @param record Sample, fields missing in record.valid are skipped
+   */
+  void add(uint32_t stamp, const sSampleRecord_t &record);
+  /**
+   * @fn get
+   * @brief Get the aggregates as of the newest sample
+   *
+   * @param window Window number from addWindow()
+   * @param field  One LARK_SNAPSHOT_* field bit, LARK_SNAPSHOT_TEMP to LARK_SNAPSHOT_PRESSURE
+   * @param stat   Returns the aggregates
+   * @return Whether the window holds samples of the field
+   */
+  bool get(uint8_t window, uint8_t field, sWindowStat_t *stat);
+  /**
+   * @fn clear
+   * @brief Drop every sample, the windows are kept
+   */
+  void clear(void);
+private:
+  void advance(sWindow_t *window, uint32_t steps);
+  void evict(sWindowField_t *field, uint8_t slot);
+  void insert(sWindowField_t *field, uint8_t slot, int32_t value, double shifted);
+  void reset(sWindow_t *window);
+
+  sWindow_t _window[LARK_WINDOW_MAX];
+  uint8_t _windows;                       ///< Windows in use
+  int32_t _offset[LARK_WINDOW_FIELDS];    ///< First value of each field, subtracted before summing
+  uint8_t _offsetSet;                     ///< LARK_SNAPSHOT_* bits of the fields with an offset
+};
+
+#endif
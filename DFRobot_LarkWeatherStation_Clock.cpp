@@ -0,0 +1,150 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Clock.cpp
+ * @brief Station RTC tracked against millis(), so timestamps are extrapolated locally between rare RTC reads
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation_Clock.h"
+
+DFRobot_LarkWeatherStation_Clock::DFRobot_LarkWeatherStation_Clock(DFRobot_LarkWeatherStation *station)
+  :_station(station),_baseTick(0),_baseEpoch(0),_baseMs(0),_anchorTick(0),_anchorEpoch(0),_anchorMs(0),
+   _drift(0),_roundTrip(0),_accuracy(0),_synced(false)
+{
+}
+
+bool DFRobot_LarkWeatherStation_Clock::sync(uint16_t maxMs)
+{
+  uint32_t start = millis(), t0, t1, prevT0 = 0, epoch, prevEpoch = 0, bestMid = 0, bestEpoch = 0;
+  uint16_t rtt, bestRtt = 0xffff;
+  bool read = false;
+  do{
+    t0 = millis();
+    if(!_station->getEpoch(&epoch)) return false;
+    t1 = millis();
+    rtt = t1 - t0;
+    if(rtt < bestRtt){
+      bestRtt = rtt;
+      bestMid = t0 + rtt / 2;
+      bestEpoch = epoch;
+    }
+    if(read && (epoch == prevEpoch + 1)){
+      //The second changed after the previous read started and before this one ended
+      _roundTrip = bestRtt;
+      _accuracy = (t1 - prevT0) / 2;
+      rebase(prevT0 + _accuracy, epoch, 0, !_synced);
+      return true;
+    }
+    prevT0 = t0;
+    prevEpoch = epoch;
+    read = true;
+  }while(millis() - start < maxMs);
+  //No second change seen, the read is somewhere in its second
+  _roundTrip = bestRtt;
+  _accuracy = 500 + bestRtt / 2;
+  rebase(bestMid, bestEpoch, 500, !_synced);
+  return true;
+}
+
+bool DFRobot_LarkWeatherStation_Clock::setTime(uint32_t epoch, uint32_t atMs)
+{
+  uint32_t t0, t1, elapsed, wait;
+  uint16_t oneWay;
+  if(!_synced){
+    //Only the round trip is needed, one read gives it
+    t0 = millis();
+    if(!_station->getEpoch(&elapsed)) return false;
+    _roundTrip = millis() - t0;
+  }
+  oneWay = _roundTrip / 2;
+  //Send so the time arrives on a second boundary of the reference
+  elapsed = millis() + oneWay - atMs;
+  wait = (1000 - elapsed % 1000) % 1000;
+  if(wait) delay(wait);
+  t0 = millis();
+  epoch += (t0 + oneWay - atMs + 500) / 1000;
+  if(!_station->setEpoch(epoch)) return false;
+  t1 = millis();
+  _accuracy = (t1 - t0) / 2;
+  rebase(t0 + oneWay, epoch, 0, true);
+  return true;
+}
+
+void DFRobot_LarkWeatherStation_Clock::rebase(uint32_t tick, uint32_t epoch, uint16_t ms, bool anchor)
+{
+  uint32_t hostElapsed = tick - _anchorTick;
+  int32_t stationElapsed;
+  if(!anchor && (hostElapsed >= LARK_CLOCK_DRIFT_MS)){
+    stationElapsed = (int32_t)(epoch - _anchorEpoch) * 1000 + ms - _anchorMs;
+    _drift = (float)(stationElapsed - (int32_t)hostElapsed) * 1e6 / hostElapsed;
+    //Keep the elapsed times within int32_t ms, the drift carries over
+    if(hostElapsed >= 0x40000000UL) anchor = true;
+  }
+  if(anchor){
+    _anchorTick = tick;
+    _anchorEpoch = epoch;
+    _anchorMs = ms;
+  }
+  _baseTick = tick;
+  _baseEpoch = epoch;
+  _baseMs = ms;
+  _synced = true;
+}
+
+bool DFRobot_LarkWeatherStation_Clock::synced(void)
+{
+  return _synced;
+}
+
+uint32_t DFRobot_LarkWeatherStation_Clock::epochAt(uint32_t stamp, uint16_t *ms)
+{
+  int32_t elapsed = stamp - _baseTick;
+  int32_t total;
+  uint32_t epoch;
+  if(!_synced){
+    if(ms) *ms = 0;
+    return 0;
+  }
+  total = _baseMs + elapsed + (int32_t)(elapsed * _drift / 1e6);
+  //Floor division, stamps before the sync give negative totals
+  epoch = _baseEpoch + (total >= 0 ? total / 1000 : -((999 - total) / 1000));
+  if(ms) *ms = total >= 0 ? total % 1000 : (1000 - (-total) % 1000) % 1000;
+  return epoch;
+}
+
+uint32_t DFRobot_LarkWeatherStation_Clock::epoch(uint16_t *ms)
+{
+  return epochAt(millis(), ms);
+}
+
+bool DFRobot_LarkWeatherStation_Clock::now(sTime_t &time)
+{
+  if(!_synced) return false;
+  DFRobot_LarkWeatherStation::epochToTime(epoch(), time);
+  return true;
+}
+
+int32_t DFRobot_LarkWeatherStation_Clock::offset(uint32_t epoch, uint32_t atMs)
+{
+  uint16_t ms;
+  uint32_t station = epochAt(atMs, &ms);
+  return (int32_t)(station - epoch) * 1000 + ms;
+}
+
+float DFRobot_LarkWeatherStation_Clock::drift(void)
+{
+  return _drift;
+}
+
+uint16_t DFRobot_LarkWeatherStation_Clock::roundTrip(void)
+{
+  return _roundTrip;
+}
+
+uint16_t DFRobot_LarkWeatherStation_Clock::accuracy(void)
+{
+  return _accuracy;
+}
@@ -0,0 +1,107 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Clock.h
+ * @brief Station RTC tracked against millis(), so timestamps are extrapolated locally between rare RTC reads
+ * @n     The RTC counts whole seconds, sync() reads it back to back until the second changes: the change lies
+ * @n     between two reads, which places the station clock to within about one round trip. Syncs further apart
+ * @n     give the drift of the RTC against millis(). setTime() sends the reference time so that it arrives half a
+ * @n     round trip later exactly on a second boundary.
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#ifndef _DFROBOT_LARKWEATHERSTATION_CLOCK_H_
+#define _DFROBOT_LARKWEATHERSTATION_CLOCK_H_
+
+#include "DFRobot_LarkWeatherStation.h"
+
+#define LARK_CLOCK_SYNC_MS          2500     ///< Default longest time sync() reads the RTC waiting for a second change
+#define LARK_CLOCK_DRIFT_MS         600000   ///< Syncs closer than this do not update the drift
+
+class DFRobot_LarkWeatherStation_Clock{
+public:
+  DFRobot_LarkWeatherStation_Clock(DFRobot_LarkWeatherStation *station);
+  /**
+   * @fn sync
+   * @brief Measure the station clock against millis(), blocks for up to maxMs
+   *
+   * @param maxMs Longest time to wait for the RTC second to change, with less than about 1000 ms the clock
+   * @n           is only placed to within half a second
+   * @return Whether the RTC was read, see the station's lastError() otherwise
+   */
+  bool sync(uint16_t maxMs = LARK_CLOCK_SYNC_MS);
+  /**
+   * @fn setTime
+   * @brief Set the RTC to a reference time, compensating the transport delay measured by the last sync()
+   *
+   * @param epoch Reference seconds since 1970-01-01, e.g. from NTP or GPS
+   * @param atMs  millis() at which the reference was epoch.000
+   * @return Whether the RTC was set, the clock then follows the new time
+   */
+  bool setTime(uint32_t epoch, uint32_t atMs);
+  /**
+   * @fn synced
+   * @brief Whether the clock was synced or set
+   */
+  bool synced(void);
+  /**
+   * @fn epoch
+   * @brief Station time now, extrapolated from the last sync with the drift
+   *
+   * @param ms Returns the milliseconds of the second, may be NULL
+   * @return Seconds since 1970-01-01, 0 before a sync
+   */
+  uint32_t epoch(uint16_t *ms = NULL);
+  /**
+   * @fn epochAt
+   * @brief Station time at millis() stamp, e.g. the stamp of a drained sample
+   */
+  uint32_t epochAt(uint32_t stamp, uint16_t *ms = NULL);
+  /**
+   * @fn now
+   * @brief Station time now in fields
+   * @return Whether the clock was synced
+   */
+  bool now(sTime_t &time);
+  /**
+   * @fn offset
+   * @brief Station time minus a reference time in ms, positive when the station is ahead
+   *
+   * @param epoch Reference seconds since 1970-01-01
+   * @param atMs  millis() at which the reference was epoch.000
+   */
+  int32_t offset(uint32_t epoch, uint32_t atMs);
+  /**
+   * @fn drift
+   * @brief Rate of the station clock against millis() in parts per million, positive when the station runs fast
+   */
+  float drift(void);
+  /**
+   * @fn roundTrip
+   * @brief Shortest round trip of a time read in the last sync, in ms
+   */
+  uint16_t roundTrip(void);
+  /**
+   * @fn accuracy
+   * @brief Half the interval the last sync placed the second change in, in ms
+   */
+  uint16_t accuracy(void);
+private:
+  void rebase(uint32_t tick, uint32_t epoch, uint16_t ms, bool anchor);
+
+  DFRobot_LarkWeatherStation *_station;
+  uint32_t _baseTick;      ///< millis() of the last sync
+  uint32_t _baseEpoch;     ///< Station time at _baseTick
+  uint16_t _baseMs;
+  uint32_t _anchorTick;    ///< millis() of the oldest sync since the RTC was last set, the drift is measured from it
+  uint32_t _anchorEpoch;
+  uint16_t _anchorMs;
+  float _drift;            ///< ppm
+  uint16_t _roundTrip;
+  uint16_t _accuracy;
+  bool _synced;
+};
+
+#endif
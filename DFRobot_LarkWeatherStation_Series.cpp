@@ -0,0 +1,386 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Series.cpp
+ * @brief Compressed time series of station samples in fixed-size blocks
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation_Series.h"
+
+/*
+ * Sample coding, most significant bit first:
+ *   time    delta-of-delta zigzag coded: '0' same interval, '10' 7 bits, '110' 9 bits, '1110' 12 bits, '1111' 32 bits
+ *   valid   '0' same fields as the previous sample, '1' followed by the 8 LARK_SNAPSHOT_* bits
+ *   fields  for every valid field the zigzag coded 16 bit delta to its previous value:
+ *           '0' unchanged, '10' 4 bits, '110' 8 bits, '1110' 12 bits, '1111' 16 bits
+ */
+
+static uint16_t readHeader16(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8);
+}
+
+static uint32_t readHeader32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @fn putBits
+ * @brief Write the n low bits of value, bits that do not fit are dropped
+ *
+ * @param data Bit stream behind the block header
+ * @param cap  Byte number of data
+ * @return Whether every bit fit
+ */
+static bool putBits(uint8_t *data, uint16_t cap, uint32_t *bit, uint32_t value, uint8_t n)
+{
+  while(n){
+    uint32_t pos = *bit >> 3;
+    uint8_t room = 8 - (*bit & 7);
+    uint8_t take = (n < room) ? n : room;
+    uint8_t mask = ((1 << take) - 1) << (room - take);
+    if(pos >= cap) return false;
+    data[pos] = (data[pos] & ~mask) | (((value >> (n - take)) << (room - take)) & mask);
+    *bit += take;
+    n -= take;
+  }
+  return true;
+}
+
+/**
+ * @fn getBits
+ * @brief Read n bits, reading past the end yields zeros
+ */
+static uint32_t getBits(const uint8_t *data, uint16_t cap, uint32_t *bit, uint8_t n)
+{
+  uint32_t value = 0;
+  while(n){
+    uint32_t pos = *bit >> 3;
+    uint8_t room = 8 - (*bit & 7);
+    uint8_t take = (n < room) ? n : room;
+    uint8_t chunk = (pos < cap) ? (data[pos] >> (room - take)) & ((1 << take) - 1) : 0;
+    value = (value << take) | chunk;
+    *bit += take;
+    n -= take;
+  }
+  return value;
+}
+
+/**
+ * @fn putCode
+ * @brief Write a zigzag coded value with the shortest of four widths, widths[3] must hold any value
+ */
+static bool putCode(uint8_t *data, uint16_t cap, uint32_t *bit, uint32_t zigzag, const uint8_t widths[4])
+{
+  if(zigzag == 0) return putBits(data, cap, bit, 0, 1);
+  for(uint8_t i = 0; i < 3; i++){
+    if(zigzag < ((uint32_t)1 << widths[i])){
+      //i + 1 ones and a zero
+      return putBits(data, cap, bit, ((1 << (i + 2)) - 2), i + 2) && putBits(data, cap, bit, zigzag, widths[i]);
+    }
+  }
+  return putBits(data, cap, bit, 0x0f, 4) && putBits(data, cap, bit, zigzag, widths[3]);
+}
+
+static uint32_t getCode(const uint8_t *data, uint16_t cap, uint32_t *bit, const uint8_t widths[4])
+{
+  uint8_t ones = 0;
+  while((ones < 4) && getBits(data, cap, bit, 1)) ones++;
+  if(ones == 0) return 0;
+  return getBits(data, cap, bit, widths[ones - 1]);
+}
+
+static const uint8_t timeWidths[4] = {7, 9, 12, 32};
+static const uint8_t fieldWidths[4] = {4, 8, 12, 16};
+
+static uint16_t fieldValue(const sSampleRecord_t &record, uint8_t i)
+{
+  switch(i){
+    case 0: return (uint16_t)record.temp;
+    case 1: return record.humidity;
+    case 2: return record.speed;
+    case 3: return record.direction;
+    case 4: return (uint16_t)record.altitude;
+    default: return record.pressure;
+  }
+}
+
+static void setField(sSampleRecord_t *record, uint8_t i, uint16_t value)
+{
+  switch(i){
+    case 0: record->temp = (int16_t)value; break;
+    case 1: record->humidity = value; break;
+    case 2: record->speed = value; break;
+    case 3: record->direction = value; break;
+    case 4: record->altitude = (int16_t)value; break;
+    default: record->pressure = value; break;
+  }
+}
+
+/**
+ * @fn startState
+ * @brief Coding state in front of the first sample of a block starting at stamp
+ */
+static void startState(sSeriesState_t *state, uint32_t stamp)
+{
+  memset(state, 0, sizeof(sSeriesState_t));
+  state->stamp = stamp;
+}
+
+DFRobot_LarkWeatherStation_SeriesWriter::DFRobot_LarkWeatherStation_SeriesWriter()
+  :_block(NULL),_size(0)
+{
+  startState(&_state, 0);
+}
+
+bool DFRobot_LarkWeatherStation_SeriesWriter::begin(uint8_t *block, uint16_t size)
+{
+  _block = NULL;
+  if((block == NULL) || (size <= LARK_SERIES_HEADER_LEN)) return false;
+  _block = block;
+  _size = size;
+  memset(block, 0, LARK_SERIES_HEADER_LEN);
+  block[6] = LARK_SERIES_MAGIC;
+  block[7] = LARK_SERIES_VERSION;
+  startState(&_state, 0);
+  return true;
+}
+
+bool DFRobot_LarkWeatherStation_SeriesWriter::append(uint32_t stamp, const sSampleRecord_t &record)
+{
+  uint8_t *data = _block + LARK_SERIES_HEADER_LEN;
+  uint16_t cap = _size - LARK_SERIES_HEADER_LEN;
+  sSeriesState_t state;
+  uint32_t delta, dod;
+  bool fit;
+  if((_block == NULL) || (_state.count == 0xffff)) return false;
+  //Coded on a copy, the state is only taken when the whole sample fit
+  if(_state.count == 0){
+    startState(&state, stamp);
+  }else{
+    state = _state;
+  }
+  delta = stamp - state.stamp;
+  dod = delta - state.delta;
+  fit = putCode(data, cap, &state.bit, (dod << 1) ^ (uint32_t)((int32_t)dod >> 31), timeWidths);
+  if(record.valid == state.valid){
+    fit = fit && putBits(data, cap, &state.bit, 0, 1);
+  }else{
+    fit = fit && putBits(data, cap, &state.bit, 0x100 | record.valid, 9);
+  }
+  for(uint8_t i = 0; fit && (i < LARK_SERIES_FIELDS); i++){
+    uint16_t value, diff;
+    if(!(record.valid & (1 << i))) continue;
+    value = fieldValue(record, i);
+    diff = value - state.value[i];
+    fit = putCode(data, cap, &state.bit, (uint16_t)((diff << 1) ^ (uint16_t)((int16_t)diff >> 15)), fieldWidths);
+    state.value[i] = value;
+  }
+  if(!fit) return false;
+  state.stamp = stamp;
+  state.delta = delta;
+  state.valid = record.valid;
+  state.count++;
+  _state = state;
+  if(_state.count == 1){
+    _block[0] = stamp & 0xff;
+    _block[1] = (stamp >> 8) & 0xff;
+    _block[2] = (stamp >> 16) & 0xff;
+    _block[3] = (stamp >> 24) & 0xff;
+  }
+  _block[4] = _state.count & 0xff;
+  _block[5] = _state.count >> 8;
+  return true;
+}
+
+uint16_t DFRobot_LarkWeatherStation_SeriesWriter::count(void)
+{
+  return _state.count;
+}
+
+uint16_t DFRobot_LarkWeatherStation_SeriesWriter::length(void)
+{
+  if(_block == NULL) return 0;
+  return LARK_SERIES_HEADER_LEN + ((_state.bit + 7) >> 3);
+}
+
+DFRobot_LarkWeatherStation_SeriesReader::DFRobot_LarkWeatherStation_SeriesReader()
+  :_block(NULL),_size(0)
+{
+  startState(&_state, 0);
+}
+
+bool DFRobot_LarkWeatherStation_SeriesReader::begin(const uint8_t *block, uint16_t size)
+{
+  _block = NULL;
+  if((block == NULL) || (size <= LARK_SERIES_HEADER_LEN)) return false;
+  if((block[6] != LARK_SERIES_MAGIC) || (block[7] != LARK_SERIES_VERSION)) return false;
+  _block = block;
+  _size = size;
+  startState(&_state, readHeader32(block));
+  return true;
+}
+
+bool DFRobot_LarkWeatherStation_SeriesReader::next(uint32_t *stamp, sSampleRecord_t *record)
+{
+  const uint8_t *data = _block + LARK_SERIES_HEADER_LEN;
+  uint16_t cap = _size - LARK_SERIES_HEADER_LEN;
+  uint32_t dod;
+  if((_block == NULL) || (_state.count >= count())) return false;
+  dod = getCode(data, cap, &_state.bit, timeWidths);
+  dod = (dod >> 1) ^ (uint32_t)-(int32_t)(dod & 1);
+  _state.delta += dod;
+  _state.stamp += _state.delta;
+  if(getBits(data, cap, &_state.bit, 1)) _state.valid = getBits(data, cap, &_state.bit, 8);
+  memset(record, 0, sizeof(sSampleRecord_t));
+  for(uint8_t i = 0; i < LARK_SERIES_FIELDS; i++){
+    uint16_t diff;
+    if(!(_state.valid & (1 << i))) continue;
+    diff = getCode(data, cap, &_state.bit, fieldWidths);
+    _state.value[i] += (diff >> 1) ^ (uint16_t)-(int16_t)(diff & 1);
+    setField(record, i, _state.value[i]);
+  }
+  if(_state.count){
+    uint32_t ticks = _state.delta / LARK_SAMPLE_TICK_MS;
+    record->delta = (ticks > 0xffff) ? 0xffff : ticks;
+  }
+  record->valid = _state.valid;
+  _state.count++;
+  *stamp = _state.stamp;
+  return true;
+}
+
+bool DFRobot_LarkWeatherStation_SeriesReader::seek(uint32_t stamp)
+{
+  sSeriesState_t state;
+  sSampleRecord_t record;
+  uint32_t at;
+  if(_block == NULL) return false;
+  while(true){
+    state = _state;
+    if(!next(&at, &record)) return false;
+    if((int32_t)(at - stamp) >= 0){
+      //Step back so the next call returns this sample
+      _state = state;
+      return true;
+    }
+  }
+}
+
+uint16_t DFRobot_LarkWeatherStation_SeriesReader::count(void)
+{
+  if(_block == NULL) return 0;
+  return readHeader16(_block + 4);
+}
+
+DFRobot_LarkWeatherStation_Series::DFRobot_LarkWeatherStation_Series(uint8_t *buffer, uint16_t blocks, uint16_t blockSize)
+  :_buffer(buffer),_blocks(blocks),_blockSize(blockSize)
+{
+  clear();
+}
+
+void DFRobot_LarkWeatherStation_Series::clear(void)
+{
+  _head = 0;
+  _used = 0;
+  _samples = 0;
+  _readIndex = 0;
+  _readOpen = false;
+}
+
+uint8_t *DFRobot_LarkWeatherStation_Series::slot(uint16_t index)
+{
+  return _buffer + (uint32_t)((_head + index) % _blocks) * _blockSize;
+}
+
+bool DFRobot_LarkWeatherStation_Series::append(uint32_t stamp, const sSampleRecord_t &record)
+{
+  if((_buffer == NULL) || (_blocks == 0)) return false;
+  if((_used != 0) && _writer.append(stamp, record)){
+    _samples++;
+    return true;
+  }
+  if(_used == _blocks){
+    //Reuse the oldest block
+    _samples -= readHeader16(slot(0) + 4);
+    _head = (_head + 1) % _blocks;
+    _used--;
+    if(_readIndex){
+      _readIndex--;
+    }else{
+      //The block being read is overwritten, continue at the new oldest one
+      _readOpen = false;
+    }
+  }
+  _used++;
+  if(!_writer.begin(slot(_used - 1), _blockSize) || !_writer.append(stamp, record)){
+    //A sample larger than a block
+    _used--;
+    return false;
+  }
+  _samples++;
+  return true;
+}
+
+bool DFRobot_LarkWeatherStation_Series::openRead(uint16_t index)
+{
+  _readIndex = index;
+  _readOpen = (index < _used) && _reader.begin(slot(index), _blockSize);
+  return _readOpen;
+}
+
+bool DFRobot_LarkWeatherStation_Series::seek(uint32_t stamp)
+{
+  uint16_t low = 0, high = _used;
+  if(_used == 0) return false;
+  //Last block starting at or before stamp
+  while(high - low > 1){
+    uint16_t mid = (low + high) / 2;
+    if((int32_t)(readHeader32(slot(mid)) - stamp) <= 0){
+      low = mid;
+    }else{
+      high = mid;
+    }
+  }
+  for(uint16_t i = low; i < _used; i++){
+    if(openRead(i) && _reader.seek(stamp)) return true;
+  }
+  //Newer samples appended later are read from the end of the last block
+  return false;
+}
+
+bool DFRobot_LarkWeatherStation_Series::next(uint32_t *stamp, sSampleRecord_t *record)
+{
+  if(!_readOpen && !openRead(_readIndex)) return false;
+  while(!_reader.next(stamp, record)){
+    //The last block is still written to, stay on it
+    if((_readIndex + 1 >= _used) || !openRead(_readIndex + 1)) return false;
+  }
+  return true;
+}
+
+uint16_t DFRobot_LarkWeatherStation_Series::blocks(void)
+{
+  return _used;
+}
+
+const uint8_t *DFRobot_LarkWeatherStation_Series::block(uint16_t index)
+{
+  if(index >= _used) return NULL;
+  return slot(index);
+}
+
+uint32_t DFRobot_LarkWeatherStation_Series::samples(void)
+{
+  return _samples;
+}
+
+uint32_t DFRobot_LarkWeatherStation_Series::bytes(void)
+{
+  if(_used == 0) return 0;
+  return (uint32_t)(_used - 1) * _blockSize + _writer.length();
+}
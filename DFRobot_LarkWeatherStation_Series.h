@@ -0,0 +1,202 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Series.h
+ * @brief Compressed time series of station samples in fixed-size blocks
+ * @n     Timestamps are stored as delta-of-delta, every field of sSampleRecord_t as the delta to its previous
+ * @n     value, both with short prefix codes so slowly changing weather costs a few bits per sample.
+ * @n     Every block starts with the time of its first sample and decodes on its own, so blocks can be
+ * @n     kept in RAM, PSRAM or flash pages and searched by time.
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#ifndef _DFROBOT_LARKWEATHERSTATION_SERIES_H_
+#define _DFROBOT_LARKWEATHERSTATION_SERIES_H_
+
+#include "DFRobot_LarkWeatherStation.h"
+
+#ifndef LARK_SERIES_BLOCK_SIZE
+#if defined(__AVR__)
+#define LARK_SERIES_BLOCK_SIZE      128    ///< Default byte number of a block
+#else
+#define LARK_SERIES_BLOCK_SIZE      1024   ///< Default byte number of a block
+#endif
+#endif
+#define LARK_SERIES_HEADER_LEN      8      ///< First time (4), sample count (2), magic (1), version (1)
+#define LARK_SERIES_MAGIC           0x4c   ///< Marks a block header, erased or blank blocks do not carry it
+#define LARK_SERIES_VERSION         1      ///< Coding of the block
+#define LARK_SERIES_FIELDS          6      ///< Coded fields of sSampleRecord_t, in LARK_SNAPSHOT_* bit order
+
+typedef struct{
+  uint32_t bit;                        /**< Bit position behind the block header */
+  uint32_t stamp;                      /**< Time of the previous sample */
+  uint32_t delta;                      /**< Time between the two previous samples */
+  uint16_t value[LARK_SERIES_FIELDS];  /**< Previous value of each field */
+  uint16_t count;                      /**< Samples coded so far */
+  uint8_t valid;                       /**< LARK_SNAPSHOT_* bits of the previous sample */
+}sSeriesState_t;
+
+/**
+ * @brief Appends samples to one block
+ */
+class DFRobot_LarkWeatherStation_SeriesWriter{
+public:
+  DFRobot_LarkWeatherStation_SeriesWriter();
+  /**
+   * @fn begin
+   * @brief Start an empty block
+   *
+   * @param block Block memory, the header is written at once
+   * @param size  Byte number of the block
+   * @return Whether the block is larger than its header
+   */
+  bool begin(uint8_t *block, uint16_t size);
+  /**
+   * @fn append
+   * @brief Code a sample at the end of the block
+   *
+   * @param stamp  Time of the sample, e.g. millis() from drain()
+   * @param record Sample, only the fields in record.valid are stored, delta is ignored
+   * @return Whether the sample fit, the block is left unchanged otherwise
+   */
+  bool append(uint32_t stamp, const sSampleRecord_t &record);
+  /**
+   * @fn count
+   * @brief Samples in the block
+   */
+  uint16_t count(void);
+  /**
+   * @fn length
+   * @brief Bytes of the block in use, including the header
+   */
+  uint16_t length(void);
+private:
+  uint8_t *_block;
+  uint16_t _size;
+  sSeriesState_t _state;
+};
+
+/**
+ * @brief Decodes the samples of one block in order
+ */
+class DFRobot_LarkWeatherStation_SeriesReader{
+public:
+  DFRobot_LarkWeatherStation_SeriesReader();
+  /**
+   * @fn begin
+   * @brief Start reading a block at its first sample
+   *
+   * @param block Block memory
+   * @param size  Byte number of the block
+   * @return Whether block carries a valid header
+   */
+  bool begin(const uint8_t *block, uint16_t size);
+  /**
+   * @fn next
+   * @brief Decode the next sample, samples appended to the block after begin() are read as well
+   *
+   * @param stamp  Returns the time of the sample
+   * @param record Returns the sample, delta is the time since the previously read sample, 0 for the first one
+   * @return Whether a sample was left
+   */
+  bool next(uint32_t *stamp, sSampleRecord_t *record);
+  /**
+   * @fn seek
+   * @brief Skip the samples older than stamp
+   * @return Whether a sample at or after stamp is left in the block
+   */
+  bool seek(uint32_t stamp);
+  /**
+   * @fn count
+   * @brief Samples in the block
+   */
+  uint16_t count(void);
+private:
+  const uint8_t *_block;
+  uint16_t _size;
+  sSeriesState_t _state;
+};
+
+/**
+ * @brief Ring of fixed-size blocks in caller memory, the oldest block is reused when all are full
+ */
+class DFRobot_LarkWeatherStation_Series{
+public:
+  /**
+   * @fn DFRobot_LarkWeatherStation_Series
+   * @brief Constructor, the store starts empty
+   *
+   * @param buffer    Memory of blocks * blockSize bytes
+   * @param blocks    Number of blocks
+   * @param blockSize Byte number of a block
+   */
+  DFRobot_LarkWeatherStation_Series(uint8_t *buffer, uint16_t blocks, uint16_t blockSize = LARK_SERIES_BLOCK_SIZE);
+  /**
+   * @fn clear
+   * @brief Drop every sample
+   */
+  void clear(void);
+  /**
+   * @fn append
+   * @brief Store a sample, a new block is started when the current one is full
+   *
+   * @param stamp  Time of the sample, not older than the previous sample
+   * @param record Sample
+   * @return Whether the sample was stored
+   */
+  bool append(uint32_t stamp, const sSampleRecord_t &record);
+  /**
+   * @fn seek
+   * @brief Move the read position to the first sample at or after stamp, found by a binary search over the blocks
+   * @n     Reading starts at the oldest sample without a seek
+   * @return Whether such a sample exists, reading continues with samples appended later otherwise
+   */
+  bool seek(uint32_t stamp);
+  /**
+   * @fn next
+   * @brief Read the sample at the read position and advance it, see DFRobot_LarkWeatherStation_SeriesReader::next()
+   * @return Whether a sample was left
+   */
+  bool next(uint32_t *stamp, sSampleRecord_t *record);
+  /**
+   * @fn blocks
+   * @brief Blocks in use
+   */
+  uint16_t blocks(void);
+  /**
+   * @fn block
+   * @brief Memory of a block in use, e.g. to write it to flash
+   *
+   * @param index 0 is the oldest block
+   * @return Block pointer, NULL if index is not in use
+   */
+  const uint8_t *block(uint16_t index);
+  /**
+   * @fn samples
+   * @brief Samples stored in all blocks
+   */
+  uint32_t samples(void);
+  /**
+   * @fn bytes
+   * @brief Bytes of the blocks in use, including headers and unused tails of full blocks
+   */
+  uint32_t bytes(void);
+private:
+  uint8_t *slot(uint16_t index);
+  bool openRead(uint16_t index);
+
+  uint8_t *_buffer;
+  uint16_t _blocks;
+  uint16_t _blockSize;
+  uint16_t _head;        ///< Slot of the oldest block
+  uint16_t _used;        ///< Blocks in use, the last one is being written
+  uint32_t _samples;     ///< Samples in all blocks
+  uint16_t _readIndex;   ///< Block of the read position
+  bool _readOpen;        ///< _reader is positioned in block _readIndex, it starts at the block's first sample otherwise
+  DFRobot_LarkWeatherStation_SeriesWriter _writer;
+  DFRobot_LarkWeatherStation_SeriesReader _reader;
+};
+
+#endif
@@ -0,0 +1,154 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Wind.cpp
+ * @brief Wind statistics from paired speed and direction samples
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation_Wind.h"
+#include <math.h>
+
+#define GUST_SLOT_MS    (LARK_WIND_GUST_MS / LARK_WIND_GUST_SLOTS)
+
+static const uint32_t windowSpan[eWindWindows] = {120000, 600000};
+
+static void sumMerge(sWindSum_t *dst, const sWindSum_t *src)
+{
+  if(src->count == 0) return;
+  if((dst->count == 0) || (src->gust > dst->gust)) dst->gust = src->gust;
+  dst->speed += src->speed;
+  dst->u += src->u;
+  dst->v += src->v;
+  dst->count += src->count;
+}
+
+static bool sumStat(const sWindSum_t *sum, sWindStat_t *stat)
+{
+  uint32_t count = sum->count;
+  float u, v;
+  if((stat == NULL) || (count == 0)) return false;
+  u = sum->u / count;
+  v = sum->v / count;
+  stat->count = count;
+  stat->speed = sum->speed / count;
+  stat->vectorSpeed = sqrt(u * u + v * v);
+  stat->direction = 0;
+  //Opposite winds that cancel out leave only rounding noise, report calm as 0
+  if(stat->vectorSpeed > stat->speed * 1e-4){
+    stat->direction = atan2(u, v) * RAD_TO_DEG;
+    if(stat->direction < 0) stat->direction += 360;
+  }
+  stat->gust = sum->gust;
+  return true;
+}
+
+DFRobot_LarkWeatherStation_Wind::DFRobot_LarkWeatherStation_Wind()
+{
+  clear();
+}
+
+void DFRobot_LarkWeatherStation_Wind::clear(void)
+{
+  memset(_window, 0, sizeof(_window));
+  for(uint8_t i = 0; i < eWindWindows; i++) _window[i].bucketMs = windowSpan[i] / LARK_WIND_BUCKETS;
+  memset(&_interval, 0, sizeof(_interval));
+  memset(_gustSum, 0, sizeof(_gustSum));
+  memset(_gustCount, 0, sizeof(_gustCount));
+  _gustNewest = 0;
+  _gustSlot = 0;
+  _started = false;
+}
+
+void DFRobot_LarkWeatherStation_Wind::advance(sWindWindow_t *window, uint32_t stamp)
+{
+  uint32_t steps;
+  if(!_started){
+    window->newest = stamp;
+    window->slot = 0;
+    return;
+  }
+  //Stamps are compared by their difference, which stays right across the wrap of millis()
+  steps = (stamp - window->newest) / window->bucketMs;
+  window->newest += steps * window->bucketMs;
+  if(steps >= LARK_WIND_BUCKETS){
+    memset(window->bucket, 0, sizeof(window->bucket));
+    return;
+  }
+  while(steps--){
+    window->slot = (window->slot + 1) % LARK_WIND_BUCKETS;
+    memset(&window->bucket[window->slot], 0, sizeof(sWindSum_t));
+  }
+}
+
+void DFRobot_LarkWeatherStation_Wind::add(uint32_t stamp, float speed, float direction)
+{
+  uint32_t steps;
+  sWindSum_t sample;
+  if(_started && ((int32_t)(stamp - _gustNewest) < 0)) return;
+  //3 second mean speed, slots older than LARK_WIND_GUST_MS are cleared on the way
+  steps = _started ? (stamp - _gustNewest) / GUST_SLOT_MS : LARK_WIND_GUST_SLOTS;
+  _gustNewest = _started ? _gustNewest + steps * GUST_SLOT_MS : stamp;
+  if(steps >= LARK_WIND_GUST_SLOTS){
+    memset(_gustSum, 0, sizeof(_gustSum));
+    memset(_gustCount, 0, sizeof(_gustCount));
+  }else{
+    while(steps--){
+      _gustSlot = (_gustSlot + 1) % LARK_WIND_GUST_SLOTS;
+      _gustSum[_gustSlot] = 0;
+      _gustCount[_gustSlot] = 0;
+    }
+  }
+  _gustSum[_gustSlot] += speed;
+  _gustCount[_gustSlot]++;
+
+  sample.speed = speed;
+  sample.u = speed * sin(direction * DEG_TO_RAD);
+  sample.v = speed * cos(direction * DEG_TO_RAD);
+  sample.gust = gustSpeed();
+  sample.count = 1;
+  for(uint8_t i = 0; i < eWindWindows; i++){
+    sWindWindow_t *window = &_window[i];
+    advance(window, stamp);
+    sumMerge(&window->bucket[window->slot], &sample);
+  }
+  sumMerge(&_interval, &sample);
+  _started = true;
+}
+
+bool DFRobot_LarkWeatherStation_Wind::add(uint32_t stamp, const sSampleRecord_t &record)
+{
+  uint8_t need = LARK_SNAPSHOT_SPEED | LARK_SNAPSHOT_DIR;
+  if((record.valid & need) != need) return false;
+  add(stamp, record.speed / 100.0, record.direction / 10.0);
+  return true;
+}
+
+bool DFRobot_LarkWeatherStation_Wind::get(eWindWindow_t window, sWindStat_t *stat)
+{
+  sWindSum_t sum;
+  if(window >= eWindWindows) return false;
+  memset(&sum, 0, sizeof(sum));
+  for(uint8_t i = 0; i < LARK_WIND_BUCKETS; i++) sumMerge(&sum, &_window[window].bucket[i]);
+  return sumStat(&sum, stat);
+}
+
+bool DFRobot_LarkWeatherStation_Wind::takeInterval(sWindStat_t *stat)
+{
+  bool ret = sumStat(&_interval, stat);
+  memset(&_interval, 0, sizeof(_interval));
+  return ret;
+}
+
+float DFRobot_LarkWeatherStation_Wind::gustSpeed(void)
+{
+  float sum = 0;
+  uint16_t count = 0;
+  for(uint8_t i = 0; i < LARK_WIND_GUST_SLOTS; i++){
+    sum += _gustSum[i];
+    count += _gustCount[i];
+  }
+  return count ? sum / count : 0;
+}
@@ -0,0 +1,124 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Wind.h
+ * @brief Wind statistics from paired speed and direction samples
+ * @n     Direction is averaged as a speed-weighted vector as WMO does, so 350 and 10 degrees give north instead of
+ * @n     south and calm samples barely count. Gusts are the highest 3 second mean speed as defined by WMO, the 2
+ * @n     and 10 minute means slide over fixed buckets.
+ * @n     Memory is constant and a sample is added in constant time.
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#ifndef _DFROBOT_LARKWEATHERSTATION_WIND_H_
+#define _DFROBOT_LARKWEATHERSTATION_WIND_H_
+
+#include "DFRobot_LarkWeatherStation.h"
+
+#ifndef LARK_WIND_BUCKETS
+#if defined(__AVR__)
+#define LARK_WIND_BUCKETS           10     ///< Buckets of the 2 and 10 minute windows
+#else
+#define LARK_WIND_BUCKETS           40     ///< Buckets of the 2 and 10 minute windows
+#endif
+#endif
+#define LARK_WIND_GUST_MS           3000   ///< Averaging time of a gust
+#define LARK_WIND_GUST_SLOTS        12     ///< Slots of the gust average, LARK_WIND_GUST_MS / 12 each
+
+/**
+ * @enum eWindWindow_t
+ * @brief Averaging windows
+ */
+typedef enum{
+  eWindTwoMinute = 0,   /**< Last 2 minutes */
+  eWindTenMinute,       /**< Last 10 minutes */
+  eWindWindows,
+}eWindWindow_t;
+
+typedef struct{
+  float speed;       /**< Sum of the speeds */
+  float u;           /**< Sum of the east components */
+  float v;           /**< Sum of the north components */
+  float gust;        /**< Highest 3 second mean */
+  uint32_t count;    /**< Samples */
+}sWindSum_t;
+
+/**
+ * @brief Buckets follow each other from the first sample on, so their bounds stay right when millis() wraps
+ */
+typedef struct{
+  uint32_t bucketMs;                     /**< Bucket length in ms */
+  uint32_t newest;                       /**< Start time of the newest bucket */
+  uint8_t slot;                          /**< Slot of the newest bucket */
+  sWindSum_t bucket[LARK_WIND_BUCKETS];
+}sWindWindow_t;
+
+/**
+ * @brief Wind over a window, speeds in the unit of the samples, directions in degrees the wind comes from
+ */
+typedef struct{
+  float speed;        /**< Scalar mean speed */
+  float vectorSpeed;  /**< Speed of the mean wind vector, lower than speed when the direction varies */
+  float direction;    /**< Direction of the mean wind vector, 0 to 360 */
+  float gust;         /**< Highest 3 second mean speed */
+  uint32_t count;     /**< Samples in the window */
+}sWindStat_t;
+
+class DFRobot_LarkWeatherStation_Wind{
+public:
+  DFRobot_LarkWeatherStation_Wind();
+  /**
+   * @fn add
+   * @brief Add a wind sample
+   *
+   * @param stamp     millis() of the sample, it may wrap; samples older than the previous one are ignored
+   * @param speed     Wind speed
+   * @param direction Direction the wind comes from in degrees
+   */
+  void add(uint32_t stamp, float speed, float direction);
+  /**
+   * @fn add
+   * @brief Add the speed and direction of a sample record
+   * @return Whether the record held both
+   */
+  bool add(uint32_t stamp, const sSampleRecord_t &record);
+  /**
+   * @fn get
+   * @brief Get the wind over a window as of the newest sample
+   *
+   * @param window eWindTwoMinute or eWindTenMinute
+   * @param stat   Returns the statistics
+   * @return Whether the window holds samples
+   */
+  bool get(eWindWindow_t window, sWindStat_t *stat);
+  /**
+   * @fn takeInterval
+   * @brief Get the wind since the previous call and start a new interval, e.g. once per uplink
+   * @return Whether the interval holds samples
+   */
+  bool takeInterval(sWindStat_t *stat);
+  /**
+   * @fn gustSpeed
+   * @brief Current 3 second mean speed
+   */
+  float gustSpeed(void);
+  /**
+   * @fn clear
+   * @brief Drop every sample
+   */
+  void clear(void);
+private:
+  void advance(sWindWindow_t *window, uint32_t stamp);
+
+  sWindWindow_t _window[eWindWindows];
+  sWindSum_t _interval;                          ///< Sums since the previous takeInterval()
+  float _gustSum[LARK_WIND_GUST_SLOTS];          ///< Speed sums of the gust slots
+  uint16_t _gustCount[LARK_WIND_GUST_SLOTS];     ///< Samples of the gust slots
+  uint32_t _gustNewest;                          ///< Start time of the newest gust slot
+  uint8_t _gustSlot;                             ///< Index of the newest gust slot
+  bool _started;                                 ///< A sample was added
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*!
+ * @file aggregate.ino
+ * @brief This is a routine to keep the 1 minute and 10 minute min, max, mean and standard deviation of the skylark data
+ * ---------------------------------------------------------------------------------------------------------------
+ *    board   |             MCU                | Leonardo/Mega2560/M0 |    UNO    | ESP8266 | ESP32 |  microbit  |
+ *     VCC    |            3.3V/5V             |        VCC           |    VCC    |   VCC   |  VCC  |     X      |
+ *     GND    |              GND               |        GND           |    GND    |   GND   |  GND  |     X      |
+ *     RX     |              TX                |     Serial1 TX1      |     5     |   5/D6  |  D2   |     X      |
+ *     TX     |              RX                |     Serial1 RX1      |     4     |   4/D7  |  D3   |     X      |
+ * ---------------------------------------------------------------------------------------------------------------
+ * 
+ * @copyright    Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license      The MIT License (MIT)
+ * @author       [TangJie](jie.tang@dfrobot.com)
+ * @version      V1.0.0
+ * @date         2023-06-8
+ * @url         https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation.h"
+#include "DFRobot_LarkWeatherStation_Aggregator.h"
+#if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+#include <SoftwareSerial.h>
+#endif
+#define DEVICE_ADDR                  0x42
+
+#define MODESWITCH        /*UART:*/1 /*I2C: 0*/
+
+#if MODESWITCH
+#if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+  SoftwareSerial mySerial(/*rx =*/4, /*tx =*/5);
+  DFRobot_LarkWeatherStation_UART atm(&mySerial);
+#else
+  DFRobot_LarkWeatherStation_UART atm(&Serial1);
+#endif
+#else
+DFRobot_LarkWeatherStation_I2C atm(DEVICE_ADDR,&Wire);
+#endif
+
+DFRobot_LarkWeatherStation_Aggregator aggregator;
+const uint32_t spans[] = {60000, 600000};
+uint32_t lastReport = 0;
+
+void setup(void){
+  #if MODESWITCH
+  //Init MCU communication serial port
+  #if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+    mySerial.begin(115200);
+  #elif defined(ESP32)
+    Serial1.begin(115200, SERIAL_8N1, /*rx =*/D3, /*tx =*/D2);
+  #else
+    Serial1.begin(115200);
+  #endif
+  #endif
+  Serial.begin(115200);
+  while(atm.begin()!= 0){
+    Serial.println("init error");
+    delay(1000);
+  }
+  Serial.println("init success");
+  //Boards with little RAM keep fewer windows, see LARK_WINDOW_MAX
+  for(uint8_t i = 0; i < sizeof(spans) / sizeof(spans[0]); i++){
+    if(aggregator.addWindow(spans[i]) < 0) break;
+  }
+  atm.startContinuous(1000);
+}
+
+void loop(void){
+  sSampleRecord_t record;
+  uint32_t stamp;
+  sWindowStat_t stat;
+  atm.runContinuous();
+  while(atm.drain(&record, 1, &stamp)){
+    aggregator.add(stamp, record);
+  }
+  if(millis() - lastReport > 10000){
+    lastReport = millis();
+    for(uint8_t i = 0; aggregator.get(i, LARK_SNAPSHOT_TEMP, &stat); i++){
+      Serial.print(spans[i] / 60000);
+      Serial.print(" min Temp min:");
+      Serial.print(stat.min);
+      Serial.print(" max:");
+      Serial.print(stat.max);
+      Serial.print(" mean:");
+      Serial.print(stat.mean);
+      Serial.print(" stddev:");
+      Serial.println(stat.stddev);
+    }
+  }
+}
@@ -0,0 +1,105 @@
+/*!
+ * @file applyConfig.ino
+ * @brief This is a routine to apply the DTU configuration at every boot, unchanged settings are not written again
+ * ---------------------------------------------------------------------------------------------------------------
+ *    board   |             MCU                | Leonardo/Mega2560/M0 |    UNO    | ESP8266 | ESP32 |  microbit  |
+ *     VCC    |            3.3V/5V             |        VCC           |    VCC    |   VCC   |  VCC  |     X      |
+ *     GND    |              GND               |        GND           |    GND    |   GND   |  GND  |     X      |
+ *     RX     |              TX                |     Serial1 TX1      |     5     |   5/D6  |  D2   |     X      |
+ *     TX     |              RX                |     Serial1 RX1      |     4     |   4/D7  |  D3   |     X      |
+ * ---------------------------------------------------------------------------------------------------------------
+ * 
+ * @copyright    Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license      The MIT License (MIT)
+ * @author       [TangJie](jie.tang@dfrobot.com)
+ * @version      V1.0.0
+ * @date         2023-06-8
+ * @url         https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation.h"
+#if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+#include <SoftwareSerial.h>
+#endif
+#if defined(__AVR__)
+#include <EEPROM.h>
+#endif
+#define DEVICE_ADDR                  0x42
+#define SHADOW_ADDR                  0      ///< EEPROM address of the config shadow
+
+#define MODESWITCH        /*UART:*/1 /*I2C: 0*/
+
+#if MODESWITCH
+#if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+  SoftwareSerial mySerial(/*rx =*/4, /*tx =*/5);
+  DFRobot_LarkWeatherStation_UART atm(&mySerial);
+#else
+  DFRobot_LarkWeatherStation_UART atm(&Serial1);
+#endif
+#else
+DFRobot_LarkWeatherStation_I2C atm(DEVICE_ADDR,&Wire);
+#endif
+
+#if defined(__AVR__)
+bool loadShadow(void *ctx, sConfigShadow_t *shadow){
+  EEPROM.get(SHADOW_ADDR, *shadow);
+  return true;
+}
+
+void storeShadow(void *ctx, const sConfigShadow_t *shadow){
+  EEPROM.put(SHADOW_ADDR, *shadow);
+}
+#endif
+
+void setup(void){
+  sStationConfig_t config;
+  int sent;
+  #if MODESWITCH
+  //Init MCU communication serial port
+  #if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+    mySerial.begin(115200);
+  #elif defined(ESP32)
+    Serial1.begin(115200, SERIAL_8N1, /*rx =*/D3, /*tx =*/D2);
+  #else
+    Serial1.begin(115200);
+  #endif
+  #endif
+  Serial.begin(115200);
+  while(atm.begin()!= 0){
+    Serial.println("init error");
+    delay(1000);
+  }
+  Serial.println("init success");
+#if defined(__AVR__)
+  //Remember what was written across resets, other boards can persist the shadow the same way
+  atm.setConfigStore(loadShadow, storeShadow, NULL);
+#endif
+  memset(&config, 0, sizeof(config));
+  config.dtuSwitch = "off";
+  config.dtuMethod = "wifi";
+  config.ssid = "SSID";
+  config.password = "PASSWORD";
+  config.loraDevEui = "DEUI";
+  config.loraEui = "EUI";
+  config.loraKey = "KEY";
+  config.mqttServer = "Server";
+  config.mqttServerIp = "Server_IP";
+  config.mqttSave = "0";
+  config.iotId = "Iot_ID";
+  config.iotPwd = "Iot_PWD";
+  config.topicName[0] = "Topic_Humi";
+  config.topicKey[0] = "12fd35";
+  config.topicName[1] = "Topic_kk";
+  config.topicKey[1] = "12fd35";
+  //Commands that already succeeded are remembered, a retry only sends the rest
+  while((sent = atm.applyConfig(config)) < 0){
+    Serial.print("config error: ");
+    Serial.println(atm.lastError());
+    delay(1000);
+  }
+  Serial.print("config OK, commands sent: ");
+  Serial.println(sent);
+}
+
+void loop(void){
+  delay(100);
+}
@@ -34,6 +34,29 @@
 #else
 DFRobot_LarkWeatherStation_I2C atm(DEVICE_ADDR,&Wire);
 #endif
+DFRobot_LarkWeatherStation_Calibration calibration(&atm);
+
+void onStep(void *ctx, eCalibrationStep_t step, uint8_t error, uint8_t progress){
+  Serial.print("step ");
+  Serial.print(step);
+  Serial.print(error ? " failed, error " : " done, error ");
+  Serial.print(error);
+  Serial.print(", ");
+  Serial.print(progress);
+  Serial.println("%");
+}
+
+void onResult(void *ctx, const sCalibration_t *result){
+  if(result == NULL){
+    Serial.println("calibration failed");
+    return;
+  }
+  Serial.print("K: ");
+  Serial.println(result->k, 4);
+  Serial.print("B: ");
+  Serial.println(result->b, 4);
+}
+
 void setup(void){
   Serial.begin(115200);
   //mySerial.begin(9600);
@@ -43,15 +66,16 @@ void setup(void){
     delay(1000);
   }
   Serial.println("init success");
-  atm.setRadius(23.75);
-  delay(100);
-  atm.setSpeed1(4.8);
-  delay(100);
-  atm.setSpeed2(5.8);
-  delay(100);
-  atm.calibrationSpeed();
+  //Radius, standard wind speed 1 and 2 are sent and calculated step by step from loop()
+  calibration.setCallbacks(onStep, onResult, NULL);
+  calibration.begin(23.75, 4.8, 5.8);
 }
 
 void loop(void){
-    delay(100);
-}
\ No newline at end of file
+  calibration.run();
+  //Other reads can be made while no calibration step is in progress
+  if(!calibration.busy()){
+    Serial.println(atm.getValue(eSensorTemp));
+  }
+  delay(100);
+}
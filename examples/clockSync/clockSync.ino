@@ -0,0 +1,96 @@
+/*!
+ * @file clockSync.ino
+ * @brief This is a routine to track the skylark RTC locally, type the Unix time (date +%s) into the serial monitor to set it
+ * ---------------------------------------------------------------------------------------------------------------
+ *    board   |             MCU                | Leonardo/Mega2560/M0 |    UNO    | ESP8266 | ESP32 |  microbit  |
+ *     VCC    |            3.3V/5V             |        VCC           |    VCC    |   VCC   |  VCC  |     X      |
+ *     GND    |              GND               |        GND           |    GND    |   GND   |  GND  |     X      |
+ *     RX     |              TX                |     Serial1 TX1      |     5     |   5/D6  |  D2   |     X      |
+ *     TX     |              RX                |     Serial1 RX1      |     4     |   4/D7  |  D3   |     X      |
+ * ---------------------------------------------------------------------------------------------------------------
+ * 
+ * @copyright    Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license      The MIT License (MIT)
+ * @author       [TangJie](jie.tang@dfrobot.com)
+ * @version      V1.0.0
+ * @date         2023-06-8
+ * @url         https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation.h"
+#include "DFRobot_LarkWeatherStation_Clock.h"
+#if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+#include <SoftwareSerial.h>
+#endif
+#define DEVICE_ADDR                  0x42
+
+#define MODESWITCH        /*UART:*/1 /*I2C: 0*/
+
+#if MODESWITCH
+#if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+  SoftwareSerial mySerial(/*rx =*/4, /*tx =*/5);
+  DFRobot_LarkWeatherStation_UART atm(&mySerial);
+#else
+  DFRobot_LarkWeatherStation_UART atm(&Serial1);
+#endif
+#else
+DFRobot_LarkWeatherStation_I2C atm(DEVICE_ADDR,&Wire);
+#endif
+
+DFRobot_LarkWeatherStation_Clock rtc(&atm);
+uint32_t lastSync = 0;
+uint32_t lastReport = 0;
+
+void setup(void){
+  #if MODESWITCH
+  //Init MCU communication serial port
+  #if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+    mySerial.begin(115200);
+  #elif defined(ESP32)
+    Serial1.begin(115200, SERIAL_8N1, /*rx =*/D3, /*tx =*/D2);
+  #else
+    Serial1.begin(115200);
+  #endif
+  #endif
+  Serial.begin(115200);
+  while(atm.begin()!= 0){
+    Serial.println("init error");
+    delay(1000);
+  }
+  Serial.println("init success");
+  rtc.sync();
+  lastSync = millis();
+}
+
+void loop(void){
+  sTime_t time;
+  if(Serial.available()){
+    //Unix time typed in the serial monitor is the reference, it was valid when the line arrived
+    uint32_t at = millis();
+    uint32_t epoch = Serial.parseInt();
+    if(epoch && rtc.setTime(epoch, at)) Serial.println("RTC set");
+  }
+  //The RTC is read once an hour, timestamps are extrapolated in between
+  if(millis() - lastSync > 3600000){
+    lastSync = millis();
+    rtc.sync();
+  }
+  if((millis() - lastReport > 10000) && rtc.now(time)){
+    lastReport = millis();
+    Serial.print(time.year);
+    Serial.print("/");
+    Serial.print(time.month);
+    Serial.print("/");
+    Serial.print(time.day);
+    Serial.print(" ");
+    Serial.print(time.hour);
+    Serial.print(":");
+    Serial.print(time.minute);
+    Serial.print(":");
+    Serial.print(time.second);
+    Serial.print(" drift:");
+    Serial.print(rtc.drift());
+    Serial.print(" ppm accuracy:");
+    Serial.print(rtc.accuracy());
+    Serial.println(" ms");
+  }
+}
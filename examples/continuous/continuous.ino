@@ -0,0 +1,84 @@
+/*!
+ * @file continuous.ino
+ * @brief This is a routine to sample skylark data at a fixed period and forward it in bursts
+ * ---------------------------------------------------------------------------------------------------------------
+ *    board   |             MCU                | Leonardo/Mega2560/M0 |    UNO    | ESP8266 | ESP32 |  microbit  |
+ *     VCC    |            3.3V/5V             |        VCC           |    VCC    |   VCC   |  VCC  |     X      |
+ *     GND    |              GND               |        GND           |    GND    |   GND   |  GND  |     X      |
+ *     RX     |              TX                |     Serial1 TX1      |     5     |   5/D6  |  D2   |     X      |
+ *     TX     |              RX                |     Serial1 RX1      |     4     |   4/D7  |  D3   |     X      |
+ * ---------------------------------------------------------------------------------------------------------------
+ * 
+ * @copyright    Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license      The MIT License (MIT)
+ * @author       [TangJie](jie.tang@dfrobot.com)
+ * @version      V1.0.0
+ * @date         2023-06-8
+ * @url         https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation.h"
+#if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+#include <SoftwareSerial.h>
+#endif
+#define DEVICE_ADDR                  0x42
+
+#define MODESWITCH        /*UART:*/1 /*I2C: 0*/
+
+#if MODESWITCH
+#if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+  SoftwareSerial mySerial(/*rx =*/4, /*tx =*/5);
+  DFRobot_LarkWeatherStation_UART atm(&mySerial);
+#else
+  DFRobot_LarkWeatherStation_UART atm(&Serial1);
+#endif
+#else
+DFRobot_LarkWeatherStation_I2C atm(DEVICE_ADDR,&Wire);
+#endif
+
+sSampleRecord_t records[4];
+uint32_t lastUpload = 0;
+
+void setup(void){
+  #if MODESWITCH
+  //Init MCU communication serial port
+  #if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+    mySerial.begin(115200);
+  #elif defined(ESP32)
+    Serial1.begin(115200, SERIAL_8N1, /*rx =*/D3, /*tx =*/D2);
+  #else
+    Serial1.begin(115200);
+  #endif
+  #endif
+  Serial.begin(115200);
+  while(atm.begin()!= 0){
+    Serial.println("init error");
+    delay(1000);
+  }
+  Serial.println("init success");
+  //One sample per second, keep temperature, humidity and wind, drop the oldest record when the ring is full
+  atm.startContinuous(1000, LARK_SNAPSHOT_TEMP | LARK_SNAPSHOT_HUMI | LARK_SNAPSHOT_SPEED | LARK_SNAPSHOT_DIR, eSampleOverwrite);
+}
+
+void loop(void){
+  uint16_t n;
+  uint32_t stamp;
+  atm.runContinuous();
+  //Forward the collected records every 10 seconds, as an uplink would
+  if(millis() - lastUpload > 10000){
+    lastUpload = millis();
+    while((n = atm.drain(records, 4, &stamp)) > 0){
+      for(uint16_t i = 0; i < n; i++){
+        if(i) stamp += (uint32_t)records[i].delta * LARK_SAMPLE_TICK_MS;
+        Serial.print(stamp);
+        Serial.print(" Temp:");
+        Serial.print(records[i].temp / 100.0);
+        Serial.print(" Humi:");
+        Serial.print(records[i].humidity / 100.0);
+        Serial.print(" Speed:");
+        Serial.print(records[i].speed / 100.0);
+        Serial.print(" Dir:");
+        Serial.println(records[i].direction / 10.0);
+      }
+    }
+  }
+}
@@ -53,21 +53,27 @@ void setup(void){
   }
   Serial.println("init success");
   atm.setTime(2023,1,11,23,59,0);
+  //Reuse values for 1 s, units are read once per session
+  atm.setMaxAge(NULL, 1000);
 }
 
+const char* const keys[] = {"Temp", "Humi", "Speed", "Dir", "Altitude", "Pressure"};
+#define KEY_NUM (sizeof(keys) / sizeof(keys[0]))
+String values[KEY_NUM];
+
 void loop(void){
     Serial.println("----------------------------");
-    Serial.print(atm.getValue("Temp"));
-    Serial.println(atm.getUnit("Temp"));
-    Serial.print(atm.getValue("Humi"));
-    Serial.println(atm.getUnit("Humi"));
-    Serial.print(atm.getValue("Speed"));
-    Serial.println(atm.getUnit("Speed"));
-    Serial.println(atm.getValue("Dir"));
-    Serial.print(atm.getValue("Altitude"));
-    Serial.println(atm.getUnit("Altitude"));
-    Serial.print(atm.getValue("Pressure"));
-    Serial.println(atm.getUnit("Pressure"));
+    //Read every field in one exchange instead of one exchange per key
+    atm.getValues(keys, KEY_NUM, values);
+    for(uint8_t i = 0; i < KEY_NUM; i++){
+      Serial.print(keys[i]);
+      Serial.print(": ");
+      Serial.print(values[i]);
+      if(strcmp(keys[i], "Dir") != 0){
+        Serial.print(atm.getUnit(keys[i]));
+      }
+      Serial.println();
+    }
     Serial.println("----------------------------");
     Serial.println(atm.getInformation(true));
     delay(100);
@@ -0,0 +1,86 @@
+/*!
+ * @file nonBlocking.ino
+ * @brief This is a routine to read skylark data without blocking loop()
+ * ---------------------------------------------------------------------------------------------------------------
+ *    board   |             MCU                | Leonardo/Mega2560/M0 |    UNO    | ESP8266 | ESP32 |  microbit  |
+ *     VCC    |            3.3V/5V             |        VCC           |    VCC    |   VCC   |  VCC  |     X      |
+ *     GND    |              GND               |        GND           |    GND    |   GND   |  GND  |     X      |
+ *     RX     |              TX                |     Serial1 TX1      |     5     |   5/D6  |  D2   |     X      |
+ *     TX     |              RX                |     Serial1 RX1      |     4     |   4/D7  |  D3   |     X      |
+ * ---------------------------------------------------------------------------------------------------------------
+ * 
+ * @copyright    Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license      The MIT License (MIT)
+ * @author       [TangJie](jie.tang@dfrobot.com)
+ * @version      V1.0.0
+ * @date         2023-06-8
+ * @url         https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation.h"
+#if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+#include <SoftwareSerial.h>
+#endif
+#define DEVICE_ADDR                  0x42
+
+#define MODESWITCH        /*UART:*/1 /*I2C: 0*/
+
+#if MODESWITCH
+#if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+  SoftwareSerial mySerial(/*rx =*/4, /*tx =*/5);
+  DFRobot_LarkWeatherStation_UART atm(&mySerial);
+#else
+  DFRobot_LarkWeatherStation_UART atm(&Serial1);
+#endif
+#else
+DFRobot_LarkWeatherStation_I2C atm(DEVICE_ADDR,&Wire);
+#endif
+
+const char *key = "Temp";
+uint32_t lastBlink = 0;
+
+void setup(void){
+  #if MODESWITCH
+  //Init MCU communication serial port
+  #if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+    mySerial.begin(115200);
+  #elif defined(ESP32)
+    Serial1.begin(115200, SERIAL_8N1, /*rx =*/D3, /*tx =*/D2);
+  #else
+    Serial1.begin(115200);
+  #endif
+  #endif
+  Serial.begin(115200);
+  while(atm.begin()!= 0){
+    Serial.println("init error");
+    delay(1000);
+  }
+  Serial.println("init success");
+  pinMode(LED_BUILTIN, OUTPUT);
+  atm.startRequest(CMD_GET_DATA, key, strlen(key));
+}
+
+void loop(void){
+  uint16_t length;
+  const uint8_t *data;
+  switch(atm.poll()){
+    case eRequestDone:
+      data = atm.response(&length);
+      Serial.print("Temp: ");
+      Serial.write(data, length);
+      Serial.println();
+      atm.startRequest(CMD_GET_DATA, key, strlen(key));
+      break;
+    case eRequestError:
+      Serial.print("error: ");
+      Serial.println(atm.lastError());
+      atm.startRequest(CMD_GET_DATA, key, strlen(key));
+      break;
+    default:
+      break;
+  }
+  //Other work keeps running while the station answers
+  if(millis() - lastBlink > 500){
+    lastBlink = millis();
+    digitalWrite(LED_BUILTIN, !digitalRead(LED_BUILTIN));
+  }
+}
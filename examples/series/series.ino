@@ -0,0 +1,88 @@
+/*!
+ * @file series.ino
+ * @brief This is a routine to keep a compressed history of skylark samples and read back the last minute
+ * ---------------------------------------------------------------------------------------------------------------
+ *    board   |             MCU                | Leonardo/Mega2560/M0 |    UNO    | ESP8266 | ESP32 |  microbit  |
+ *     VCC    |            3.3V/5V             |        VCC           |    VCC    |   VCC   |  VCC  |     X      |
+ *     GND    |              GND               |        GND           |    GND    |   GND   |  GND  |     X      |
+ *     RX     |              TX                |     Serial1 TX1      |     5     |   5/D6  |  D2   |     X      |
+ *     TX     |              RX                |     Serial1 RX1      |     4     |   4/D7  |  D3   |     X      |
+ * ---------------------------------------------------------------------------------------------------------------
+ * 
+ * @copyright    Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license      The MIT License (MIT)
+ * @author       [TangJie](jie.tang@dfrobot.com)
+ * @version      V1.0.0
+ * @date         2023-06-8
+ * @url         https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation.h"
+#include "DFRobot_LarkWeatherStation_Series.h"
+#if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+#include <SoftwareSerial.h>
+#endif
+#define DEVICE_ADDR                  0x42
+#define HISTORY_BLOCKS               4      ///< The oldest block is reused when all are full
+
+#define MODESWITCH        /*UART:*/1 /*I2C: 0*/
+
+#if MODESWITCH
+#if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+  SoftwareSerial mySerial(/*rx =*/4, /*tx =*/5);
+  DFRobot_LarkWeatherStation_UART atm(&mySerial);
+#else
+  DFRobot_LarkWeatherStation_UART atm(&Serial1);
+#endif
+#else
+DFRobot_LarkWeatherStation_I2C atm(DEVICE_ADDR,&Wire);
+#endif
+
+uint8_t historyBuf[HISTORY_BLOCKS * LARK_SERIES_BLOCK_SIZE];
+DFRobot_LarkWeatherStation_Series history(historyBuf, HISTORY_BLOCKS);
+uint32_t lastReport = 0;
+
+void setup(void){
+  #if MODESWITCH
+  //Init MCU communication serial port
+  #if defined(ARDUINO_AVR_UNO)||defined(ESP8266)
+    mySerial.begin(115200);
+  #elif defined(ESP32)
+    Serial1.begin(115200, SERIAL_8N1, /*rx =*/D3, /*tx =*/D2);
+  #else
+    Serial1.begin(115200);
+  #endif
+  #endif
+  Serial.begin(115200);
+  while(atm.begin()!= 0){
+    Serial.println("init error");
+    delay(1000);
+  }
+  Serial.println("init success");
+  atm.startContinuous(1000);
+}
+
+void loop(void){
+  sSampleRecord_t record;
+  uint32_t stamp;
+  atm.runContinuous();
+  //Move new samples into the compressed history, a few bytes each
+  while(atm.drain(&record, 1, &stamp)){
+    history.append(stamp, record);
+  }
+  if(millis() - lastReport > 60000){
+    lastReport = millis();
+    Serial.print("samples: ");
+    Serial.print(history.samples());
+    Serial.print(" bytes: ");
+    Serial.println(history.bytes());
+    //Read back the last minute
+    history.seek(millis() - 60000);
+    while(history.next(&stamp, &record)){
+      Serial.print(stamp);
+      Serial.print(" Temp:");
+      Serial.print(record.temp / 100.0);
+      Serial.print(" Speed:");
+      Serial.println(record.speed / 100.0);
+    }
+  }
+}
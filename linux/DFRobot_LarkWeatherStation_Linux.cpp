@@ -0,0 +1,178 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Linux.cpp
+ * @brief Linux transports of DFRobot_LarkWeatherStation, termios UART and i2c-dev I2C
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+DFRobot_LarkWeatherStation_I2C::DFRobot_LarkWeatherStation_I2C(uint8_t addr, const char *device)
+  :DFRobot_LarkWeatherStation(),_device(device),_addr(addr),_fd(-1){}
+
+DFRobot_LarkWeatherStation_I2C::~DFRobot_LarkWeatherStation_I2C(){
+  if(_fd >= 0) close(_fd);
+}
+
+int DFRobot_LarkWeatherStation_I2C::init(uint32_t freq){
+  //Empty write, like beginTransmission()/endTransmission(): a read would take a byte of the station's output
+  struct i2c_msg msg = {_addr, 0, 0, NULL};
+  struct i2c_rdwr_ioctl_data rdwr = {&msg, 1};
+  (void)freq;
+  if(_fd < 0) _fd = open(_device, O_RDWR);
+  if(_fd < 0) return -1;
+  if(ioctl(_fd, I2C_RDWR, &rdwr) < 0) return -2;
+  return 0;
+}
+
+void DFRobot_LarkWeatherStation_I2C::sendPacket(void *pkt, int length, bool stop){
+  struct i2c_msg msg;
+  struct i2c_rdwr_ioctl_data rdwr;
+  (void)stop;
+  if((pkt == NULL) || (length == 0) || (_fd < 0)) return;
+  msg.addr = _addr;
+  msg.flags = 0;
+  msg.len = length;
+  msg.buf = (uint8_t *)pkt;
+  rdwr.msgs = &msg;
+  rdwr.nmsgs = 1;
+  if(ioctl(_fd, I2C_RDWR, &rdwr) < 0){
+    DBG("I2C write failed");
+  }
+}
+
+int DFRobot_LarkWeatherStation_I2C::recvData(void *data, int len){
+  uint8_t *pBuf = (uint8_t *)data;
+  struct i2c_msg msg;
+  struct i2c_rdwr_ioctl_data rdwr;
+  int total = 0;
+  if((pBuf == NULL) || (_fd < 0)){
+    DBG("pBuf ERROR!! : null pointer");
+    return 0;
+  }
+  while(total < len){
+    msg.addr = _addr;
+    msg.flags = I2C_M_RD;
+    msg.len = (len - total > LARK_I2C_CHUNK) ? LARK_I2C_CHUNK : len - total;
+    msg.buf = pBuf + total;
+    rdwr.msgs = &msg;
+    rdwr.nmsgs = 1;
+    if(ioctl(_fd, I2C_RDWR, &rdwr) < 0) break;
+    total += msg.len;
+  }
+  return total;
+}
+
+void DFRobot_LarkWeatherStation_I2C::recvFlush(){}
+
+void DFRobot_LarkWeatherStation_I2C::sendFlush(){}
+
+static speed_t baudConstant(uint32_t baud)
+{
+  switch(baud){
+    case 9600:   return B9600;
+    case 19200:  return B19200;
+    case 38400:  return B38400;
+    case 57600:  return B57600;
+    case 230400: return B230400;
+    case 460800: return B460800;
+    case 921600: return B921600;
+    default:     return B115200;
+  }
+}
+
+DFRobot_LarkWeatherStation_UART::DFRobot_LarkWeatherStation_UART(const char *device, uint32_t baud)
+  :DFRobot_LarkWeatherStation(),_device(device),_baud(baud),_fd(-1){}
+
+DFRobot_LarkWeatherStation_UART::~DFRobot_LarkWeatherStation_UART(){
+  if(_fd >= 0) close(_fd);
+}
+
+int DFRobot_LarkWeatherStation_UART::init(uint32_t freq){
+  struct termios tio;
+  (void)freq;
+  if(_fd < 0) _fd = open(_device, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if(_fd < 0) return -1;
+  if(tcgetattr(_fd, &tio) != 0) return -2;
+  cfmakeraw(&tio);
+  cfsetispeed(&tio, baudConstant(_baud));
+  cfsetospeed(&tio, baudConstant(_baud));
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cc[VMIN] = 0;
+  tio.c_cc[VTIME] = 0;
+  if(tcsetattr(_fd, TCSANOW, &tio) != 0) return -2;
+  tcflush(_fd, TCIOFLUSH);
+  return 0;
+}
+
+void DFRobot_LarkWeatherStation_UART::sendPacket(void *pkt, int length, bool stop){
+  uint8_t *pBuf = (uint8_t *)pkt;
+  struct pollfd pfd;
+  (void)stop;
+  if((pkt == NULL) || (length == 0) || (_fd < 0)) return;
+  while(length > 0){
+    ssize_t n = write(_fd, pBuf, length);
+    if(n > 0){
+      pBuf += n;
+      length -= n;
+    }else if((n < 0) && (errno != EAGAIN) && (errno != EINTR)){
+      DBG("serial write failed");
+      return;
+    }else{
+      pfd.fd = _fd;
+      pfd.events = POLLOUT;
+      ::poll(&pfd, 1, LARK_LINUX_UART_TIMEOUT_MS);
+    }
+  }
+}
+
+int DFRobot_LarkWeatherStation_UART::recvData(void *data, int len)
+{
+  uint8_t *pBuf = (uint8_t *)data;
+  struct pollfd pfd;
+  int total = 0;
+  uint32_t t = millis();
+  if((pBuf == NULL) || (_fd < 0)){
+    DBG("pBuf ERROR!! : null pointer");
+    return 0;
+  }
+  while((total < len) && (millis() - t < LARK_LINUX_UART_TIMEOUT_MS)){
+    ssize_t n = read(_fd, pBuf + total, len - total);
+    if(n > 0){
+      total += n;
+      continue;
+    }
+    if((n < 0) && (errno != EAGAIN) && (errno != EINTR)) break;
+    pfd.fd = _fd;
+    pfd.events = POLLIN;
+    ::poll(&pfd, 1, LARK_LINUX_UART_TIMEOUT_MS - (millis() - t));
+  }
+  return total;
+}
+
+int DFRobot_LarkWeatherStation_UART::recvAvailable(void)
+{
+  int n = 0;
+  if((_fd < 0) || (ioctl(_fd, FIONREAD, &n) < 0)) return 0;
+  return n;
+}
+
+void DFRobot_LarkWeatherStation_UART::recvFlush()
+{
+  if(_fd >= 0) tcflush(_fd, TCIFLUSH);
+}
+
+void DFRobot_LarkWeatherStation_UART::sendFlush(){
+  if(_fd >= 0) tcdrain(_fd);
+}
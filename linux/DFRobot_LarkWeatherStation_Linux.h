@@ -0,0 +1,145 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Linux.h
+ * @brief Linux transports of DFRobot_LarkWeatherStation, termios UART and i2c-dev I2C
+ * @n     Included by DFRobot_LarkWeatherStation.h when ARDUINO is not defined
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#ifndef _DFROBOT_LARKWEATHERSTATION_LINUX_H_
+#define _DFROBOT_LARKWEATHERSTATION_LINUX_H_
+
+#define LARK_LINUX_I2C_DEVICE       "/dev/i2c-1"    ///< Default I2C bus of Raspberry Pi class boards
+#define LARK_LINUX_UART_DEVICE      "/dev/ttyAMA0"  ///< Default UART of Raspberry Pi class boards
+#define LARK_LINUX_UART_TIMEOUT_MS  1000            ///< Longest wait of recvData(), same as Stream::readBytes()
+
+class DFRobot_LarkWeatherStation_I2C:public DFRobot_LarkWeatherStation {
+public:
+  /**
+   * @fn DFRobot_LarkWeatherStation_I2C
+   * @brief Constructor of the i2c-dev transport
+   *
+   * @param addr   7-bit I2C address
+   * @param device I2C bus device node
+   */
+  DFRobot_LarkWeatherStation_I2C(uint8_t addr = 0x42, const char *device = LARK_LINUX_I2C_DEVICE);
+  ~DFRobot_LarkWeatherStation_I2C();
+protected:
+  /**
+   * @fn init
+   * @brief Open the I2C bus and probe the device
+   *
+   * @param freq Unused, the bus speed is set by the kernel driver
+   * @return int Init status
+   * @n       0  Init successful
+   * @n      -1  The bus device could not be opened
+   * @n      -2  Check if the hardware connection is correct
+   */
+  int init(uint32_t freq);
+  /**
+   * @fn sendPacket
+   * @brief Send data in one I2C_RDWR write message
+   *
+   * @param pkt    Data pointer
+   * @param length Length of the data to be sent
+   * @param stop   Unused, every transfer ends with a stop condition
+   */
+  void sendPacket(void *pkt, int length, bool stop = true);
+  /**
+   * @fn recvData
+   * @brief Read data with I2C_RDWR read messages
+   *
+   * @param data    Received and stored data cache
+   * @param len     Byte number to be read
+   * @return Actually read byte number   
+   */
+  int recvData(void *data, int len);
+  /**
+   * @fn recvFlush
+   * @brief Clear receive cache, i2c-dev keeps no cache
+   */
+  void recvFlush();
+  /**
+   * @fn sendFlush
+   * @brief Clear send cache, i2c-dev keeps no cache
+   */
+  void sendFlush();
+private:
+  const char *_device;
+  uint8_t _addr;
+  int _fd;
+};
+
+class DFRobot_LarkWeatherStation_UART:public DFRobot_LarkWeatherStation {
+public:
+  /**
+   * @fn DFRobot_LarkWeatherStation_UART
+   * @brief Constructor of the termios transport
+   *
+   * @param device Serial device node
+   * @param baud   Baud rate
+   */
+  DFRobot_LarkWeatherStation_UART(const char *device = LARK_LINUX_UART_DEVICE, uint32_t baud = 115200);
+  ~DFRobot_LarkWeatherStation_UART();
+  /**
+   * @fn fd
+   * @brief File descriptor of the serial device, for poll()/epoll based event loops
+   *
+   * @return Descriptor, -1 before begin()
+   */
+  int fd(void){ return _fd; }
+protected:
+  /**
+   * @fn init
+   * @brief Open the serial device in raw mode
+   *
+   * @param freq Unused, the baud rate is passed to the constructor
+   * @return int Init status
+   * @n       0  Init successful
+   * @n      -1  The serial device could not be opened
+   * @n      -2  The serial device could not be configured
+   */
+  int init(uint32_t freq);
+  /**
+   * @fn sendPacket
+   * @brief Send data with one write
+   *
+   * @param pkt    Data pointer
+   * @param length Length of the data to be sent
+   * @param stop   Unused
+   */
+  void sendPacket(void *pkt, int length, bool stop = true);
+  /**
+   * @fn recvData
+   * @brief Read data, waits up to LARK_LINUX_UART_TIMEOUT_MS for missing bytes
+   *
+   * @param data    Received and stored data cache
+   * @param len     Byte number to be read
+   * @return Actually read byte number   
+   */
+  int recvData(void *data, int len);
+  /**
+   * @fn recvFlush
+   * @brief Discard received bytes
+   */
+  void recvFlush();
+  /**
+   * @fn sendFlush
+   * @brief Wait until every written byte has been transmitted
+   */
+  void sendFlush();
+  /**
+   * @fn recvAvailable
+   * @brief Byte number waiting in the kernel receive buffer
+   */
+  int recvAvailable(void);
+private:
+  const char *_device;
+  uint32_t _baud;
+  int _fd;
+};
+
+#endif
@@ -0,0 +1,92 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Port.cpp
+ * @brief Minimal Arduino runtime for building DFRobot_LarkWeatherStation on Linux
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation_Port.h"
+#include <stdio.h>
+#include <time.h>
+#include <sched.h>
+
+DFRobot_LinuxSerial Serial;
+
+static bool virtualClock = false;
+static uint64_t virtualUs = 0;
+
+void setVirtualClock(bool enable)
+{
+  virtualClock = enable;
+}
+
+static uint64_t monotonicUs(void)
+{
+  static uint64_t start = 0;
+  struct timespec ts;
+  if(virtualClock) return virtualUs;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t now = (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+  if(start == 0) start = now;
+  return now - start;
+}
+
+unsigned long millis(void)
+{
+  return (unsigned long)(monotonicUs() / 1000);
+}
+
+unsigned long micros(void)
+{
+  return (unsigned long)monotonicUs();
+}
+
+void delay(unsigned long ms)
+{
+  struct timespec ts;
+  if(virtualClock){
+    virtualUs += (uint64_t)ms * 1000;
+    return;
+  }
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000000L;
+  while(nanosleep(&ts, &ts) != 0){}
+}
+
+void yield(void)
+{
+  sched_yield();
+}
+
+size_t DFRobot_LinuxSerial::print(const char *str)
+{
+  return fputs(str, stdout) < 0 ? 0 : strlen(str);
+}
+
+size_t DFRobot_LinuxSerial::print(char c)
+{
+  return fputc(c, stdout) < 0 ? 0 : 1;
+}
+
+size_t DFRobot_LinuxSerial::print(long value)
+{
+  return printf("%ld", value);
+}
+
+size_t DFRobot_LinuxSerial::print(unsigned long value)
+{
+  return printf("%lu", value);
+}
+
+size_t DFRobot_LinuxSerial::print(double value, int digits)
+{
+  return printf("%.*f", digits, value);
+}
+
+size_t DFRobot_LinuxSerial::write(const uint8_t *data, size_t length)
+{
+  return fwrite(data, 1, length, stdout);
+}
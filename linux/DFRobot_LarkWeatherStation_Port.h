@@ -0,0 +1,94 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Port.h
+ * @brief Minimal Arduino runtime for building DFRobot_LarkWeatherStation on Linux
+ * @n     Supplies millis/micros/delay/yield, String and a Serial that writes to stdout
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#ifndef _DFROBOT_LARKWEATHERSTATION_PORT_H_
+#define _DFROBOT_LARKWEATHERSTATION_PORT_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <string>
+
+#define PI          3.1415926535897932384626433832795
+#define DEG_TO_RAD  0.017453292519943295769236907684886
+#define RAD_TO_DEG  57.295779513082320876798154814105
+
+#define PROGMEM                             ///< Constants stay in ordinary memory
+#define memcpy_P(dest, src, n)      memcpy((dest), (src), (n))
+#define pgm_read_byte(addr)         (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)         (*(const uint16_t *)(addr))
+
+/**
+ * @fn millis
+ * @brief Milliseconds since the program started, from the monotonic clock
+ */
+unsigned long millis(void);
+/**
+ * @fn micros
+ * @brief Microseconds since the program started, from the monotonic clock
+ */
+unsigned long micros(void);
+/**
+ * @fn delay
+ * @brief Sleep for ms milliseconds
+ */
+void delay(unsigned long ms);
+/**
+ * @fn yield
+ * @brief Give up the processor to other threads
+ */
+void yield(void);
+
+/**
+ * @fn setVirtualClock
+ * @brief Run millis/micros/delay on a simulated clock, delay() advances it instead of sleeping
+ * @n     Used by benchmarks and the simulator to model device timing without waiting for it
+ *
+ * @param enable true: simulated clock, false: monotonic clock
+ */
+void setVirtualClock(bool enable);
+
+/**
+ * @brief Arduino String on top of std::string, enough for the library API
+ */
+class String : public std::string {
+public:
+  String(){}
+  String(const char *str):std::string(str ? str : ""){}
+  String(const std::string &str):std::string(str){}
+  long toInt(void) const { return atol(c_str()); }
+  float toFloat(void) const { return atof(c_str()); }
+};
+
+/**
+ * @brief Serial replacement writing to stdout, used by DBG() and the examples
+ */
+class DFRobot_LinuxSerial {
+public:
+  void begin(unsigned long baud){ (void)baud; }
+  size_t print(const char *str);
+  size_t print(const std::string &str){ return print(str.c_str()); }
+  size_t print(char c);
+  size_t print(long value);
+  size_t print(unsigned long value);
+  size_t print(int value){ return print((long)value); }
+  size_t print(unsigned int value){ return print((unsigned long)value); }
+  size_t print(double value, int digits = 2);
+  template<typename T> size_t println(T value){ size_t n = print(value); return n + print('\n'); }
+  size_t println(double value, int digits){ size_t n = print(value, digits); return n + print('\n'); }
+  size_t println(void){ return print('\n'); }
+  size_t write(const uint8_t *data, size_t length);
+};
+extern DFRobot_LinuxSerial Serial;
+
+#endif
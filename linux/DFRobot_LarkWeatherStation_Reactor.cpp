@@ -0,0 +1,181 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Reactor.cpp
+ * @brief Single threaded epoll collector running the command exchanges of many UART stations concurrently
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation_Reactor.h"
+#include <errno.h>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+DFRobot_LarkWeatherStation_Reactor::DFRobot_LarkWeatherStation_Reactor(uint16_t capacity)
+  :wakeups(0),events(0),timers(0),completed(0),failed(0),
+   _epfd(-1),_capacity(capacity),_count(0),_wheelPos(0),_wheelTick(0),_armed(0),_finished(0)
+{
+  _stations = new sReactorStation_t[capacity];
+  memset(_wheel, 0, sizeof(_wheel));
+}
+
+DFRobot_LarkWeatherStation_Reactor::~DFRobot_LarkWeatherStation_Reactor()
+{
+  if(_epfd >= 0) close(_epfd);
+  delete[] _stations;
+}
+
+int DFRobot_LarkWeatherStation_Reactor::begin(void)
+{
+  if(_epfd < 0) _epfd = epoll_create1(EPOLL_CLOEXEC);
+  if(_epfd < 0) return -1;
+  _wheelTick = millis();
+  return 0;
+}
+
+int DFRobot_LarkWeatherStation_Reactor::add(DFRobot_LarkWeatherStation_UART *station, uint32_t periodMs, uint8_t cmd, const void *args, uint16_t len,
+                                            reactorHandler_t handler, void *ctx, uint32_t phaseMs)
+{
+  struct epoll_event ev;
+  sReactorStation_t *entry;
+  if((_epfd < 0) || (_count >= _capacity) || (station == NULL) || (station->fd() < 0)) return -1;
+  if((len > LARK_REACTOR_ARGS_MAX_LEN) || (cmd > CMD_END) || (periodMs == 0)) return -1;
+  entry = &_stations[_count];
+  memset(entry, 0, sizeof(sReactorStation_t));
+  entry->station = station;
+  entry->handler = handler;
+  entry->ctx = ctx;
+  entry->period = periodMs;
+  entry->cmd = cmd;
+  entry->len = len;
+  if(len) memcpy(entry->args, args, len);
+  entry->slot = -1;
+  //Edge triggered: bytes that arrive during the processing delay are picked up by the timer instead of waking the loop again
+  ev.events = EPOLLIN | EPOLLET;
+  ev.data.u32 = _count;
+  if(epoll_ctl(_epfd, EPOLL_CTL_ADD, station->fd(), &ev) < 0) return -1;
+  entry->nextStart = millis() + phaseMs;
+  arm(entry, phaseMs);
+  return _count++;
+}
+
+void DFRobot_LarkWeatherStation_Reactor::arm(sReactorStation_t *entry, uint32_t delayMs)
+{
+  //The wheel may lag behind millis() while a batch of events is handled
+  uint32_t ticks = delayMs + (millis() - _wheelTick);
+  if(ticks == 0) ticks = 1;
+  disarm(entry);
+  entry->slot = (_wheelPos + ticks) % LARK_REACTOR_WHEEL_SLOTS;
+  entry->rounds = (ticks - 1) / LARK_REACTOR_WHEEL_SLOTS;
+  entry->prev = NULL;
+  entry->next = _wheel[entry->slot];
+  if(entry->next) entry->next->prev = entry;
+  _wheel[entry->slot] = entry;
+  _armed++;
+}
+
+void DFRobot_LarkWeatherStation_Reactor::disarm(sReactorStation_t *entry)
+{
+  if(entry->slot < 0) return;
+  if(entry->prev){
+    entry->prev->next = entry->next;
+  }else{
+    _wheel[entry->slot] = entry->next;
+  }
+  if(entry->next) entry->next->prev = entry->prev;
+  entry->slot = -1;
+  _armed--;
+}
+
+void DFRobot_LarkWeatherStation_Reactor::advance(void)
+{
+  uint32_t now = millis();
+  while((int32_t)(now - _wheelTick) > 0){
+    sReactorStation_t *entry, *next;
+    _wheelTick++;
+    _wheelPos = (_wheelPos + 1) % LARK_REACTOR_WHEEL_SLOTS;
+    for(entry = _wheel[_wheelPos]; entry != NULL; entry = next){
+      next = entry->next;
+      if(entry->rounds){
+        entry->rounds--;
+        continue;
+      }
+      disarm(entry);
+      timers++;
+      service(entry, true);
+    }
+  }
+}
+
+int DFRobot_LarkWeatherStation_Reactor::nextTimeout(void)
+{
+  if(_armed == 0) return -1;
+  for(uint16_t i = 1; i <= LARK_REACTOR_WHEEL_SLOTS; i++){
+    if(_wheel[(_wheelPos + i) % LARK_REACTOR_WHEEL_SLOTS]) return i;
+  }
+  return LARK_REACTOR_WHEEL_SLOTS;
+}
+
+void DFRobot_LarkWeatherStation_Reactor::service(sReactorStation_t *entry, bool timer)
+{
+  DFRobot_LarkWeatherStation_UART *station = entry->station;
+  eRequestStatus_t status;
+  uint32_t delay;
+  if(!entry->busy){
+    //Bytes outside of an exchange are left for the next request to discard
+    if(!timer) return;
+    if(!station->startRequest(entry->cmd, entry->args, entry->len)){
+      arm(entry, entry->period);
+      return;
+    }
+    entry->busy = true;
+    entry->nextStart += entry->period;
+    if((int32_t)(entry->nextStart - millis()) < 0) entry->nextStart = millis() + entry->period;
+  }
+  status = station->poll();
+  if(status == eRequestBusy){
+    //Send and the status poll can finish in one go, keep going while nothing has to be waited for
+    while(((delay = station->pollDelay()) == 0) && ((status = station->poll()) == eRequestBusy)){}
+    if(status == eRequestBusy){
+      arm(entry, delay);
+      return;
+    }
+  }
+  entry->busy = false;
+  _finished++;
+  if(status == eRequestDone){
+    uint16_t length;
+    const uint8_t *data = station->response(&length);
+    completed++;
+    if(entry->handler) entry->handler(entry->ctx, station, status, data, length);
+  }else{
+    failed++;
+    if(entry->handler) entry->handler(entry->ctx, station, status, NULL, 0);
+  }
+  station->endRequest();
+  delay = entry->nextStart - millis();
+  arm(entry, ((int32_t)delay > 0) ? delay : 0);
+}
+
+int DFRobot_LarkWeatherStation_Reactor::run(int timeoutMs)
+{
+  struct epoll_event ev[LARK_REACTOR_MAX_EVENTS];
+  int timeout, n;
+  if(_epfd < 0) return -1;
+  _finished = 0;
+  advance();
+  timeout = nextTimeout();
+  if((timeout < 0) || ((timeoutMs >= 0) && (timeoutMs < timeout))) timeout = timeoutMs;
+  n = epoll_wait(_epfd, ev, LARK_REACTOR_MAX_EVENTS, timeout);
+  if(n < 0) return (errno == EINTR) ? 0 : -1;
+  wakeups++;
+  for(int i = 0; i < n; i++){
+    if(ev[i].data.u32 >= _count) continue;
+    events++;
+    service(&_stations[ev[i].data.u32], false);
+  }
+  advance();
+  return _finished;
+}
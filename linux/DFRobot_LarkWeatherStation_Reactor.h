@@ -0,0 +1,117 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Reactor.h
+ * @brief Single threaded epoll collector running the command exchanges of many UART stations concurrently
+ * @n     Every station has one timer in a hashed timer wheel, it starts the periodic request and bounds its
+ * @n     wait and timeout, received bytes advance the request through the epoll readiness of the serial device.
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#ifndef _DFROBOT_LARKWEATHERSTATION_REACTOR_H_
+#define _DFROBOT_LARKWEATHERSTATION_REACTOR_H_
+
+#include "DFRobot_LarkWeatherStation.h"
+
+#define LARK_REACTOR_WHEEL_SLOTS    512    ///< Slots of the timer wheel, one per ms
+#define LARK_REACTOR_MAX_EVENTS     64     ///< Readiness events handled per epoll_wait()
+#define LARK_REACTOR_ARGS_MAX_LEN   32     ///< Longest argument list of a periodic request
+
+/**
+ * @brief Called when the periodic request of a station finished
+ *
+ * @param ctx     Context passed to add()
+ * @param station Station of the request, lastError() tells why it failed
+ * @param status  eRequestDone or eRequestError
+ * @param data    NUL terminated payload, NULL on failure, valid during the call
+ * @param length  Byte number of the payload
+ */
+typedef void (*reactorHandler_t)(void *ctx, DFRobot_LarkWeatherStation_UART *station, eRequestStatus_t status, const uint8_t *data, uint16_t length);
+
+typedef struct sReactorStation{
+  DFRobot_LarkWeatherStation_UART *station;  /**< Transport and request state machine */
+  reactorHandler_t handler;                  /**< Completion callback */
+  void *ctx;                                 /**< Context of handler */
+  uint32_t period;                           /**< Time between two request starts */
+  uint32_t nextStart;                        /**< millis() the next request is due */
+  uint8_t cmd;                               /**< Command of the periodic request */
+  uint8_t args[LARK_REACTOR_ARGS_MAX_LEN];   /**< Arguments of the periodic request */
+  uint16_t len;                              /**< Byte number of args */
+  bool busy;                                 /**< A request is in progress */
+  struct sReactorStation *prev;              /**< Neighbours in the timer wheel slot */
+  struct sReactorStation *next;
+  uint32_t rounds;                           /**< Wheel revolutions left before the timer fires */
+  int16_t slot;                              /**< Wheel slot of the timer, -1 when not armed */
+}sReactorStation_t;
+
+class DFRobot_LarkWeatherStation_Reactor{
+public:
+  /**
+   * @fn DFRobot_LarkWeatherStation_Reactor
+   * @brief Constructor, the station table is allocated once here
+   *
+   * @param capacity Most stations that can be added
+   */
+  DFRobot_LarkWeatherStation_Reactor(uint16_t capacity = 256);
+  ~DFRobot_LarkWeatherStation_Reactor();
+  /**
+   * @fn begin
+   * @brief Create the epoll instance
+   *
+   * @return int Init status
+   * @n       0  Init successful
+   * @n      -1  epoll could not be created
+   */
+  int begin(void);
+  /**
+   * @fn add
+   * @brief Run a request on a station every periodMs
+   * @n     The station must have been started with begin(), it must not be used by other code afterwards
+   *
+   * @param station UART station
+   * @param periodMs Time between two request starts
+   * @param cmd     Command
+   * @param args    Command arguments, copied
+   * @param len     Byte number of the arguments, at most LARK_REACTOR_ARGS_MAX_LEN
+   * @param handler Called when each request finished
+   * @param ctx     Passed to handler
+   * @param phaseMs Delay of the first request, spreads stations over the period
+   * @return Station number, -1 if the table is full, the arguments are invalid or epoll refused the device
+   */
+  int add(DFRobot_LarkWeatherStation_UART *station, uint32_t periodMs, uint8_t cmd, const void *args, uint16_t len,
+          reactorHandler_t handler, void *ctx, uint32_t phaseMs = 0);
+  /**
+   * @fn run
+   * @brief Wait for readiness events or the next timer and run every due exchange step
+   *
+   * @param timeoutMs Longest wait, -1 waits until something is due
+   * @return Number of requests that finished, -1 if epoll failed
+   */
+  int run(int timeoutMs = -1);
+
+  uint32_t wakeups;     ///< Returns from epoll_wait()
+  uint32_t events;      ///< Readiness events handled
+  uint32_t timers;      ///< Timers fired
+  uint32_t completed;   ///< Requests that finished successfully
+  uint32_t failed;      ///< Requests that failed
+private:
+  void service(sReactorStation_t *entry, bool timer);
+  void arm(sReactorStation_t *entry, uint32_t delayMs);
+  void disarm(sReactorStation_t *entry);
+  void advance(void);
+  int nextTimeout(void);
+
+  int _epfd;
+  uint16_t _capacity;
+  uint16_t _count;
+  sReactorStation_t *_stations;
+  sReactorStation_t *_wheel[LARK_REACTOR_WHEEL_SLOTS];
+  uint16_t _wheelPos;    ///< Slot of _wheelTick
+  uint32_t _wheelTick;   ///< millis() up to which timers have been fired
+  uint32_t _armed;       ///< Timers in the wheel
+  uint32_t _finished;    ///< Requests finished during the current run()
+};
+
+#endif
@@ -0,0 +1,364 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Sim.cpp
+ * @brief Software Lark weather station speaking the I2C/UART command protocol
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation_Sim.h"
+#include <math.h>
+#include <stdio.h>
+
+#define CMD_PROJECT_MODE            0x0b
+
+static const char *sensorKeys[6] = {"Temp", "Humi", "Speed", "Dir", "Altitude", "Pressure"};
+static const char *sensorUnits[6] = {"C", "%RH", "m/s", "", "m", "hPa"};
+static const char compassPoints[16][4] = {"N","NNE","NE","ENE","E","ESE","SE","SSE","S","SSW","SW","WSW","W","WNW","NW","NNW"};
+
+static int sensorIndex(const char *key)
+{
+  for(uint8_t i = 0; i < 6; i++){
+    if(strcasecmp(key, sensorKeys[i]) == 0) return i;
+  }
+  return -1;
+}
+
+sSimConfig_t DFRobot_LarkWeatherStation_Device::defaultConfig(void)
+{
+  sSimConfig_t config;
+  config.uart = true;
+  config.latencyMs = 5;
+  config.baud = 0;
+  config.notReady = 0;
+  config.corruptRate = 0;
+  config.noiseRate = 0;
+  config.payloadSize = 0;
+  config.rtcDriftPpm = 0;
+  config.seed = 1;
+  return config;
+}
+
+DFRobot_LarkWeatherStation_Device::DFRobot_LarkWeatherStation_Device(const sSimConfig_t &config)
+  :frames(0),resets(0),corrupted(0),_rxLen(0),_txLen(0),_txPos(0),_txCorrupt(false),_notReady(0),_readyTick(0),
+   _rtcBase(0),_rtcTick(0),_radius(0),_speed1(0),_speed2(0)
+{
+  memset(_pinned, 0, sizeof(_pinned));
+  memset(_settings, 0, sizeof(_settings));
+  setConfig(config);
+}
+
+void DFRobot_LarkWeatherStation_Device::setConfig(const sSimConfig_t &config)
+{
+  _config = config;
+  _rng = config.seed ? config.seed : 1;
+  for(uint8_t i = 0; i <= CMD_END; i++) _latency[i] = config.latencyMs;
+}
+
+void DFRobot_LarkWeatherStation_Device::setLatency(uint8_t cmd, uint32_t latencyMs)
+{
+  if(cmd <= CMD_END) _latency[cmd] = latencyMs;
+}
+
+void DFRobot_LarkWeatherStation_Device::setValue(const char *key, const char *value)
+{
+  int i = sensorIndex(key);
+  if(i < 0) return;
+  if(value == NULL){
+    _pinned[i][0] = '\0';
+  }else{
+    strncpy(_pinned[i], value, sizeof(_pinned[i]) - 1);
+  }
+}
+
+uint32_t DFRobot_LarkWeatherStation_Device::nextRandom(void)
+{
+  _rng ^= _rng << 13;
+  _rng ^= _rng >> 17;
+  _rng ^= _rng << 5;
+  return _rng;
+}
+
+void DFRobot_LarkWeatherStation_Device::receive(const uint8_t *data, int length)
+{
+  for(int i = 0; i < length; i++){
+    if(_rxLen < sizeof(_rx)) _rx[_rxLen++] = data[i];
+    if(_rxLen < sizeof(sCmdSendPkt_t)) continue;
+    uint16_t argc = (_rx[2] << 8) | _rx[1];
+    if(sizeof(sCmdSendPkt_t) + argc > sizeof(_rx)){
+      _rxLen = 0;
+      continue;
+    }
+    if(_rxLen < sizeof(sCmdSendPkt_t) + argc) continue;
+    frames++;
+    process(_rx[0], _rx + sizeof(sCmdSendPkt_t), argc);
+    _rxLen = 0;
+  }
+}
+
+void DFRobot_LarkWeatherStation_Device::respond(uint8_t status, uint8_t cmd, const char *payload, uint16_t length)
+{
+  if(sizeof(sCmdRecvPkt_t) + length > sizeof(_tx)) length = sizeof(_tx) - sizeof(sCmdRecvPkt_t);
+  _tx[0] = status;
+  _tx[1] = cmd;
+  _tx[2] = length & 0xff;
+  _tx[3] = (length >> 8) & 0xff;
+  memcpy(_tx + sizeof(sCmdRecvPkt_t), payload, length);
+  _txLen = sizeof(sCmdRecvPkt_t) + length;
+  _txPos = 0;
+  _notReady = _config.notReady;
+  _txCorrupt = (_config.corruptRate > 0) && ((nextRandom() % 10000) < _config.corruptRate * 10000);
+  if(_config.uart && (_config.noiseRate > 0) && ((nextRandom() % 10000) < _config.noiseRate * 10000)){
+    //Line noise in front of the frame, retransmissions repeat it
+    uint8_t noise = 1 + nextRandom() % 4;
+    if(_txLen + noise > sizeof(_tx)) noise = 0;
+    memmove(_tx + noise, _tx, _txLen);
+    for(uint8_t i = 0; i < noise; i++) _tx[i] = nextRandom() & 0xff;
+    _txLen += noise;
+  }
+  _readyTick = millis() + _latency[cmd <= CMD_END ? cmd : 0];
+}
+
+const char *DFRobot_LarkWeatherStation_Device::sensorValue(const char *key, char *buf)
+{
+  int i = sensorIndex(key);
+  float t = millis() / 1000.0;
+  float pressure = 1013.25 + 2.0 * sin(t / 900.0);
+  if(i < 0) return NULL;
+  if(_pinned[i][0]) return _pinned[i];
+  switch(i){
+    case 0: sprintf(buf, "%.2f", 20.0 + 5.0 * sin(t / 600.0) + (nextRandom() % 100) / 1000.0); break;
+    case 1: sprintf(buf, "%.2f", 55.0 + 10.0 * sin(t / 450.0) + (nextRandom() % 100) / 1000.0); break;
+    case 2: sprintf(buf, "%.2f", fabs(3.0 + 2.5 * sin(t / 7.0)) + (nextRandom() % 50) / 100.0); break;
+    case 3: strcpy(buf, compassPoints[((uint32_t)(t / 5.0) + nextRandom() % 2) % 16]); break;
+    case 4: sprintf(buf, "%.2f", 44330.0 * (1.0 - pow(pressure / 1013.25, 0.1903)) + 50.0); break;
+    default: sprintf(buf, "%.2f", pressure); break;
+  }
+  return buf;
+}
+
+const char *DFRobot_LarkWeatherStation_Device::sensorUnit(const char *key)
+{
+  int i = sensorIndex(key);
+  return i < 0 ? NULL : sensorUnits[i];
+}
+
+uint64_t DFRobot_LarkWeatherStation_Device::rtcMillis(void)
+{
+  int64_t elapsed = (uint32_t)(millis() - _rtcTick);
+  return (_rtcBase + 946684800ULL) * 1000 + elapsed + elapsed * _config.rtcDriftPpm / 1000000;
+}
+
+void DFRobot_LarkWeatherStation_Device::timeText(char *buf)
+{
+  uint32_t secs = rtcMillis() / 1000 - 946684800UL;
+  uint32_t days = secs / 86400, rem = secs % 86400;
+  //Civil date from days since 2000-01-01
+  int32_t z = days + 10957 + 719468;
+  int32_t era = z / 146097;
+  uint32_t doe = z - era * 146097;
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t mp = (5 * doy + 2) / 153;
+  uint32_t day = doy - (153 * mp + 2) / 5 + 1;
+  uint32_t month = mp < 10 ? mp + 3 : mp - 9;
+  uint32_t year = yoe + era * 400 + (month <= 2);
+  sprintf(buf, "%04u/%02u/%02u %02u:%02u:%02u", (unsigned)year, (unsigned)month, (unsigned)day,
+          (unsigned)(rem / 3600), (unsigned)(rem % 3600 / 60), (unsigned)(rem % 60));
+}
+
+void DFRobot_LarkWeatherStation_Device::process(uint8_t cmd, const uint8_t *args, uint16_t length)
+{
+  char key[32], buf[SIM_FRAME_MAX_LEN - sizeof(sCmdRecvPkt_t)], value[24];
+  const char *text;
+  int n = 0;
+  uint8_t err = ERR_CODE_NONE;
+  switch(cmd){
+    case CMD_GET_DATA:
+    case CMD_GET_UNIT:
+      n = length < sizeof(key) - 1 ? length : sizeof(key) - 1;
+      memcpy(key, args, n);
+      key[n] = '\0';
+      text = (cmd == CMD_GET_DATA) ? sensorValue(key, value) : sensorUnit(key);
+      if(text == NULL){
+        err = ERR_CODE_ARGS;
+        break;
+      }
+      n = strlen(text);
+      memcpy(buf, text, n);
+      break;
+    case CMD_GET_ALL_DATA:
+      if(length && args[0]){
+        timeText(buf);
+        n = strlen(buf);
+        buf[n++] = ',';
+      }
+      for(uint8_t i = 0; i < 6; i++){
+        n += sprintf(buf + n, "%s%s:%s", i ? "," : "", sensorKeys[i], sensorValue(sensorKeys[i], value));
+      }
+      for(uint16_t i = 0; (n < _config.payloadSize) && (n < (int)sizeof(buf) - 16); i++){
+        n += sprintf(buf + n, ",Ext%u:0", i);
+      }
+      break;
+    case CMD_SET_TIME:{
+      if(length < 7){
+        err = ERR_CODE_ARGS;
+        break;
+      }
+      //Days since 2000-01-01 of the given date
+      int32_t y = 2000 + args[0] - (args[1] <= 2);
+      int32_t era = y / 400;
+      uint32_t yoe = y - era * 400;
+      uint32_t doy = (153 * (args[1] + (args[1] > 2 ? -3 : 9)) + 2) / 5 + args[2] - 1;
+      uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+      int32_t days = era * 146097 + doe - 719468 - 10957;
+      _rtcBase = days * 86400 + args[4] * 3600 + args[5] * 60 + args[6];
+      _rtcTick = millis();
+      break;
+    }
+    case CME_GET_TIME:
+      timeText(buf);
+      n = strlen(buf);
+      break;
+    case CMD_GET_VERSION:
+      n = sprintf(buf, "V1.0");
+      break;
+    case CMD_RESET_DATA:
+      //Retransmit the last response from its first byte
+      resets++;
+      if(_txLen){
+        _txPos = 0;
+        _notReady = 0;
+        _txCorrupt = false;
+        _readyTick = millis();
+      }
+      return;
+    case CMD_RADIUS_DATA:
+    case CMD_SPEED1_DATA:
+    case CMD_SPEED2_DATA:
+      if(length < 2){
+        err = ERR_CODE_ARGS;
+        break;
+      }
+      if(cmd == CMD_RADIUS_DATA) _radius = ((args[0] << 8) | args[1]) / 100.0;
+      if(cmd == CMD_SPEED1_DATA) _speed1 = ((args[0] << 8) | args[1]) / 100.0;
+      if(cmd == CMD_SPEED2_DATA) _speed2 = ((args[0] << 8) | args[1]) / 100.0;
+      break;
+    case CMD_CALIBRATOR:
+      if((_radius == 0) || (_speed1 == _speed2)){
+        err = ERR_CODE_ARGS;
+        break;
+      }
+      n = sprintf(buf, "Radius:%.2f,K:%.4f,B:%.4f", _radius, (_speed2 - _speed1) / (_speed2 + _speed1) + 1.0, _speed1 * 0.01);
+      break;
+    case CMD_PROJECT_MODE:
+      return;
+    case CMD_DTU:
+    case CMD_WIFI:
+    case CMD_LORA:
+    case CMD_MQTT1:
+    case CMD_MQTT2:
+    case CMD_TOP:
+      n = length < sizeof(_settings[0]) - 1 ? length : sizeof(_settings[0]) - 1;
+      memcpy(_settings[cmd - CMD_DTU], args, n);
+      _settings[cmd - CMD_DTU][n] = '\0';
+      n = 0;
+      break;
+    default:
+      err = ERR_CODE_CMD_INVAILED;
+      break;
+  }
+  if(err != ERR_CODE_NONE){
+    char code = err;
+    respond(STATUS_FAILED, cmd, &code, 1);
+  }else{
+    respond(STATUS_SUCCESS, cmd, buf, n);
+  }
+}
+
+bool DFRobot_LarkWeatherStation_Device::pending(void)
+{
+  return _txPos < _txLen;
+}
+
+uint32_t DFRobot_LarkWeatherStation_Device::readyAt(void)
+{
+  uint32_t tick = _readyTick;
+  if(_config.baud) tick += (uint32_t)((uint64_t)_txPos * 10000 / _config.baud);
+  return tick;
+}
+
+int DFRobot_LarkWeatherStation_Device::available(void)
+{
+  int32_t elapsed = millis() - _readyTick;
+  if(!pending() || (elapsed < 0)) return 0;
+  if(!_config.uart && _notReady) return 1;
+  if(_config.baud == 0) return _txLen - _txPos;
+  uint32_t sent = (uint64_t)elapsed * _config.baud / 10000 + 1;
+  if(sent > _txLen) sent = _txLen;
+  return sent > _txPos ? sent - _txPos : 0;
+}
+
+int DFRobot_LarkWeatherStation_Device::transmit(uint8_t *data, int length)
+{
+  int n = 0;
+  if(!_config.uart && pending() && ((int32_t)(millis() - _readyTick) >= 0) && _notReady){
+    //Each read transaction answered while the device still pretends to be busy counts once
+    _notReady--;
+    memset(data, 0xff, length);
+    return length;
+  }
+  while(n < length){
+    if(!_config.uart && ((int32_t)(millis() - _readyTick) < 0 || !pending())){
+      //A polled I2C device answers 0xff while it has nothing to send
+      data[n++] = 0xff;
+      continue;
+    }
+    if(_config.uart && (available() < 1)) break;
+    if(!pending()) break;
+    if((_txPos == 0) && _txCorrupt){
+      //Garbage in place of the status byte, the host answers with CMD_RESET_DATA
+      corrupted++;
+      _txCorrupt = false;
+      _txPos = _txLen;
+      data[n++] = 0xd3;
+      continue;
+    }
+    data[n++] = _tx[_txPos++];
+  }
+  return n;
+}
+
+DFRobot_LarkWeatherStation_Sim::DFRobot_LarkWeatherStation_Sim(const sSimConfig_t &config)
+  :DFRobot_LarkWeatherStation(),bytesSent(0),bytesRecv(0),reads(0),_device(config){}
+
+DFRobot_LarkWeatherStation_Sim::~DFRobot_LarkWeatherStation_Sim(){}
+
+int DFRobot_LarkWeatherStation_Sim::init(uint32_t freq){
+  (void)freq;
+  return 0;
+}
+
+void DFRobot_LarkWeatherStation_Sim::sendPacket(void *pkt, int length, bool stop){
+  (void)stop;
+  bytesSent += length;
+  _device.receive((const uint8_t *)pkt, length);
+}
+
+int DFRobot_LarkWeatherStation_Sim::recvData(void *data, int len){
+  int n = _device.transmit((uint8_t *)data, len);
+  bytesRecv += n;
+  if(!_device.uart()) reads += (len + LARK_I2C_CHUNK - 1) / LARK_I2C_CHUNK;
+  return n;
+}
+
+int DFRobot_LarkWeatherStation_Sim::recvAvailable(void){
+  if(!_device.uart()) return 0x7fff;
+  return _device.available();
+}
+
+void DFRobot_LarkWeatherStation_Sim::recvFlush(){}
+
+void DFRobot_LarkWeatherStation_Sim::sendFlush(){}
@@ -0,0 +1,155 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Sim.h
+ * @brief Software Lark weather station speaking the I2C/UART command protocol, for tests and benchmarks without hardware
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#ifndef _DFROBOT_LARKWEATHERSTATION_SIM_H_
+#define _DFROBOT_LARKWEATHERSTATION_SIM_H_
+
+#include "DFRobot_LarkWeatherStation.h"
+
+#define SIM_FRAME_MAX_LEN           2048   ///< Longest request or response frame of the simulator
+
+typedef struct{
+  bool uart;             /**< true: UART framing, nothing is readable before the response is ready; false: I2C, 0xff is read */
+  uint32_t latencyMs;    /**< Processing time of every command, see DFRobot_LarkWeatherStation_Device::setLatency() */
+  uint32_t baud;         /**< UART line rate limiting how fast response bytes become readable, 0 for instant */
+  uint8_t notReady;      /**< Extra all-0xff status reads answered after the response is ready (I2C only) */
+  float corruptRate;     /**< Probability that a response starts with a garbage status byte, 0..1 */
+  float noiseRate;       /**< Probability that 1 to 4 random bytes precede a response, as on RS-485 bridges (UART only), 0..1 */
+  uint16_t payloadSize;  /**< Pad CMD_GET_ALL_DATA responses to at least this many bytes with extension fields */
+  int32_t rtcDriftPpm;   /**< Rate error of the RTC in parts per million, positive runs fast */
+  uint32_t seed;         /**< Seed of the pseudo random generator */
+}sSimConfig_t;
+
+/**
+ * @brief Device side of the protocol, fed with request bytes and drained of response bytes
+ */
+class DFRobot_LarkWeatherStation_Device{
+public:
+  /**
+   * @fn defaultConfig
+   * @brief Configuration of a well behaved station: UART, 5 ms latency, no errors
+   */
+  static sSimConfig_t defaultConfig(void);
+
+  DFRobot_LarkWeatherStation_Device(const sSimConfig_t &config = defaultConfig());
+  /**
+   * @fn setConfig
+   * @brief Change the behaviour, the per-command latencies are reset to config.latencyMs
+   */
+  void setConfig(const sSimConfig_t &config);
+  /**
+   * @fn setLatency
+   * @brief Set the processing time of one command
+   */
+  void setLatency(uint8_t cmd, uint32_t latencyMs);
+  /**
+   * @fn setValue
+   * @brief Pin a sensor to a fixed value, its simulated waveform is no longer used
+   *
+   * @param key   Temp, Humi, Speed, Dir, Altitude or Pressure
+   * @param value Value text returned by CMD_GET_DATA, NULL releases the key
+   */
+  void setValue(const char *key, const char *value);
+  /**
+   * @fn receive
+   * @brief Bytes written by the host
+   */
+  void receive(const uint8_t *data, int length);
+  /**
+   * @fn transmit
+   * @brief Bytes read by the host
+   *
+   * @return Byte number stored in data, in I2C mode always length
+   */
+  int transmit(uint8_t *data, int length);
+  /**
+   * @fn available
+   * @brief Byte number the host can read now
+   */
+  int available(void);
+  /**
+   * @fn pending
+   * @brief Whether a response is waiting to be read
+   */
+  bool pending(void);
+  /**
+   * @fn readyAt
+   * @brief millis() at which the next response byte becomes readable
+   */
+  uint32_t readyAt(void);
+  /**
+   * @fn rtcMillis
+   * @brief RTC time now in ms since 1970-01-01, drift included, the reference of clock checks
+   */
+  uint64_t rtcMillis(void);
+  /**
+   * @fn uart
+   * @brief Whether the device uses UART framing
+   */
+  bool uart(void){ return _config.uart; }
+
+  uint32_t frames;       ///< Request frames received
+  uint32_t resets;       ///< CMD_RESET_DATA retransmits
+  uint32_t corrupted;    ///< Responses that started with a garbage status byte
+
+protected:
+  void process(uint8_t cmd, const uint8_t *args, uint16_t length);
+  void respond(uint8_t status, uint8_t cmd, const char *payload, uint16_t length);
+  const char *sensorValue(const char *key, char *buf);
+  const char *sensorUnit(const char *key);
+  void timeText(char *buf);
+  uint32_t nextRandom(void);
+
+  sSimConfig_t _config;
+  uint32_t _latency[CMD_END + 1];
+  uint8_t _rx[SIM_FRAME_MAX_LEN];
+  uint16_t _rxLen;
+  uint8_t _tx[SIM_FRAME_MAX_LEN];
+  uint16_t _txLen;
+  uint16_t _txPos;
+  bool _txCorrupt;
+  uint8_t _notReady;
+  uint32_t _readyTick;
+  uint32_t _rng;
+  uint32_t _rtcBase;     ///< RTC seconds since 2000-01-01 at _rtcTick
+  uint32_t _rtcTick;
+  float _radius, _speed1, _speed2;
+  char _pinned[6][16];   ///< Values set with setValue(), empty when simulated
+  char _settings[CMD_TOP - CMD_DTU + 1][64]; ///< Last CMD_DTU..CMD_TOP arguments
+};
+
+/**
+ * @brief Transport running DFRobot_LarkWeatherStation against an in-process DFRobot_LarkWeatherStation_Device
+ */
+class DFRobot_LarkWeatherStation_Sim:public DFRobot_LarkWeatherStation {
+public:
+  DFRobot_LarkWeatherStation_Sim(const sSimConfig_t &config = DFRobot_LarkWeatherStation_Device::defaultConfig());
+  ~DFRobot_LarkWeatherStation_Sim();
+  /**
+   * @fn device
+   * @brief The simulated station, to change its behaviour or read its counters
+   */
+  DFRobot_LarkWeatherStation_Device &device(void){ return _device; }
+
+  uint32_t bytesSent;    ///< Bytes written by the driver
+  uint32_t bytesRecv;    ///< Bytes read by the driver
+  uint32_t reads;        ///< I2C read transactions, recvData() split at LARK_I2C_CHUNK
+protected:
+  int init(uint32_t freq);
+  void sendPacket(void *pkt, int length, bool stop = true);
+  int recvData(void *data, int len);
+  void recvFlush();
+  void sendFlush();
+  int recvAvailable(void);
+private:
+  DFRobot_LarkWeatherStation_Device _device;
+};
+
+#endif
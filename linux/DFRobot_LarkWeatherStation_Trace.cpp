@@ -0,0 +1,350 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Trace.cpp
+ * @brief Wire-level capture of a DFRobot_LarkWeatherStation transport and deterministic replay of the trace
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "linux/DFRobot_LarkWeatherStation_Trace.h"
+
+static const uint8_t traceHeader[LARK_TRACE_HEADER_LEN] = {'L', 'K', 'T', LARK_TRACE_VERSION};
+
+static uint8_t putVarint(uint8_t *buf, uint64_t value)
+{
+  uint8_t n = 0;
+  while(value >= 0x80){
+    buf[n++] = (value & 0x7f) | 0x80;
+    value >>= 7;
+  }
+  buf[n++] = value;
+  return n;
+}
+
+DFRobot_LarkWeatherStation_TraceReader::DFRobot_LarkWeatherStation_TraceReader()
+  :_trace(NULL),_length(0),_pos(0),_time(0)
+{
+}
+
+bool DFRobot_LarkWeatherStation_TraceReader::begin(const uint8_t *trace, size_t length)
+{
+  _trace = trace;
+  _length = length;
+  _pos = LARK_TRACE_HEADER_LEN;
+  _time = 0;
+  if((trace == NULL) || (length < LARK_TRACE_HEADER_LEN) || memcmp(trace, traceHeader, LARK_TRACE_HEADER_LEN)){
+    _length = 0;
+    return false;
+  }
+  return true;
+}
+
+bool DFRobot_LarkWeatherStation_TraceReader::varint(uint64_t *value)
+{
+  uint8_t shift = 0;
+  *value = 0;
+  while((_pos < _length) && (shift < 64)){
+    uint8_t byte = _trace[_pos++];
+    *value |= (uint64_t)(byte & 0x7f) << shift;
+    if(!(byte & 0x80)) return true;
+    shift += 7;
+  }
+  return false;
+}
+
+bool DFRobot_LarkWeatherStation_TraceReader::next(sTraceRecord_t *record)
+{
+  uint64_t delta, value = 0, length = 0;
+  if(_pos >= _length) return false;
+  record->type = _trace[_pos++];
+  if(!varint(&delta)) return false;
+  switch(record->type){
+    case eTraceInit:
+      if(!varint(&value)) return false;
+      //Zigzag, init() returns negative codes
+      record->value = (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+      break;
+    case eTraceRecv:
+      if(!varint(&value)) return false;
+      record->value = value;
+      // fall through
+    case eTraceSend:
+    case eTraceSendNoStop:
+      if(!varint(&length) || (length > 0xffff) || (length > _length - _pos)) return false;
+      if(record->type != eTraceRecv) record->value = length;
+      break;
+    case eTraceAvailable:
+      if(!varint(&value)) return false;
+      record->value = value;
+      break;
+    case eTraceRecvFlush:
+    case eTraceSendFlush:
+      record->value = 0;
+      break;
+    default:
+      return false;
+  }
+  _time += delta;
+  record->time = _time;
+  record->length = length;
+  record->data = _trace + _pos;
+  _pos += length;
+  return true;
+}
+
+DFRobot_LarkWeatherStation_Capture::DFRobot_LarkWeatherStation_Capture(DFRobot_LarkWeatherStation *transport)
+  :DFRobot_LarkWeatherStation(),records(0),bytes(0),_transport(transport),_file(NULL),_last(0),_started(false){}
+
+DFRobot_LarkWeatherStation_Capture::~DFRobot_LarkWeatherStation_Capture()
+{
+  close();
+}
+
+bool DFRobot_LarkWeatherStation_Capture::open(const char *path)
+{
+  close();
+  _file = fopen(path, "wb");
+  if(_file == NULL) return false;
+  fwrite(traceHeader, 1, sizeof(traceHeader), _file);
+  records = 0;
+  bytes = sizeof(traceHeader);
+  _started = false;
+  return true;
+}
+
+void DFRobot_LarkWeatherStation_Capture::close(void)
+{
+  if(_file == NULL) return;
+  fclose(_file);
+  _file = NULL;
+}
+
+void DFRobot_LarkWeatherStation_Capture::record(uint8_t type, int32_t value, const void *data, int length)
+{
+  //Type, time delta and up to two numbers
+  uint8_t buf[1 + 10 + 5 + 5];
+  uint8_t n = 0;
+  uint64_t now = micros();
+  if(_file == NULL) return;
+  if(!_started){
+    _started = true;
+    _last = now;
+  }
+  if(length < 0) length = 0;
+  buf[n++] = type;
+  n += putVarint(buf + n, now - _last);
+  _last = now;
+  switch(type){
+    case eTraceInit:
+      n += putVarint(buf + n, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+      break;
+    case eTraceRecv:
+      n += putVarint(buf + n, value < 0 ? 0 : value);
+      // fall through
+    case eTraceSend:
+    case eTraceSendNoStop:
+      n += putVarint(buf + n, length);
+      break;
+    case eTraceAvailable:
+      n += putVarint(buf + n, value < 0 ? 0 : value);
+      break;
+  }
+  fwrite(buf, 1, n, _file);
+  if(length) fwrite(data, 1, length, _file);
+  records++;
+  bytes += n + length;
+}
+
+int DFRobot_LarkWeatherStation_Capture::init(uint32_t freq)
+{
+  int ret = _transport->init(freq);
+  record(eTraceInit, ret, NULL, 0);
+  return ret;
+}
+
+void DFRobot_LarkWeatherStation_Capture::sendPacket(void *pkt, int length, bool stop)
+{
+  record(stop ? eTraceSend : eTraceSendNoStop, 0, pkt, length);
+  _transport->sendPacket(pkt, length, stop);
+}
+
+int DFRobot_LarkWeatherStation_Capture::recvData(void *data, int len)
+{
+  int n = _transport->recvData(data, len);
+  record(eTraceRecv, len, data, n);
+  return n;
+}
+
+void DFRobot_LarkWeatherStation_Capture::recvFlush()
+{
+  _transport->recvFlush();
+  record(eTraceRecvFlush, 0, NULL, 0);
+}
+
+void DFRobot_LarkWeatherStation_Capture::sendFlush()
+{
+  _transport->sendFlush();
+  record(eTraceSendFlush, 0, NULL, 0);
+}
+
+int DFRobot_LarkWeatherStation_Capture::recvAvailable(void)
+{
+  int n = _transport->recvAvailable();
+  record(eTraceAvailable, n, NULL, 0);
+  return n;
+}
+
+DFRobot_LarkWeatherStation_Replay::DFRobot_LarkWeatherStation_Replay()
+  :DFRobot_LarkWeatherStation(),mismatches(0),_hasNext(false),_used(0),_polled(false),_speed(1),_start(0),_started(false)
+{
+}
+
+bool DFRobot_LarkWeatherStation_Replay::load(const char *path)
+{
+  std::vector<uint8_t> trace;
+  uint8_t buf[4096];
+  size_t n;
+  FILE *file = fopen(path, "rb");
+  if(file == NULL) return false;
+  while((n = fread(buf, 1, sizeof(buf), file)) > 0) trace.insert(trace.end(), buf, buf + n);
+  fclose(file);
+  return load(trace.data(), trace.size());
+}
+
+bool DFRobot_LarkWeatherStation_Replay::load(const uint8_t *trace, size_t length)
+{
+  DFRobot_LarkWeatherStation_TraceReader reader;
+  if(!reader.begin(trace, length)) return false;
+  _trace.assign(trace, trace + length);
+  rewind();
+  return true;
+}
+
+void DFRobot_LarkWeatherStation_Replay::rewind(void)
+{
+  _reader.begin(_trace.data(), _trace.size());
+  _hasNext = false;
+  _used = 0;
+  _polled = false;
+  _started = false;
+  mismatches = 0;
+}
+
+void DFRobot_LarkWeatherStation_Replay::setSpeed(float speed)
+{
+  _speed = speed;
+}
+
+bool DFRobot_LarkWeatherStation_Replay::finished(void)
+{
+  return !peek();
+}
+
+DFRobot_LarkWeatherStation_TraceReader DFRobot_LarkWeatherStation_Replay::trace(void)
+{
+  DFRobot_LarkWeatherStation_TraceReader reader;
+  reader.begin(_trace.data(), _trace.size());
+  return reader;
+}
+
+bool DFRobot_LarkWeatherStation_Replay::peek(void)
+{
+  if(!_started){
+    _started = true;
+    _start = micros();
+  }
+  //Availability follows from the recorded reads, flushes change nothing here
+  while(!_hasNext || (_next.type == eTraceAvailable) || (_next.type == eTraceRecvFlush) || (_next.type == eTraceSendFlush)){
+    if(_hasNext && (_next.type == eTraceAvailable)) _polled = _next.value >= 0x7fff;
+    _hasNext = _reader.next(&_next);
+    _used = 0;
+    if(!_hasNext) return false;
+  }
+  return true;
+}
+
+bool DFRobot_LarkWeatherStation_Replay::seek(uint8_t type)
+{
+  bool skipped = false;
+  while(peek()){
+    if((_next.type == type) || ((type == eTraceSend) && (_next.type == eTraceSendNoStop))) break;
+    skipped = true;
+    _hasNext = false;
+  }
+  if(skipped) mismatches++;
+  return _hasNext;
+}
+
+void DFRobot_LarkWeatherStation_Replay::waitFor(uint64_t time)
+{
+  uint64_t due, elapsed;
+  if(_speed <= 0) return;
+  due = time / _speed;
+  elapsed = micros() - _start;
+  if(due > elapsed) delay((due - elapsed + 999) / 1000);
+}
+
+int DFRobot_LarkWeatherStation_Replay::init(uint32_t freq)
+{
+  int ret;
+  (void)freq;
+  if(!peek() || (_next.type != eTraceInit)) return 0;
+  ret = _next.value;
+  _hasNext = false;
+  return ret;
+}
+
+void DFRobot_LarkWeatherStation_Replay::sendPacket(void *pkt, int length, bool stop)
+{
+  (void)stop;
+  if(!seek(eTraceSend)){
+    mismatches++;
+    return;
+  }
+  if((_next.length != length) || memcmp(_next.data, pkt, length)) mismatches++;
+  _hasNext = false;
+}
+
+int DFRobot_LarkWeatherStation_Replay::recvData(void *data, int len)
+{
+  uint8_t *buf = (uint8_t *)data;
+  int n = 0, chunk;
+  //Reads of another size than recorded take bytes across records
+  while((n < len) && peek() && (_next.type == eTraceRecv)){
+    waitFor(_next.time);
+    chunk = _next.length - _used;
+    if(chunk > len - n) chunk = len - n;
+    memcpy(buf + n, _next.data + _used, chunk);
+    n += chunk;
+    _used += chunk;
+    if(_used >= _next.length){
+      _hasNext = false;
+      //The recorded read returned less than asked for as well, e.g. a UART timeout
+      if(_next.length < _next.value) return n;
+    }
+  }
+  if(n < len){
+    if(_polled){
+      //A polled device answers 0xff while it has nothing to send
+      memset(buf + n, 0xff, len - n);
+      n = len;
+    }
+    mismatches++;
+  }
+  return n;
+}
+
+int DFRobot_LarkWeatherStation_Replay::recvAvailable(void)
+{
+  if(!peek()) return _polled ? 0x7fff : 0;
+  if(_polled) return 0x7fff;
+  if(_next.type != eTraceRecv) return 0;
+  if((_speed > 0) && (_next.time / _speed > micros() - _start)) return 0;
+  return _next.length - _used;
+}
+
+void DFRobot_LarkWeatherStation_Replay::recvFlush(){}
+
+void DFRobot_LarkWeatherStation_Replay::sendFlush(){}
@@ -0,0 +1,184 @@
+/*!
+ * @file  DFRobot_LarkWeatherStation_Trace.h
+ * @brief Wire-level capture of a DFRobot_LarkWeatherStation transport and deterministic replay of the trace
+ * @n     A trace is "LKT" plus a version byte, then one record per transport call: the call type, the time since
+ * @n     the previous record in us and the bytes moved, numbers as LEB128 varints. A UART exchange costs about
+ * @n     its own bytes plus a dozen bytes of records.
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#ifndef _DFROBOT_LARKWEATHERSTATION_TRACE_H_
+#define _DFROBOT_LARKWEATHERSTATION_TRACE_H_
+
+#include "DFRobot_LarkWeatherStation.h"
+#include <stdio.h>
+#include <vector>
+
+#define LARK_TRACE_VERSION          1      ///< Record coding of the trace
+#define LARK_TRACE_HEADER_LEN       4      ///< "LKT" and the version
+
+/**
+ * @enum eTraceRecord_t
+ * @brief Transport call of a trace record
+ */
+typedef enum{
+  eTraceInit = 1,     /**< init(), value is its result */
+  eTraceSend,         /**< sendPacket() with stop, data are the bytes sent */
+  eTraceSendNoStop,   /**< sendPacket() without stop */
+  eTraceRecv,         /**< recvData(), value is the requested length, data are the bytes returned */
+  eTraceAvailable,    /**< recvAvailable(), value is its result */
+  eTraceRecvFlush,    /**< recvFlush() */
+  eTraceSendFlush,    /**< sendFlush() */
+}eTraceRecord_t;
+
+typedef struct{
+  uint8_t type;          /**< eTraceRecord_t */
+  uint64_t time;         /**< us since the first record */
+  int32_t value;         /**< See eTraceRecord_t */
+  uint16_t length;       /**< Byte number of data */
+  const uint8_t *data;   /**< Points into the trace */
+}sTraceRecord_t;
+
+/**
+ * @brief Decodes the records of a trace in memory
+ */
+class DFRobot_LarkWeatherStation_TraceReader{
+public:
+  DFRobot_LarkWeatherStation_TraceReader();
+  /**
+   * @fn begin
+   * @brief Start reading a trace at its first record
+   * @return Whether the trace header is valid
+   */
+  bool begin(const uint8_t *trace, size_t length);
+  /**
+   * @fn next
+   * @brief Decode the next record
+   * @return Whether a complete record was left
+   */
+  bool next(sTraceRecord_t *record);
+private:
+  bool varint(uint64_t *value);
+
+  const uint8_t *_trace;
+  size_t _length;
+  size_t _pos;
+  uint64_t _time;
+};
+
+/**
+ * @brief Station that forwards every transport call to another station and records it
+ * @n     Use it in place of the wrapped station, e.g. capture.begin() and capture.getValue()
+ */
+class DFRobot_LarkWeatherStation_Capture:public DFRobot_LarkWeatherStation {
+public:
+  /**
+   * @fn DFRobot_LarkWeatherStation_Capture
+   * @brief Constructor
+   *
+   * @param transport Station whose transport is used, e.g. a DFRobot_LarkWeatherStation_UART
+   */
+  DFRobot_LarkWeatherStation_Capture(DFRobot_LarkWeatherStation *transport);
+  ~DFRobot_LarkWeatherStation_Capture();
+  /**
+   * @fn open
+   * @brief Start writing the trace to a file, calls are forwarded without recording otherwise
+   * @return Whether the file was created
+   */
+  bool open(const char *path);
+  /**
+   * @fn close
+   * @brief Flush and close the trace file
+   */
+  void close(void);
+
+  uint32_t records;      ///< Records written
+  uint32_t bytes;        ///< Trace bytes written, including the header
+protected:
+  int init(uint32_t freq);
+  void sendPacket(void *pkt, int length, bool stop = true);
+  int recvData(void *data, int len);
+  void recvFlush();
+  void sendFlush();
+  int recvAvailable(void);
+private:
+  void record(uint8_t type, int32_t value, const void *data, int length);
+
+  DFRobot_LarkWeatherStation *_transport;
+  FILE *_file;
+  uint64_t _last;        ///< micros() of the previous record
+  bool _started;
+};
+
+/**
+ * @brief Station answering from a trace instead of a device
+ * @n     Responses are read back in the recorded order, not before their recorded time divided by the speed.
+ * @n     Calls that do not match the trace, e.g. after a driver change, are counted in mismatches and replay
+ * @n     continues at the next record of the requested kind.
+ */
+class DFRobot_LarkWeatherStation_Replay:public DFRobot_LarkWeatherStation {
+public:
+  DFRobot_LarkWeatherStation_Replay();
+  /**
+   * @fn load
+   * @brief Load a trace file and rewind
+   * @return Whether the file holds a valid trace
+   */
+  bool load(const char *path);
+  /**
+   * @fn load
+   * @brief Load a trace from memory, it is copied, and rewind
+   */
+  bool load(const uint8_t *trace, size_t length);
+  /**
+   * @fn rewind
+   * @brief Replay from the first record again, the clock restarts with the next call
+   */
+  void rewind(void);
+  /**
+   * @fn setSpeed
+   * @brief Replay timing
+   *
+   * @param speed 1: recorded timing, 100: 100 times faster, 0: no waiting
+   */
+  void setSpeed(float speed);
+  /**
+   * @fn finished
+   * @brief Whether every record was replayed
+   */
+  bool finished(void);
+  /**
+   * @fn trace
+   * @brief Reader positioned at the first record, e.g. to list the recorded requests
+   */
+  DFRobot_LarkWeatherStation_TraceReader trace(void);
+
+  uint32_t mismatches;   ///< Calls that differed from the trace
+protected:
+  int init(uint32_t freq);
+  void sendPacket(void *pkt, int length, bool stop = true);
+  int recvData(void *data, int len);
+  void recvFlush();
+  void sendFlush();
+  int recvAvailable(void);
+private:
+  bool peek(void);
+  bool seek(uint8_t type);
+  void waitFor(uint64_t time);
+
+  std::vector<uint8_t> _trace;
+  DFRobot_LarkWeatherStation_TraceReader _reader;
+  sTraceRecord_t _next;  ///< Record at the replay position
+  bool _hasNext;
+  uint16_t _used;        ///< Bytes of _next already returned by recvData()
+  bool _polled;          ///< The recorded transport answered every read, as I2C does
+  float _speed;
+  uint64_t _start;       ///< micros() of the first call
+  bool _started;
+};
+
+#endif
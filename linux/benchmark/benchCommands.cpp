@@ -0,0 +1,212 @@
+/*!
+ * @file  benchCommands.cpp
+ * @brief Per-command latency and sweep throughput of DFRobot_LarkWeatherStation against the simulated station
+ * @n     Usage: lark_bench_commands [--iterations N] [--latency MS] [--i2c] [--not-ready N] [--corrupt RATE] [--noise RATE]
+ * @n                                [--baud BAUD] [--real-time] [--json]
+ * @n     By default the clock is simulated: device latency and driver delays are modelled, not waited for,
+ * @n     so "latency" is the time the exchange would take on the wire and "cpu" is the host time spent.
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "linux/DFRobot_LarkWeatherStation_Sim.h"
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+static uint64_t allocations = 0;
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *malloc(size_t size)
+{
+  allocations++;
+  return __libc_malloc(size);
+}
+
+/**
+ * @brief Simulated station that timestamps where each exchange spends its time
+ */
+class BenchStation:public DFRobot_LarkWeatherStation_Sim {
+public:
+  BenchStation(const sSimConfig_t &config):DFRobot_LarkWeatherStation_Sim(config){ reset(); }
+  void reset(void){ _sendUs = _firstRecvUs = _statusUs = _lastRecvUs = 0; polls = 0; _awaiting = false; }
+  uint64_t delayUs(void){ return _firstRecvUs > _sendUs ? _firstRecvUs - _sendUs : 0; }
+  uint64_t pollUs(void){ return _statusUs > _firstRecvUs ? _statusUs - _firstRecvUs : 0; }
+  uint64_t transferUs(void){ return _lastRecvUs > _statusUs ? _lastRecvUs - _statusUs : 0; }
+  uint32_t polls;
+protected:
+  void sendPacket(void *pkt, int length, bool stop = true){
+    if(_sendUs == 0) _sendUs = micros();
+    _awaiting = true;
+    DFRobot_LarkWeatherStation_Sim::sendPacket(pkt, length, stop);
+  }
+  int recvData(void *data, int len){
+    const uint8_t *buf = (const uint8_t *)data;
+    int n = DFRobot_LarkWeatherStation_Sim::recvData(data, len);
+    int i = 0;
+    uint64_t now = micros();
+    if(_firstRecvUs == 0) _firstRecvUs = now;
+    if(_awaiting){
+      //Every read until the status arrives is a poll, a polled device may turn ready within one
+      polls++;
+      while((i < n - 1) && (buf[i] == 0xff)) i++;
+      if((n > 0) && ((buf[i] == STATUS_SUCCESS) || (buf[i] == STATUS_FAILED))){
+        _awaiting = false;
+        if(_statusUs == 0) _statusUs = now;
+      }
+    }
+    _lastRecvUs = now;
+    return n;
+  }
+private:
+  uint64_t _sendUs, _firstRecvUs, _statusUs, _lastRecvUs;
+  bool _awaiting;
+};
+
+typedef struct{
+  const char *name;
+  bool (*run)(BenchStation &station);
+  uint8_t scale;   ///< Divide the iteration count, for commands that take seconds
+}sBenchCase_t;
+
+static const char* const sweepKeys[] = {"Temp", "Humi", "Speed", "Dir", "Altitude", "Pressure"};
+
+static bool runGetValue(BenchStation &s){ return s.getValue("Temp").length() > 0; }
+static bool runGetValueBuf(BenchStation &s){ char buf[16]; return s.getValue("Temp", buf, sizeof(buf)) > 0; }
+static bool runGetValueEnum(BenchStation &s){ char buf[16]; return s.getValue(eSensorTemp, buf, sizeof(buf)) > 0; }
+static bool runGetUnit(BenchStation &s){ s.clearCache(); return s.getUnit("Temp").length() > 0; }
+static bool runGetInformation(BenchStation &s){ return s.getInformation(true).length() > 0; }
+static bool runGetSnapshot(BenchStation &s){ sWeatherSnapshot_t snap; return s.getSnapshot(snap); }
+static bool runGetTimeStamp(BenchStation &s){ return s.getTimeStamp().length() > 0; }
+static bool runSetTime(BenchStation &s){ return s.setTime(2023, 1, 11, 23, 59, 0) == 1; }
+static bool runSetRadius(BenchStation &s){ return s.setRadius(23.75) == 1; }
+static bool runSetSpeed1(BenchStation &s){ s.setSpeed1(4.8); return s.lastError() == ERR_CODE_NONE; }
+static bool runSetSpeed2(BenchStation &s){ s.setSpeed2(5.8); return s.lastError() == ERR_CODE_NONE; }
+static bool runCalibration(BenchStation &s){ return s.calibrationSpeed().length() > 0; }
+static bool runConfigDTU(BenchStation &s){ return s.configDTU((char *)"off", (char *)"wifi") == 1; }
+static bool runConfigWIFI(BenchStation &s){ return s.configWIFI((char *)"SSID", (char *)"PASSWORD") == 1; }
+static bool runConfigLora(BenchStation &s){ return s.configLora((char *)"DEUI", (char *)"EUI", (char *)"KEY") == 1; }
+static bool runConfigMQTT1(BenchStation &s){ return s.configMQTT1((char *)"Server", (char *)"Server_IP", (char *)"0") == 1; }
+static bool runConfigMQTT2(BenchStation &s){ return s.configMQTT2((char *)"Iot_ID", (char *)"Iot_PWD") == 1; }
+static bool runConfigTopic(BenchStation &s){ return s.configTopic((char *)"Topic_Humi", (char *)"12fd35") == 1; }
+static bool runSweepSingle(BenchStation &s){
+  bool ok = true;
+  for(uint8_t i = 0; i < 6; i++) ok = (s.getValue(sweepKeys[i]).length() > 0) && ok;
+  return ok;
+}
+static bool runSweepBatch(BenchStation &s){ String values[6]; return s.getValues(sweepKeys, 6, values) == 6; }
+
+static const sBenchCase_t benchCases[] = {
+  {"getValue", runGetValue, 1},
+  {"getValue(buf)", runGetValueBuf, 1},
+  {"getValue(enum)", runGetValueEnum, 1},
+  {"getUnit", runGetUnit, 1},
+  {"getInformation", runGetInformation, 1},
+  {"getSnapshot", runGetSnapshot, 1},
+  {"getTimeStamp", runGetTimeStamp, 1},
+  {"setTime", runSetTime, 1},
+  {"setRadius", runSetRadius, 1},
+  {"setSpeed1", runSetSpeed1, 10},
+  {"setSpeed2", runSetSpeed2, 10},
+  {"calibrationSpeed", runCalibration, 1},
+  {"configDTU", runConfigDTU, 1},
+  {"configWIFI", runConfigWIFI, 1},
+  {"configLora", runConfigLora, 1},
+  {"configMQTT1", runConfigMQTT1, 1},
+  {"configMQTT2", runConfigMQTT2, 1},
+  {"configTopic", runConfigTopic, 1},
+  {"sweep(getValue x6)", runSweepSingle, 1},
+  {"sweep(getValues)", runSweepBatch, 1},
+};
+
+static double percentile(std::vector<double> &v, double p)
+{
+  if(v.empty()) return 0;
+  size_t i = (size_t)(p * (v.size() - 1) + 0.5);
+  return v[i];
+}
+
+int main(int argc, char *argv[])
+{
+  sSimConfig_t config = DFRobot_LarkWeatherStation_Device::defaultConfig();
+  uint32_t iterations = 1000;
+  bool json = false, realTime = false;
+  for(int i = 1; i < argc; i++){
+    if((strcmp(argv[i], "--iterations") == 0) && (i + 1 < argc)) iterations = atoi(argv[++i]);
+    else if((strcmp(argv[i], "--latency") == 0) && (i + 1 < argc)) config.latencyMs = atoi(argv[++i]);
+    else if((strcmp(argv[i], "--not-ready") == 0) && (i + 1 < argc)) config.notReady = atoi(argv[++i]);
+    else if((strcmp(argv[i], "--corrupt") == 0) && (i + 1 < argc)) config.corruptRate = atof(argv[++i]);
+    else if((strcmp(argv[i], "--noise") == 0) && (i + 1 < argc)) config.noiseRate = atof(argv[++i]);
+    else if((strcmp(argv[i], "--baud") == 0) && (i + 1 < argc)) config.baud = atoi(argv[++i]);
+    else if(strcmp(argv[i], "--i2c") == 0) config.uart = false;
+    else if(strcmp(argv[i], "--real-time") == 0) realTime = true;
+    else if(strcmp(argv[i], "--json") == 0) json = true;
+    else{
+      fprintf(stderr, "usage: %s [--iterations N] [--latency MS] [--i2c] [--not-ready N] [--corrupt RATE] [--noise RATE] [--baud BAUD] [--real-time] [--json]\n", argv[0]);
+      return 1;
+    }
+  }
+  setVirtualClock(!realTime);
+
+  if(!json){
+    printf("%-20s %7s %9s %9s %9s %8s %8s %8s %6s %6s %7s %7s %6s %7s %9s %9s\n", "command", "runs", "p50 ms", "p99 ms", "max ms",
+           "delay", "poll", "xfer", "polls", "resets", "tx B", "rx B", "reads", "allocs", "cmd/s", "cpu us");
+  }
+  for(size_t c = 0; c < sizeof(benchCases) / sizeof(benchCases[0]); c++){
+    const sBenchCase_t &bench = benchCases[c];
+    BenchStation station(config);
+    station.begin();
+    uint32_t runs = iterations / bench.scale ? iterations / bench.scale : 1;
+    std::vector<double> latency, cpu;
+    double delaySum = 0, pollSum = 0, xferSum = 0, pollCount = 0;
+    uint32_t failures = 0;
+    uint64_t allocStart;
+    latency.reserve(runs);
+    cpu.reserve(runs);
+    //Commands that need prior state on the device
+    station.setRadius(23.75);
+    if(bench.run == runCalibration){ station.setSpeed1(4.8); station.setSpeed2(5.8); }
+    station.bytesSent = station.bytesRecv = station.reads = 0;
+    station.device().resets = 0;
+    allocStart = allocations;
+    for(uint32_t i = 0; i < runs; i++){
+      station.reset();
+      uint64_t t = micros();
+      std::chrono::steady_clock::time_point w = std::chrono::steady_clock::now();
+      if(!bench.run(station)) failures++;
+      cpu.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - w).count());
+      latency.push_back((micros() - t) / 1000.0);
+      delaySum += station.delayUs() / 1000.0;
+      pollSum += station.pollUs() / 1000.0;
+      xferSum += station.transferUs() / 1000.0;
+      pollCount += station.polls;
+    }
+    double allocs = (double)(allocations - allocStart) / runs;
+    double mean = 0, cpuMean = 0;
+    for(double v : latency) mean += v;
+    for(double v : cpu) cpuMean += v;
+    mean /= runs;
+    cpuMean /= runs;
+    std::sort(latency.begin(), latency.end());
+    double p50 = percentile(latency, 0.5), p99 = percentile(latency, 0.99), max = latency.back();
+    double rate = mean > 0 ? 1000.0 / mean : 0;
+    if(json){
+      printf("{\"command\":\"%s\",\"runs\":%u,\"failures\":%u,\"p50_ms\":%.3f,\"p99_ms\":%.3f,\"max_ms\":%.3f,"
+             "\"mean_ms\":%.3f,\"delay_ms\":%.3f,\"poll_ms\":%.3f,\"transfer_ms\":%.3f,\"polls\":%.2f,"
+             "\"resets\":%u,\"tx_bytes\":%.1f,\"rx_bytes\":%.1f,\"i2c_reads\":%.2f,\"allocations\":%.2f,\"commands_per_s\":%.3f,\"cpu_us\":%.2f,"
+             "\"latency_ms\":%u,\"uart\":%s,\"virtual_clock\":%s}\n",
+             bench.name, runs, failures, p50, p99, max, mean, delaySum / runs, pollSum / runs, xferSum / runs,
+             pollCount / runs, station.device().resets, (double)station.bytesSent / runs, (double)station.bytesRecv / runs,
+             (double)station.reads / runs, allocs, rate, cpuMean, config.latencyMs, config.uart ? "true" : "false", realTime ? "false" : "true");
+    }else{
+      printf("%-20s %7u %9.2f %9.2f %9.2f %8.2f %8.2f %8.2f %6.1f %6u %7.1f %7.1f %6.1f %7.2f %9.2f %9.2f%s\n", bench.name, runs, p50, p99,
+             max, delaySum / runs, pollSum / runs, xferSum / runs, pollCount / runs, station.device().resets, (double)station.bytesSent / runs,
+             (double)station.bytesRecv / runs, (double)station.reads / runs, allocs, rate, cpuMean, failures ? " (failures)" : "");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,179 @@
+/*!
+ * @file  benchReactor.cpp
+ * @brief Load test of DFRobot_LarkWeatherStation_Reactor against simulated stations behind pty pairs
+ * @n     Usage: lark_bench_reactor [--stations 10,100,500] [--period MS] [--seconds S] [--latency MS] [--baud BAUD] [--json]
+ * @n     A device thread serves every pty master with a DFRobot_LarkWeatherStation_Device, the reactor drives the
+ * @n     slave ends through the normal termios UART transport. CPU time is measured on the reactor thread only.
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "linux/DFRobot_LarkWeatherStation_Reactor.h"
+#include "linux/DFRobot_LarkWeatherStation_Sim.h"
+#include <stdio.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+typedef struct{
+  int fd;                                   ///< pty master
+  DFRobot_LarkWeatherStation_Device *device;
+}sEndpoint_t;
+
+static std::atomic<bool> serving;
+
+/**
+ * @brief Device side: feed request bytes to the models and write responses once they are due
+ */
+static void serveDevices(std::vector<sEndpoint_t> *endpoints)
+{
+  struct epoll_event ev[64];
+  uint8_t buf[SIM_FRAME_MAX_LEN];
+  int epfd = epoll_create1(0);
+  for(size_t i = 0; i < endpoints->size(); i++){
+    struct epoll_event e;
+    e.events = EPOLLIN;
+    e.data.u32 = i;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, (*endpoints)[i].fd, &e);
+  }
+  while(serving){
+    int timeout = 100;
+    uint32_t now = millis();
+    for(size_t i = 0; i < endpoints->size(); i++){
+      sEndpoint_t &ep = (*endpoints)[i];
+      if(!ep.device->pending()) continue;
+      int n = ep.device->available();
+      if(n > 0){
+        n = ep.device->transmit(buf, n);
+        if(write(ep.fd, buf, n) < 0){}
+      }
+      if(ep.device->pending()){
+        int32_t wait = ep.device->readyAt() - now;
+        if(wait < 1) wait = 1;
+        if(wait < timeout) timeout = wait;
+      }
+    }
+    int n = epoll_wait(epfd, ev, 64, timeout);
+    for(int i = 0; i < n; i++){
+      sEndpoint_t &ep = (*endpoints)[ev[i].data.u32];
+      ssize_t len = read(ep.fd, buf, sizeof(buf));
+      if(len > 0) ep.device->receive(buf, len);
+    }
+  }
+  close(epfd);
+}
+
+static uint64_t threadCpuUs(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void onSample(void *ctx, DFRobot_LarkWeatherStation_UART *station, eRequestStatus_t status, const uint8_t *data, uint16_t length)
+{
+  (void)station;
+  (void)data;
+  if(status == eRequestDone) *(uint64_t *)ctx += length;
+}
+
+int main(int argc, char *argv[])
+{
+  std::vector<int> counts = {10, 50, 100, 200, 500};
+  sSimConfig_t config = DFRobot_LarkWeatherStation_Device::defaultConfig();
+  uint32_t period = 1000, seconds = 5;
+  bool json = false;
+  for(int i = 1; i < argc; i++){
+    if((strcmp(argv[i], "--stations") == 0) && (i + 1 < argc)){
+      counts.clear();
+      for(char *p = strtok(argv[++i], ","); p; p = strtok(NULL, ",")) counts.push_back(atoi(p));
+    }
+    else if((strcmp(argv[i], "--period") == 0) && (i + 1 < argc)) period = atoi(argv[++i]);
+    else if((strcmp(argv[i], "--seconds") == 0) && (i + 1 < argc)) seconds = atoi(argv[++i]);
+    else if((strcmp(argv[i], "--latency") == 0) && (i + 1 < argc)) config.latencyMs = atoi(argv[++i]);
+    else if((strcmp(argv[i], "--baud") == 0) && (i + 1 < argc)) config.baud = atoi(argv[++i]);
+    else if(strcmp(argv[i], "--json") == 0) json = true;
+    else{
+      fprintf(stderr, "usage: %s [--stations 10,100,500] [--period MS] [--seconds S] [--latency MS] [--baud BAUD] [--json]\n", argv[0]);
+      return 1;
+    }
+  }
+  //Two descriptors per station plus the device side
+  struct rlimit rl;
+  if(getrlimit(RLIMIT_NOFILE, &rl) == 0){
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+  if(!json){
+    printf("%9s %9s %9s %9s %9s %10s %10s %11s %9s\n", "stations", "cmd/s", "failed", "wakeup/s", "cpu %", "cpu us/cmd", "cpu us/stn", "payload B/s", "timers/s");
+  }
+  for(size_t c = 0; c < counts.size(); c++){
+    int stations = counts[c];
+    std::vector<sEndpoint_t> endpoints;
+    std::vector<std::string> paths;
+    std::vector<DFRobot_LarkWeatherStation_UART *> uarts;
+    DFRobot_LarkWeatherStation_Reactor reactor(stations);
+    uint64_t payload = 0;
+    uint8_t args[1] = {0};
+    for(int i = 0; i < stations; i++){
+      sEndpoint_t ep;
+      ep.fd = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+      if((ep.fd < 0) || (grantpt(ep.fd) != 0) || (unlockpt(ep.fd) != 0)){
+        fprintf(stderr, "pty %d: %s\n", i, strerror(errno));
+        return 1;
+      }
+      config.seed = i + 1;
+      ep.device = new DFRobot_LarkWeatherStation_Device(config);
+      endpoints.push_back(ep);
+      paths.push_back(ptsname(ep.fd));
+    }
+    reactor.begin();
+    for(int i = 0; i < stations; i++){
+      uarts.push_back(new DFRobot_LarkWeatherStation_UART(paths[i].c_str()));
+      if(uarts[i]->begin() != 0){
+        fprintf(stderr, "open %s failed\n", paths[i].c_str());
+        return 1;
+      }
+      reactor.add(uarts[i], period, CMD_GET_ALL_DATA, args, sizeof(args), onSample, &payload, (uint64_t)period * i / stations);
+    }
+    serving = true;
+    std::thread server(serveDevices, &endpoints);
+    uint64_t cpu = threadCpuUs();
+    uint32_t start = millis();
+    while(millis() - start < seconds * 1000) reactor.run(100);
+    double elapsed = (millis() - start) / 1000.0;
+    cpu = threadCpuUs() - cpu;
+    serving = false;
+    server.join();
+
+    double rate = reactor.completed / elapsed;
+    double cpuPerCmd = reactor.completed ? (double)cpu / reactor.completed : 0;
+    double cpuPercent = cpu / (elapsed * 10000.0);
+    if(json){
+      printf("{\"stations\":%d,\"period_ms\":%u,\"seconds\":%.2f,\"completed\":%u,\"failed\":%u,\"commands_per_s\":%.1f,"
+             "\"wakeups_per_s\":%.1f,\"timers_per_s\":%.1f,\"cpu_percent\":%.3f,\"cpu_us_per_command\":%.2f,"
+             "\"cpu_us_per_station_s\":%.2f,\"payload_bytes_per_s\":%.0f}\n",
+             stations, period, elapsed, reactor.completed, reactor.failed, rate, reactor.wakeups / elapsed,
+             reactor.timers / elapsed, cpuPercent, cpuPerCmd, cpu / elapsed / stations, payload / elapsed);
+    }else{
+      printf("%9d %9.1f %9u %9.1f %9.3f %10.2f %10.2f %11.0f %9.1f\n", stations, rate, reactor.failed, reactor.wakeups / elapsed,
+             cpuPercent, cpuPerCmd, cpu / elapsed / stations, payload / elapsed, reactor.timers / elapsed);
+    }
+    fflush(stdout);
+    for(int i = 0; i < stations; i++){
+      delete uarts[i];
+      close(endpoints[i].fd);
+      delete endpoints[i].device;
+    }
+  }
+  return 0;
+}
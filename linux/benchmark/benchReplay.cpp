@@ -0,0 +1,132 @@
+/*!
+ * @file  benchReplay.cpp
+ * @brief Driver throughput on a replayed wire trace, and a check that the replay is faithful
+ * @n     Usage: lark_bench_replay [--trace FILE] [--requests N] [--i2c] [--noise RATE] [--corrupt RATE]
+ * @n                              [--speeds 1,100,0] [--save FILE] [--json]
+ * @n     Without --trace the simulated station is captured first on the simulated clock, into a temporary file
+ * @n     unless --save names one. Every request of the trace is then started again on a replay station, which
+ * @n     answers from the trace at each speed in real time.
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "linux/DFRobot_LarkWeatherStation_Sim.h"
+#include "linux/DFRobot_LarkWeatherStation_Trace.h"
+#include <stdio.h>
+#include <unistd.h>
+#include <chrono>
+#include <vector>
+
+static double nowSeconds(void)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char *argv[])
+{
+  std::vector<float> speeds = {1, 100, 0};
+  const char *tracePath = NULL, *savePath = NULL;
+  char tempPath[] = "/tmp/lark_replay_XXXXXX";
+  uint32_t requests = 500;
+  bool json = false;
+  sSimConfig_t config = DFRobot_LarkWeatherStation_Device::defaultConfig();
+  config.noiseRate = 0.05;
+  for(int i = 1; i < argc; i++){
+    if((strcmp(argv[i], "--trace") == 0) && (i + 1 < argc)) tracePath = argv[++i];
+    else if((strcmp(argv[i], "--save") == 0) && (i + 1 < argc)) savePath = argv[++i];
+    else if((strcmp(argv[i], "--requests") == 0) && (i + 1 < argc)) requests = atoi(argv[++i]);
+    else if((strcmp(argv[i], "--noise") == 0) && (i + 1 < argc)) config.noiseRate = atof(argv[++i]);
+    else if((strcmp(argv[i], "--corrupt") == 0) && (i + 1 < argc)) config.corruptRate = atof(argv[++i]);
+    else if(strcmp(argv[i], "--i2c") == 0) config.uart = false;
+    else if((strcmp(argv[i], "--speeds") == 0) && (i + 1 < argc)){
+      speeds.clear();
+      for(char *p = strtok(argv[++i], ","); p; p = strtok(NULL, ",")) speeds.push_back(atof(p));
+    }
+    else if(strcmp(argv[i], "--json") == 0) json = true;
+    else{
+      fprintf(stderr, "usage: %s [--trace FILE] [--requests N] [--i2c] [--noise RATE] [--corrupt RATE] [--speeds 1,100,0] [--save FILE] [--json]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  if(tracePath == NULL){
+    //Capture a session with the simulated station
+    char text[LARK_PAYLOAD_MAX_LEN + 1];
+    setVirtualClock(true);
+    DFRobot_LarkWeatherStation_Sim station(config);
+    DFRobot_LarkWeatherStation_Capture capture(&station);
+    if(savePath == NULL){
+      int fd = mkstemp(tempPath);
+      if(fd < 0){
+        fprintf(stderr, "cannot create a temporary trace\n");
+        return 1;
+      }
+      close(fd);
+      savePath = tempPath;
+    }
+    if(!capture.open(savePath)){
+      fprintf(stderr, "cannot create %s\n", savePath);
+      return 1;
+    }
+    if(capture.begin() != 0) return 1;
+    for(uint32_t i = 0; i < requests; i++){
+      if(i % 2) capture.getInformation(true, text, sizeof(text));
+      else capture.getValue("Temp", text, sizeof(text));
+    }
+    capture.close();
+    setVirtualClock(false);
+    if(!json) printf("captured %u requests, %u records, %u bytes to %s\n", requests, capture.records, capture.bytes, savePath);
+    tracePath = savePath;
+  }
+
+  DFRobot_LarkWeatherStation_Replay replay;
+  bool loaded = replay.load(tracePath);
+  if(savePath == tempPath) unlink(tempPath);
+  if(!loaded){
+    fprintf(stderr, "%s is not a trace\n", tracePath);
+    return 1;
+  }
+  //The replay holds responses back until their time, the driver's own waits shrink with the speed
+  uint16_t hints[CMD_END + 1];
+  for(uint8_t cmd = 0; cmd <= CMD_END; cmd++) hints[cmd] = replay.getLatencyHint(cmd);
+  if(!json) printf("%7s %9s %8s %11s %9s %10s %10s\n", "speed", "requests", "failed", "mismatches", "seconds", "req/s", "trace s");
+  for(size_t s = 0; s < speeds.size(); s++){
+    DFRobot_LarkWeatherStation_TraceReader reader = replay.trace();
+    sTraceRecord_t record;
+    uint32_t done = 0, failed = 0;
+    uint64_t traceUs = 0;
+    double start;
+    replay.rewind();
+    replay.setSpeed(speeds[s]);
+    for(uint8_t cmd = 0; cmd <= CMD_END; cmd++) replay.setLatencyHint(cmd, speeds[s] > 0 ? hints[cmd] / speeds[s] : 0);
+    start = nowSeconds();
+    replay.begin();
+    //Start every recorded request again, retransmission requests come from the driver itself
+    while(reader.next(&record)){
+      traceUs = record.time;
+      if(((record.type != eTraceSend) && (record.type != eTraceSendNoStop)) || (record.length < sizeof(sCmdSendPkt_t))) continue;
+      if(record.data[0] == CMD_RESET_DATA) continue;
+      if(!replay.startRequest(record.data[0], record.data + sizeof(sCmdSendPkt_t), record.length - sizeof(sCmdSendPkt_t))){
+        failed++;
+        continue;
+      }
+      eRequestStatus_t status;
+      while((status = replay.poll()) == eRequestBusy) yield();
+      if(status == eRequestDone) done++;
+      else failed++;
+      replay.endRequest();
+    }
+    double seconds = nowSeconds() - start;
+    if(json){
+      printf("{\"speed\":%g,\"requests\":%u,\"failed\":%u,\"mismatches\":%u,\"seconds\":%.4f,\"requests_per_s\":%.1f,\"trace_s\":%.3f}\n",
+             speeds[s], done + failed, failed, replay.mismatches, seconds, (done + failed) / seconds, traceUs / 1e6);
+    }else{
+      printf("%7g %9u %8u %11u %9.3f %10.1f %10.3f\n", speeds[s], done + failed, failed, replay.mismatches, seconds,
+             (done + failed) / seconds, traceUs / 1e6);
+    }
+  }
+  return 0;
+}
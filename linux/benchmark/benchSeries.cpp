@@ -0,0 +1,144 @@
+/*!
+ * @file  benchSeries.cpp
+ * @brief Compression ratio and coding speed of DFRobot_LarkWeatherStation_Series on samples recorded from the simulated station
+ * @n     Usage: lark_bench_series [--samples N] [--period MS] [--blocks 128,1024] [--repeat N] [--json]
+ * @n     The samples are taken with continuous acquisition on the simulated clock, the getInformation() text of
+ * @n     every sample is recorded as well as the baseline of storing the Strings.
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "linux/DFRobot_LarkWeatherStation_Sim.h"
+#include "DFRobot_LarkWeatherStation_Series.h"
+#include <stdio.h>
+#include <chrono>
+#include <vector>
+
+static double nowSeconds(void)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool sameRecord(const sSampleRecord_t &a, const sSampleRecord_t &b)
+{
+  return (a.valid == b.valid) && (a.temp == b.temp) && (a.humidity == b.humidity) && (a.speed == b.speed) &&
+         (a.direction == b.direction) && (a.altitude == b.altitude) && (a.pressure == b.pressure);
+}
+
+int main(int argc, char *argv[])
+{
+  std::vector<int> blockSizes = {128, 256, 1024, 4096};
+  uint32_t samples = 86400, period = 1000, repeat = 5;
+  bool json = false;
+  for(int i = 1; i < argc; i++){
+    if((strcmp(argv[i], "--samples") == 0) && (i + 1 < argc)) samples = atoi(argv[++i]);
+    else if((strcmp(argv[i], "--period") == 0) && (i + 1 < argc)) period = atoi(argv[++i]);
+    else if((strcmp(argv[i], "--repeat") == 0) && (i + 1 < argc)) repeat = atoi(argv[++i]);
+    else if((strcmp(argv[i], "--blocks") == 0) && (i + 1 < argc)){
+      blockSizes.clear();
+      for(char *p = strtok(argv[++i], ","); p; p = strtok(NULL, ",")) blockSizes.push_back(atoi(p));
+    }
+    else if(strcmp(argv[i], "--json") == 0) json = true;
+    else{
+      fprintf(stderr, "usage: %s [--samples N] [--period MS] [--blocks 128,1024] [--repeat N] [--json]\n", argv[0]);
+      return 1;
+    }
+  }
+  if((samples == 0) || (repeat == 0)) return 1;
+
+  //Record the samples
+  setVirtualClock(true);
+  DFRobot_LarkWeatherStation_Sim station;
+  std::vector<sSampleRecord_t> records;
+  std::vector<uint32_t> stamps;
+  uint64_t textBytes = 0;
+  char text[LARK_PAYLOAD_MAX_LEN + 1];
+  if(station.begin() != 0) return 1;
+  station.startContinuous(period);
+  while(records.size() < samples){
+    sSampleRecord_t record;
+    uint32_t stamp;
+    if(!station.runContinuous()){
+      delay(1);
+      continue;
+    }
+    while(station.drain(&record, 1, &stamp)){
+      records.push_back(record);
+      stamps.push_back(stamp);
+    }
+    int n = station.getInformation(true, text, sizeof(text));
+    if(n > 0) textBytes += n;
+  }
+  station.stopContinuous();
+  records.resize(samples);
+  stamps.resize(samples);
+
+  double textPerSample = (double)textBytes / samples;
+  double rawBytes = (double)samples * sizeof(sSampleRecord_t);
+  if(!json){
+    printf("%u samples every %u ms, getInformation() text %.1f B/sample, sSampleRecord_t %u B/sample\n",
+           samples, period, textPerSample, (unsigned)sizeof(sSampleRecord_t));
+    printf("%7s %9s %9s %10s %10s %11s %11s %9s\n", "block", "blocks", "B/sample", "vs text", "vs record", "enc MB/s", "dec MB/s", "seek us");
+  }
+  for(size_t b = 0; b < blockSizes.size(); b++){
+    uint16_t blockSize = blockSizes[b];
+    //Every sample fits in 21 bytes, the worst case
+    uint16_t blocks = (uint32_t)samples * 21 / (blockSize - LARK_SERIES_HEADER_LEN - 21) + 1;
+    std::vector<uint8_t> buffer((size_t)blocks * blockSize);
+    DFRobot_LarkWeatherStation_Series series(buffer.data(), blocks, blockSize);
+    double start, encode = 0, decode = 0, seek = 0;
+    uint32_t stamp, seeks = 0;
+    sSampleRecord_t record;
+    bool ok = true;
+
+    for(uint32_t r = 0; r < repeat; r++){
+      series.clear();
+      start = nowSeconds();
+      for(uint32_t i = 0; i < samples; i++) series.append(stamps[i], records[i]);
+      encode += nowSeconds() - start;
+    }
+    start = nowSeconds();
+    for(uint32_t r = 0; r < repeat; r++){
+      uint32_t i = 0;
+      series.seek(stamps[0]);
+      while(series.next(&stamp, &record)) i++;
+      if(i != samples) ok = false;
+    }
+    decode = nowSeconds() - start;
+    series.seek(stamps[0]);
+    for(uint32_t i = 0; i < samples; i++){
+      if(!series.next(&stamp, &record) || (stamp != stamps[i]) || !sameRecord(record, records[i])){
+        ok = false;
+        break;
+      }
+    }
+    //Random access: find a sample and read it
+    start = nowSeconds();
+    for(uint32_t i = 0; i < samples; i += 97, seeks++){
+      if(!series.seek(stamps[i]) || !series.next(&stamp, &record) || (stamp != stamps[i])) ok = false;
+    }
+    seek = seeks ? (nowSeconds() - start) * 1e6 / seeks : 0;
+    if(!ok){
+      fprintf(stderr, "block %u: decoded samples differ from the input\n", blockSize);
+      return 1;
+    }
+
+    double perSample = (double)series.bytes() / samples;
+    double encRate = rawBytes * repeat / encode / 1e6;
+    double decRate = rawBytes * repeat / decode / 1e6;
+    if(json){
+      printf("{\"block\":%u,\"blocks\":%u,\"samples\":%u,\"period_ms\":%u,\"bytes\":%u,\"bytes_per_sample\":%.3f,"
+             "\"text_bytes_per_sample\":%.2f,\"ratio_text\":%.2f,\"ratio_record\":%.2f,\"encode_mb_s\":%.2f,"
+             "\"decode_mb_s\":%.2f,\"seek_us\":%.2f}\n",
+             blockSize, series.blocks(), samples, period, series.bytes(), perSample, textPerSample,
+             textPerSample / perSample, sizeof(sSampleRecord_t) / perSample, encRate, decRate, seek);
+    }else{
+      printf("%7u %9u %9.2f %9.1fx %9.1fx %11.1f %11.1f %9.2f\n", blockSize, series.blocks(), perSample,
+             textPerSample / perSample, sizeof(sSampleRecord_t) / perSample, encRate, decRate, seek);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,210 @@
+/*!
+ * @file  checkAggregator.cpp
+ * @brief Compare DFRobot_LarkWeatherStation_Aggregator with a naive recomputation over the window
+ * @n     Usage: lark_check_aggregator [--samples N] [--seed N]
+ * @n     Random samples with gaps, out-of-order stamps and missing fields are added to windows of several spans;
+ * @n     after every sample each window and field is recomputed from the kept samples. The stamps start shortly
+ * @n     before millis() wraps and wrap again during the run. Exits 1 on a mismatch.
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation_Aggregator.h"
+#include <stdio.h>
+#include <math.h>
+#include <random>
+#include <vector>
+
+static const float fieldScale[LARK_WINDOW_FIELDS] = {100, 100, 100, 10, 1, 10};
+
+typedef struct{
+  uint32_t start;   /**< Start time of its bucket */
+  int32_t value[LARK_WINDOW_FIELDS];
+  uint8_t valid;
+}sKeptSample_t;
+
+/**
+ * @brief The window as documented: samples of the last LARK_WINDOW_BUCKETS buckets, which follow each other from
+ * @n     the first sample on, samples older than the newest bucket are ignored
+ */
+typedef struct{
+  uint32_t bucketMs;
+  uint32_t newest;      /**< Start time of the newest bucket */
+  bool started;
+  std::vector<sKeptSample_t> kept;
+}sNaiveWindow_t;
+
+static int32_t recordValue(const sSampleRecord_t &record, uint8_t i)
+{
+  switch(i){
+    case 0: return record.temp;
+    case 1: return record.humidity;
+    case 2: return record.speed;
+    case 3: return record.direction;
+    case 4: return record.altitude;
+    default: return record.pressure;
+  }
+}
+
+static void naiveAdd(sNaiveWindow_t *window, uint32_t stamp, const sSampleRecord_t &record)
+{
+  sKeptSample_t sample;
+  if(!window->started){
+    window->started = true;
+    window->newest = stamp;
+  }
+  if((int32_t)(stamp - window->newest) < 0) return;
+  window->newest += (stamp - window->newest) / window->bucketMs * window->bucketMs;
+  sample.start = window->newest;
+  sample.valid = record.valid;
+  for(uint8_t i = 0; i < LARK_WINDOW_FIELDS; i++) sample.value[i] = recordValue(record, i);
+  window->kept.push_back(sample);
+  //Drop what left the window
+  size_t n = 0;
+  for(size_t k = 0; k < window->kept.size(); k++){
+    if((window->newest - window->kept[k].start) / window->bucketMs < LARK_WINDOW_BUCKETS) window->kept[n++] = window->kept[k];
+  }
+  window->kept.resize(n);
+}
+
+static bool naiveGet(const sNaiveWindow_t &window, uint8_t i, sWindowStat_t *stat)
+{
+  double sum = 0, sumSq = 0, mean;
+  int32_t min = 0, max = 0;
+  uint32_t count = 0;
+  for(size_t k = 0; k < window.kept.size(); k++){
+    const sKeptSample_t &sample = window.kept[k];
+    if(!(sample.valid & (1 << i))) continue;
+    if((count == 0) || (sample.value[i] < min)) min = sample.value[i];
+    if((count == 0) || (sample.value[i] > max)) max = sample.value[i];
+    sum += sample.value[i];
+    count++;
+  }
+  if(count == 0) return false;
+  mean = sum / count;
+  for(size_t k = 0; k < window.kept.size(); k++){
+    const sKeptSample_t &sample = window.kept[k];
+    if(sample.valid & (1 << i)) sumSq += (sample.value[i] - mean) * (sample.value[i] - mean);
+  }
+  stat->min = min / fieldScale[i];
+  stat->max = max / fieldScale[i];
+  stat->mean = mean / fieldScale[i];
+  stat->stddev = (count > 1) ? sqrt(sumSq / (count - 1)) / fieldScale[i] : 0;
+  stat->count = count;
+  return true;
+}
+
+static bool near(float a, float b, float scale)
+{
+  return fabs(a - b) <= 1e-4 * (fabs(b) + scale);
+}
+
+/**
+ * @brief One sample a second across the wrap of millis(), the 1 minute window holds the last 60
+ */
+static uint32_t checkWrap(void)
+{
+  DFRobot_LarkWeatherStation_Aggregator aggregator;
+  sSampleRecord_t record;
+  sWindowStat_t stat;
+  memset(&record, 0, sizeof(record));
+  memset(&stat, 0, sizeof(stat));
+  record.valid = LARK_SNAPSHOT_TEMP;
+  aggregator.addWindow(60000);
+  for(uint32_t n = 0; n < 600; n++){
+    record.temp = 1000 + n;
+    aggregator.add(0xffffffffUL - 30000 + n * 1000, record);
+  }
+  if(aggregator.get(0, LARK_SNAPSHOT_TEMP, &stat) && (stat.count == 60) && near(stat.mean, 15.695, 1) &&
+     (stat.min == 15.4f) && (stat.max == 15.99f)){
+    return 0;
+  }
+  printf("across the wrap: count %u/60 mean %g/15.695 min %g/15.4 max %g/15.99\n", stat.count, stat.mean, stat.min,
+         stat.max);
+  return 1;
+}
+
+int main(int argc, char *argv[])
+{
+  static const uint32_t spans[] = {600, 60000, 600000, 3600000};
+  uint32_t samples = 200000, seed = 1;
+  for(int i = 1; i < argc; i++){
+    if((strcmp(argv[i], "--samples") == 0) && (i + 1 < argc)) samples = atoi(argv[++i]);
+    else if((strcmp(argv[i], "--seed") == 0) && (i + 1 < argc)) seed = atoi(argv[++i]);
+    else{
+      fprintf(stderr, "usage: %s [--samples N] [--seed N]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  DFRobot_LarkWeatherStation_Aggregator aggregator;
+  std::vector<sNaiveWindow_t> naive;
+  for(uint8_t w = 0; (w < sizeof(spans) / sizeof(spans[0])) && (w < LARK_WINDOW_MAX); w++){
+    sNaiveWindow_t window;
+    if(aggregator.addWindow(spans[w]) != w) return 1;
+    window.bucketMs = spans[w] / LARK_WINDOW_BUCKETS;
+    window.newest = 0;
+    window.started = false;
+    naive.push_back(window);
+  }
+
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> percent(0, 99);
+  //Start 30 minutes before millis() wraps, the gaps wrap it again later on
+  uint32_t stamp = 0xffffffffUL - 1800000, checks = 1, mismatches = checkWrap();
+  int32_t temp = 2000, humidity = 5000, speed = 300, direction = 1800, altitude = 50, pressure = 10132;
+  for(uint32_t n = 0; n < samples; n++){
+    sSampleRecord_t record;
+    uint32_t at;
+    int roll = percent(rng);
+    //Mostly 1 s steps, now and then a long gap that empties the short windows
+    if(roll < 2) stamp += 100000 + rng() % 4000000;
+    else stamp += 200 + rng() % 1800;
+    //Some samples arrive late, the older of them fall before the newest bucket
+    at = (percent(rng) < 10) ? stamp - rng() % 5000 : stamp;
+    temp += (int32_t)(rng() % 41) - 20;
+    humidity = (humidity + (int32_t)(rng() % 201) - 100 + 10000) % 10000;
+    speed = (speed + (int32_t)(rng() % 61) - 30 + 6000) % 6000;
+    direction = rng() % 3600;
+    altitude += (int32_t)(rng() % 3) - 1;
+    pressure += (int32_t)(rng() % 5) - 2;
+    record.delta = 0;
+    record.temp = temp;
+    record.humidity = humidity;
+    record.speed = speed;
+    record.direction = direction;
+    record.altitude = altitude;
+    record.pressure = pressure;
+    record.valid = (percent(rng) < 5) ? (rng() & LARK_SAMPLE_FIELDS) : LARK_SAMPLE_FIELDS;
+    aggregator.add(at, record);
+    for(size_t w = 0; w < naive.size(); w++) naiveAdd(&naive[w], at, record);
+
+    for(size_t w = 0; w < naive.size(); w++){
+      for(uint8_t i = 0; i < LARK_WINDOW_FIELDS; i++){
+        sWindowStat_t got, want;
+        memset(&got, 0, sizeof(got));
+        memset(&want, 0, sizeof(want));
+        bool hasGot = aggregator.get(w, 1 << i, &got);
+        bool hasWant = naiveGet(naive[w], i, &want);
+        bool ok = (hasGot == hasWant);
+        checks++;
+        if(ok && hasWant){
+          ok = (got.count == want.count) && (got.min == want.min) && (got.max == want.max) &&
+               near(got.mean, want.mean, 1) && near(got.stddev, want.stddev, 0.01);
+        }
+        if(!ok){
+          if(mismatches++ < 10){
+            printf("sample %u window %u field %u: count %u/%u min %g/%g max %g/%g mean %g/%g stddev %g/%g\n",
+                   n, (unsigned)w, i, hasGot ? got.count : 0, hasWant ? want.count : 0, got.min, want.min,
+                   got.max, want.max, got.mean, want.mean, got.stddev, want.stddev);
+          }
+        }
+      }
+    }
+  }
+  printf("%u samples, %u windows, %u checks, %u mismatches\n", samples, (unsigned)naive.size(), checks, mismatches);
+  return mismatches ? 1 : 0;
+}
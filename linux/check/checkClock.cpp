@@ -0,0 +1,125 @@
+/*!
+ * @file  checkClock.cpp
+ * @brief Check DFRobot_LarkWeatherStation_Clock against the RTC of the simulated station
+ * @n     Usage: lark_check_clock [--hours N]
+ * @n     For RTC drifts of both signs and several response latencies, on the simulated clock: set the RTC (or
+ * @n     leave it as it is), then sync every 20 minutes. The estimated drift, and the error of epochAt() just
+ * @n     before a sync, just after it and for stamps before it (the floor division path) must stay within
+ * @n     what the reported round trip and accuracy allow. Exits 1 when a bound is exceeded.
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "linux/DFRobot_LarkWeatherStation_Sim.h"
+#include "DFRobot_LarkWeatherStation_Clock.h"
+#include <stdio.h>
+#include <math.h>
+
+#define SYNC_PERIOD_MS      1200000
+#define REFERENCE_EPOCH     1700000000UL
+
+static uint32_t checks = 0, failures = 0;
+
+static void expect(double got, double bound, const char *what, int32_t ppm, uint32_t latency)
+{
+  checks++;
+  if(fabs(got) <= bound) return;
+  if(failures++ < 20) printf("drift %d ppm, latency %u ms: %s %.3f exceeds %.3f\n", ppm, latency, what, got, bound);
+}
+
+/**
+ * @brief epochAt(stamp) minus the RTC of the simulated station at stamp, in ms
+ */
+static double epochError(DFRobot_LarkWeatherStation_Clock &clock, DFRobot_LarkWeatherStation_Device &device,
+                         int32_t ppm, uint32_t stamp)
+{
+  uint16_t ms;
+  uint32_t epoch = clock.epochAt(stamp, &ms);
+  double truth = device.rtcMillis() + ((double)stamp - (double)(uint32_t)millis()) * (1 + ppm / 1e6);
+  return (double)epoch * 1000 + ms - truth;
+}
+
+static void checkRun(int32_t ppm, uint32_t latency, bool set, uint32_t hours)
+{
+  static const uint32_t before[] = {1, 499, 999, 1000, 1001, 2500, 60000};
+  sSimConfig_t config = DFRobot_LarkWeatherStation_Device::defaultConfig();
+  config.rtcDriftPpm = ppm;
+  config.latencyMs = latency;
+  DFRobot_LarkWeatherStation_Sim station(config);
+  DFRobot_LarkWeatherStation_Device &device = station.device();
+  DFRobot_LarkWeatherStation_Clock clock(&station);
+  uint32_t anchor, now;
+  double place, driftBound = -1;
+  if(station.begin() != 0){
+    expect(1, 0, "begin failed", ppm, latency);
+    return;
+  }
+  //Start in the middle of a second of both clocks
+  delay(12345 + latency * 7);
+  anchor = millis();
+  if(set){
+    if(!clock.setTime(REFERENCE_EPOCH, anchor)){
+      expect(1, 0, "setTime failed", ppm, latency);
+      return;
+    }
+    //The time arrives on a second boundary of the reference, to within the transfer of the request
+    now = millis();
+    expect(device.rtcMillis() - (REFERENCE_EPOCH * 1000.0 + (now - anchor)), clock.roundTrip() + 2,
+           "RTC minus reference after setTime", ppm, latency);
+  }else if(!clock.sync()){
+    expect(1, 0, "sync failed", ppm, latency);
+    return;
+  }
+  place = clock.accuracy() + clock.roundTrip() + 2;
+  expect(epochError(clock, device, ppm, millis()), place, "epochAt error after the first set or sync", ppm, latency);
+
+  for(uint32_t n = 0; n < hours * 3600000UL / SYNC_PERIOD_MS; n++){
+    delay(SYNC_PERIOD_MS + n * 37);
+    //Extrapolated over the period with the drift estimated so far
+    if(driftBound >= 0){
+      expect(epochError(clock, device, ppm, millis()), place + driftBound * (SYNC_PERIOD_MS + n * 37) / 1e6 + 2,
+             "epochAt error before a sync", ppm, latency);
+    }
+    if(!clock.sync()){
+      expect(1, 0, "sync failed", ppm, latency);
+      return;
+    }
+    now = millis();
+    place = clock.accuracy() + clock.roundTrip() + 2;
+    //Both ends of the drift interval are placed to within their accuracy, plus the integer ppm of the simulator
+    driftBound = 2 * place / (now - anchor) * 1e6 + 1;
+    expect(clock.drift() - ppm, driftBound, "drift estimate error in ppm", ppm, latency);
+    expect(epochError(clock, device, ppm, now), place, "epochAt error after a sync", ppm, latency);
+    for(uint8_t i = 0; i < sizeof(before) / sizeof(before[0]); i++){
+      uint32_t stamp = now - 2 * clock.roundTrip() - before[i];
+      expect(epochError(clock, device, ppm, stamp), place + driftBound * (now - stamp) / 1e6,
+             "epochAt error before the sync", ppm, latency);
+    }
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  static const int32_t drifts[] = {250, 37, 0, -40, -180};
+  static const uint32_t latencies[] = {2, 5, 20};
+  uint32_t hours = 24;
+  for(int i = 1; i < argc; i++){
+    if((strcmp(argv[i], "--hours") == 0) && (i + 1 < argc)) hours = atoi(argv[++i]);
+    else{
+      fprintf(stderr, "usage: %s [--hours N]\n", argv[0]);
+      return 1;
+    }
+  }
+  setVirtualClock(true);
+  for(uint8_t d = 0; d < sizeof(drifts) / sizeof(drifts[0]); d++){
+    for(uint8_t l = 0; l < sizeof(latencies) / sizeof(latencies[0]); l++){
+      checkRun(drifts[d], latencies[l], true, hours);
+      checkRun(drifts[d], latencies[l], false, hours);
+    }
+  }
+  printf("%u checks, %u failures\n", checks, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,481 @@
+/*!
+ * @file  checkDriver.cpp
+ * @brief Check the request state machine, argument checks, the value/unit cache, the config shadow and
+ * @n     continuous acquisition of DFRobot_LarkWeatherStation against the simulated station
+ * @n     Usage: lark_check_driver
+ * @n     On the simulated clock: responses that stop arriving part way (a read returning 0 bytes, as on an I2C
+ * @n     NACK), responses later than the command limit, corrupt status bytes answered with a resend, line noise
+ * @n     and busy polls. Exits 1 when a behaviour differs, or when a request never finishes.
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "linux/DFRobot_LarkWeatherStation_Sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#define GET_DATA_LIMIT_MS   (100 + 4500)      ///< Limit of CMD_GET_DATA plus the response timeout
+#define RUNAWAY_READS       1000000           ///< Empty reads after which a request is taken to never end
+
+static uint32_t checks = 0, failures = 0;
+
+static void expect(bool ok, const char *what)
+{
+  checks++;
+  if(ok) return;
+  if(failures++ < 20) printf("%s\n", what);
+}
+
+/**
+ * @brief Simulated station whose reads return 0 bytes once a number of response bytes were delivered
+ */
+class StallSim:public DFRobot_LarkWeatherStation_Sim {
+public:
+  StallSim(const sSimConfig_t &config):DFRobot_LarkWeatherStation_Sim(config),stallAt(0xffffffff),stallReads(0),
+    emptyReads(0),_delivered(0),_stalled(0){}
+
+  uint32_t stallAt;      ///< Response bytes delivered before reads come back empty, 0xffffffff never
+  uint32_t stallReads;   ///< Empty reads before the rest of the response is delivered, 0xffffffff never
+  uint32_t emptyReads;   ///< Empty reads answered
+protected:
+  void sendPacket(void *pkt, int length, bool stop = true){
+    _delivered = 0;
+    _stalled = 0;
+    DFRobot_LarkWeatherStation_Sim::sendPacket(pkt, length, stop);
+  }
+  int recvData(void *data, int len){
+    int n;
+    //Before the response is ready a polled station answers 0xff, those reads are not part of it
+    if(!device().pending() || ((int32_t)(millis() - device().readyAt()) < 0)){
+      return DFRobot_LarkWeatherStation_Sim::recvData(data, len);
+    }
+    if((_delivered >= stallAt) && (_stalled < stallReads)){
+      _stalled++;
+      if(++emptyReads >= RUNAWAY_READS){
+        printf("request still running after %u empty reads\n", emptyReads);
+        exit(1);
+      }
+      return 0;
+    }
+    if((_delivered < stallAt) && (_delivered + len > stallAt)) len = stallAt - _delivered;
+    n = DFRobot_LarkWeatherStation_Sim::recvData(data, len);
+    _delivered += n;
+    return n;
+  }
+private:
+  uint32_t _delivered;
+  uint32_t _stalled;
+};
+
+static sSimConfig_t simConfig(bool uart)
+{
+  sSimConfig_t config = DFRobot_LarkWeatherStation_Device::defaultConfig();
+  config.uart = uart;
+  return config;
+}
+
+/**
+ * @brief A read returning nothing part way through a response fails the request at its limit, or is read again
+ */
+static void checkStall(bool uart)
+{
+  static const uint32_t points[] = {0, 1, 2, 4, 6};
+  char what[96];
+  const char *name = uart ? "UART" : "I2C";
+  for(uint8_t i = 0; i < sizeof(points) / sizeof(points[0]); i++){
+    StallSim station(simConfig(uart));
+    String value;
+    uint32_t start;
+    station.device().setValue("Temp", "20.07");
+    station.begin();
+
+    //Header 53 00 05 00 and part of the payload, then nothing
+    station.stallAt = points[i];
+    station.stallReads = 0xffffffff;
+    start = millis();
+    value = station.getValue("Temp");
+    snprintf(what, sizeof(what), "%s stall after %u bytes: value \"%s\", error %u", name, points[i], value.c_str(),
+             station.lastError());
+    expect((value == "") && (station.lastError() == ERR_CODE_RES_TIMEOUT), what);
+    snprintf(what, sizeof(what), "%s stall after %u bytes: failed after %u ms", name, points[i],
+             (unsigned)(millis() - start));
+    expect((millis() - start >= GET_DATA_LIMIT_MS) && (millis() - start <= GET_DATA_LIMIT_MS + 50), what);
+
+    //A few empty reads, then the rest
+    station.stallReads = 3;
+    station.emptyReads = 0;
+    value = station.getValue("Temp");
+    snprintf(what, sizeof(what), "%s 3 empty reads after %u bytes: value \"%s\", error %u", name, points[i],
+             value.c_str(), station.lastError());
+    expect((value == "20.07") && (station.lastError() == ERR_CODE_NONE), what);
+    snprintf(what, sizeof(what), "%s 3 empty reads after %u bytes: %u empty reads", name, points[i], station.emptyReads);
+    expect(station.emptyReads == 3, what);
+  }
+
+  //The payload streamed to a sink
+  for(uint8_t i = 0; i < sizeof(points) / sizeof(points[0]); i++){
+    StallSim station(simConfig(uart));
+    sWeatherSnapshot_t snapshot;
+    station.device().setValue("Temp", "21.50");
+    station.begin();
+    station.stallAt = points[i] + 10;
+    station.stallReads = 0xffffffff;
+    snprintf(what, sizeof(what), "%s snapshot stalled after %u bytes", name, points[i] + 10);
+    expect(!station.getSnapshot(snapshot, false) && (station.lastError() == ERR_CODE_RES_TIMEOUT), what);
+    station.stallReads = 3;
+    snprintf(what, sizeof(what), "%s snapshot with 3 empty reads after %u bytes", name, points[i] + 10);
+    expect(station.getSnapshot(snapshot, false) && (snapshot.valid & LARK_SNAPSHOT_TEMP) && (snapshot.temp == 21.5f),
+           what);
+  }
+}
+
+/**
+ * @brief A response later than the command limit fails with ERR_CODE_RES_TIMEOUT
+ */
+static void checkTimeout(bool uart)
+{
+  DFRobot_LarkWeatherStation_Sim station(simConfig(uart));
+  uint32_t start;
+  station.begin();
+  station.device().setLatency(CMD_GET_DATA, 60000);
+  start = millis();
+  expect(station.getValue("Temp") == "", "late response: a value was returned");
+  expect(station.lastError() == ERR_CODE_RES_TIMEOUT, "late response: not a timeout");
+  expect((millis() - start >= GET_DATA_LIMIT_MS) && (millis() - start <= GET_DATA_LIMIT_MS + 50),
+         "late response: not failed at the limit");
+}
+
+/**
+ * @brief Out of range arguments of the fixed argument commands fail with ERR_CODE_ARGS before anything is sent
+ */
+static void checkArgs(void)
+{
+  DFRobot_LarkWeatherStation_Sim station(simConfig(false));
+  sCommandStats_t stats;
+  sTime_t time;
+  station.begin();
+  expect(station.setTime(2023, 13, 1, 0, 0, 0) == 0, "month 13: accepted");
+  expect(station.setTime(2023, 2, 0, 0, 0, 0) == 0, "day 0: accepted");
+  expect(station.setTime(2023, 2, 1, 24, 0, 0) == 0, "hour 24: accepted");
+  expect(station.setTime(2023, 2, 1, 0, 0, 60) == 0, "second 60: accepted");
+  expect(station.setTime(1999, 2, 1, 0, 0, 0) == 0, "year 1999: accepted");
+  expect(station.lastError() == ERR_CODE_ARGS, "bad time: not ERR_CODE_ARGS");
+  expect(station.setRadius(-1) == 0, "negative radius: accepted");
+  expect(station.lastError() == ERR_CODE_ARGS, "negative radius: not ERR_CODE_ARGS");
+  expect(station.getStats(CMD_SET_TIME, &stats) && (stats.calls == 0), "bad time: sent");
+  expect(station.getStats(CMD_RADIUS_DATA, &stats) && (stats.calls == 0), "negative radius: sent");
+  expect(station.setTime(2023, 12, 31, 23, 59, 58) == 1, "valid time: rejected");
+  expect(station.getTime(time) && (time.year == 2023) && (time.month == 12) && (time.day == 31) &&
+         (time.hour == 23) && (time.minute == 59) && (time.second >= 58), "valid time: not set");
+}
+
+/**
+ * @brief Corrupt status bytes, line noise and busy polls are recovered from without wrong values
+ */
+static void checkRecovery(bool uart, float corrupt, float noise, uint8_t notReady)
+{
+  sSimConfig_t config = simConfig(uart);
+  char what[96], want[16];
+  uint32_t wrong = 0, failed = 0;
+  config.corruptRate = corrupt;
+  config.noiseRate = uart ? noise : 0;
+  config.notReady = uart ? 0 : notReady;
+  config.seed = 7;
+  DFRobot_LarkWeatherStation_Sim station(config);
+  station.begin();
+  for(uint16_t n = 0; n < 300; n++){
+    snprintf(want, sizeof(want), "%u.%02u", 10 + n % 20, n % 100);
+    station.device().setValue("Humi", want);
+    String value = station.getValue("Humi");
+    if(station.lastError() != ERR_CODE_NONE) failed++;
+    else if(value != want) wrong++;
+  }
+  snprintf(what, sizeof(what), "%s corrupt %.2f noise %.2f not ready %u: %u failed, %u wrong", uart ? "UART" : "I2C",
+           corrupt, noise, notReady, failed, wrong);
+  expect((failed == 0) && (wrong == 0), what);
+  if(corrupt > 0){
+    snprintf(what, sizeof(what), "%s corrupt %.2f: %u corrupted, %u resends", uart ? "UART" : "I2C", corrupt,
+             station.device().corrupted, station.device().resets);
+    expect((station.device().corrupted > 0) && (station.device().resets >= station.device().corrupted), what);
+  }
+}
+
+/**
+ * @brief Values are reused within their max-age, units for the whole session
+ */
+static void checkCache(void)
+{
+  DFRobot_LarkWeatherStation_Sim station(simConfig(false));
+  DFRobot_LarkWeatherStation_Device &device = station.device();
+  uint32_t frames, hits, misses;
+  station.begin();
+  device.setValue("Temp", "20.00");
+
+  //No max-age: every read goes to the device
+  frames = device.frames;
+  station.getValue("Temp");
+  station.getValue("Temp");
+  expect(device.frames == frames + 2, "cache: values reused without a max-age");
+
+  station.setMaxAge("Temp", 1000);
+  frames = device.frames;
+  expect(station.getValue("Temp") == "20.00", "cache: first read");
+  device.setValue("Temp", "21.00");
+  delay(500);
+  expect(station.getValue("Temp") == "20.00", "cache: value not reused within its max-age");
+  expect(device.frames == frames + 1, "cache: device read within the max-age");
+  delay(500);
+  expect(station.getValue("Temp") == "21.00", "cache: value reused after its max-age");
+  expect(device.frames == frames + 2, "cache: device not read after the max-age");
+  device.setValue("Temp", "22.00");
+  station.clearCache();
+  expect(station.getValue("Temp") == "22.00", "cache: value reused after clearCache()");
+
+  //Keys without their own setting follow the default, the others keep theirs
+  station.setMaxAge(NULL, 60000);
+  device.setValue("Humi", "40.00");
+  frames = device.frames;
+  station.getValue("Humi");
+  device.setValue("Humi", "41.00");
+  delay(30000);
+  expect(station.getValue("Humi") == "40.00", "cache: default max-age not applied");
+  expect(device.frames == frames + 1, "cache: device read within the default max-age");
+  delay(1000);
+  station.getValue("Temp");
+  expect(device.frames == frames + 2, "cache: own max-age replaced by the default");
+
+  //Units are read once
+  frames = device.frames;
+  station.getCacheStats(&hits, &misses);
+  expect(station.getUnit("Pressure") == "hPa", "cache: unit");
+  expect(station.getUnit("Pressure") == "hPa", "cache: cached unit");
+  expect(device.frames == frames + 1, "cache: unit read twice");
+  expect(station.getUnit(eSensorPressure) == "hPa", "cache: unit by sensor ID");
+  expect(device.frames == frames + 1, "cache: unit by sensor ID read again");
+  frames = hits;
+  station.getCacheStats(&hits, &misses);
+  expect(hits == frames + 2, "cache: hits not counted");
+
+  //A failed read leaves the cached value alone and is not cached
+  station.setMaxAge("Speed", 1000);
+  device.setValue("Speed", "3.50");
+  station.getValue("Speed");
+  delay(1000);
+  device.setLatency(CMD_GET_DATA, 60000);
+  expect(station.getValue("Speed") == "", "cache: expired value returned when the read failed");
+  device.setLatency(CMD_GET_DATA, 5);
+  delay(100);
+  device.setValue("Speed", "4.50");
+  expect(station.getValue("Speed") == "4.50", "cache: failed read cached");
+}
+
+static sConfigShadow_t stored;
+static bool storedValid = false;
+static uint32_t storeCalls = 0;
+
+static bool loadShadow(void *ctx, sConfigShadow_t *shadow)
+{
+  (void)ctx;
+  if(!storedValid) return false;
+  *shadow = stored;
+  return true;
+}
+
+static void storeShadow(void *ctx, const sConfigShadow_t *shadow)
+{
+  (void)ctx;
+  stored = *shadow;
+  storedValid = true;
+  storeCalls++;
+}
+
+/**
+ * @brief Only changed configuration items are written, across restarts when the shadow is persisted
+ */
+static void checkConfig(void)
+{
+  sStationConfig_t config;
+  char what[96];
+  int sent;
+  uint32_t frames;
+  memset(&config, 0, sizeof(config));
+  config.dtuSwitch = "on";
+  config.dtuMethod = "wifi";
+  config.ssid = "lark";
+  config.password = "secret";
+  config.mqttServer = "iot";
+  config.mqttServerIp = "10.0.0.1";
+  config.mqttSave = "1";
+  config.iotPwd = "pwd";
+  config.iotId = "id";
+  config.topicName[0] = "Temp";
+  config.topicKey[0] = "t1";
+  config.topicName[1] = "Humi";
+  config.topicKey[1] = "h1";
+  {
+    DFRobot_LarkWeatherStation_Sim station(simConfig(true));
+    DFRobot_LarkWeatherStation_Device &device = station.device();
+    station.begin();
+    station.setConfigStore(loadShadow, storeShadow, NULL);
+    sent = station.applyConfig(config);
+    snprintf(what, sizeof(what), "config: %d commands sent at first, want 6", sent);
+    expect(sent == 6, what);
+    frames = device.frames;
+    expect(station.applyConfig(config) == 0, "config: unchanged configuration sent again");
+    expect(device.frames == frames, "config: frames sent for an unchanged configuration");
+    config.password = "changed";
+    expect(station.applyConfig(config) == 1, "config: not exactly the changed item sent");
+    config.topicKey[1] = "h2";
+    expect(station.applyConfig(config) == 1, "config: not exactly the changed topic sent");
+    //A direct write of the same arguments is remembered, a topic write forgets the topics
+    station.configWIFI((char *)"lark", (char *)"direct");
+    config.password = "direct";
+    expect(station.applyConfig(config) == 0, "config: direct write not remembered");
+    station.configTopic((char *)"Temp", (char *)"t1");
+    expect(station.applyConfig(config) == 2, "config: topics not written again after configTopic()");
+    //A failed write is not remembered
+    config.ssid = "other";
+    device.setLatency(CMD_WIFI, 60000);
+    expect(station.applyConfig(config) == -1, "config: failed write not reported");
+    device.setLatency(CMD_WIFI, 5);
+    delay(100);
+    expect(station.applyConfig(config) == 1, "config: failed write remembered");
+    station.clearConfigShadow();
+    expect(station.applyConfig(config) == 6, "config: clearConfigShadow() kept items");
+  }
+  {
+    //A restart loading the persisted shadow sends nothing
+    DFRobot_LarkWeatherStation_Sim station(simConfig(true));
+    station.begin();
+    expect(storeCalls > 0, "config: shadow never stored");
+    station.setConfigStore(loadShadow, storeShadow, NULL);
+    expect(station.applyConfig(config) == 0, "config: persisted shadow not used");
+  }
+  {
+    //Damaged storage is ignored
+    DFRobot_LarkWeatherStation_Sim station(simConfig(true));
+    station.begin();
+    stored.hash[0] ^= 1;
+    station.setConfigStore(loadShadow, storeShadow, NULL);
+    expect(station.applyConfig(config) == 6, "config: damaged shadow used");
+  }
+}
+
+/**
+ * @brief Run continuous acquisition for a time on the simulated clock
+ */
+static void runFor(DFRobot_LarkWeatherStation &station, uint32_t ms)
+{
+  uint32_t start = millis();
+  while(millis() - start < ms){
+    station.runContinuous();
+    delay(1);
+  }
+}
+
+/**
+ * @brief Continuous acquisition keeps its cadence and the ring its records and loss counters
+ */
+static void checkContinuous(void)
+{
+  sSampleRecord_t records[LARK_SAMPLE_RING_SIZE + 1];
+  uint32_t dropped, failed, stamp, start;
+  uint16_t n;
+  char what[96];
+  bool ok;
+  {
+    DFRobot_LarkWeatherStation_Sim station(simConfig(false));
+    DFRobot_LarkWeatherStation_Device &device = station.device();
+    station.begin();
+    device.setValue("Temp", "-3.25");
+    device.setValue("Speed", "4.10");
+    device.setValue("Dir", "WSW");
+    expect(!station.startContinuous(0), "continuous: period 0 accepted");
+    expect(station.startContinuous(1000, LARK_SNAPSHOT_TEMP | LARK_SNAPSHOT_SPEED | LARK_SNAPSHOT_DIR), "continuous: start");
+    start = millis();
+    runFor(station, 20500);
+    n = station.drain(records, LARK_SAMPLE_RING_SIZE, &stamp);
+    snprintf(what, sizeof(what), "continuous: %u records in 20.5 s at 1 s", n);
+    expect(n == 21, what);
+    expect(stamp == start, "continuous: first stamp not the start");
+    ok = true;
+    for(uint16_t i = 0; i < n; i++){
+      ok = ok && (records[i].delta == (i ? 100 : 0));
+      ok = ok && (records[i].valid == (LARK_SNAPSHOT_TEMP | LARK_SNAPSHOT_SPEED | LARK_SNAPSHOT_DIR));
+      ok = ok && (records[i].temp == -325) && (records[i].speed == 410) && (records[i].direction == 2475);
+      ok = ok && (records[i].humidity == 0) && (records[i].pressure == 0);
+    }
+    expect(ok, "continuous: record contents");
+    expect(station.samplesAvailable() == 0, "continuous: records left after draining");
+
+    //Other requests fit between samples
+    expect(station.getValue("Temp") == "-3.25", "continuous: getValue() between samples");
+
+    //Failed samples are counted and leave no record
+    device.setLatency(CMD_GET_ALL_DATA, 60000);
+    runFor(station, 10000);
+    station.getSampleStats(&dropped, &failed);
+    expect((failed >= 1) && (station.samplesAvailable() == 0), "continuous: failed sample not counted");
+    device.setLatency(CMD_GET_ALL_DATA, 5);
+    runFor(station, 100);
+    station.drain(records, LARK_SAMPLE_RING_SIZE);
+
+    //Overwrite keeps the newest records
+    station.startContinuous(1000);
+    runFor(station, (LARK_SAMPLE_RING_SIZE + 10) * 1000 - 500);
+    station.getSampleStats(&dropped, NULL);
+    snprintf(what, sizeof(what), "continuous overwrite: %u records, %u dropped", station.samplesAvailable(), dropped);
+    expect((station.samplesAvailable() == LARK_SAMPLE_RING_SIZE) && (dropped == 10), what);
+    n = station.drain(records, LARK_SAMPLE_RING_SIZE + 1, &stamp);
+    expect((n == LARK_SAMPLE_RING_SIZE) && (millis() - stamp < (LARK_SAMPLE_RING_SIZE + 1) * 1000),
+           "continuous overwrite: oldest records kept");
+    station.stopContinuous();
+  }
+  {
+    //Block keeps the oldest records and skips samples until drained
+    DFRobot_LarkWeatherStation_Sim station(simConfig(true));
+    station.begin();
+    station.startContinuous(1000, LARK_SAMPLE_FIELDS, eSampleBlock);
+    start = millis();
+    runFor(station, (LARK_SAMPLE_RING_SIZE + 10) * 1000 - 500);
+    station.getSampleStats(&dropped, NULL);
+    snprintf(what, sizeof(what), "continuous block: %u records, %u dropped", station.samplesAvailable(), dropped);
+    expect((station.samplesAvailable() == LARK_SAMPLE_RING_SIZE) && (dropped == 10), what);
+    n = station.drain(records, 1, &stamp);
+    expect((n == 1) && (stamp == start), "continuous block: newest records kept");
+    runFor(station, 1000);
+    expect(station.samplesAvailable() == LARK_SAMPLE_RING_SIZE, "continuous block: no sample taken after draining");
+    station.stopContinuous();
+    runFor(station, 5000);
+    expect(station.samplesAvailable() == LARK_SAMPLE_RING_SIZE, "continuous: sample taken after stopContinuous()");
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  (void)argv;
+  if(argc > 1){
+    fprintf(stderr, "usage: lark_check_driver\n");
+    return 1;
+  }
+  setVirtualClock(true);
+  checkStall(false);
+  checkStall(true);
+  checkTimeout(false);
+  checkTimeout(true);
+  checkArgs();
+  checkRecovery(false, 0.3, 0, 0);
+  checkRecovery(false, 0, 0, 3);
+  checkRecovery(false, 0.3, 0, 3);
+  checkRecovery(true, 0.3, 0, 0);
+  checkRecovery(true, 0, 0.3, 0);
+  checkRecovery(true, 0.3, 0.3, 0);
+  checkCache();
+  checkConfig();
+  checkContinuous();
+  printf("%u checks, %u failures\n", checks, failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,236 @@
+/*!
+ * @file  checkWind.cpp
+ * @brief Compare DFRobot_LarkWeatherStation_Wind with a naive recomputation from the kept samples
+ * @n     Usage: lark_check_wind [--samples N] [--seed N]
+ * @n     Fixed cases first: the 3 s gust over the LARK_WIND_GUST_SLOTS slots, directions around north and the speed
+ * @n     weighting of the mean direction, a run across the wrap of millis(). Then random samples with gaps and late
+ * @n     stamps, starting shortly before the wrap, after each of which the gust, both windows and the interval are
+ * @n     recomputed. Exits 1 on a mismatch.
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation_Wind.h"
+#include <stdio.h>
+#include <math.h>
+#include <random>
+#include <vector>
+
+#define GUST_SLOT_MS    (LARK_WIND_GUST_MS / LARK_WIND_GUST_SLOTS)
+
+static const uint32_t windowSpan[eWindWindows] = {120000, 600000};
+static uint32_t mismatches = 0, checks = 0;
+
+typedef struct{
+  uint32_t stamp;
+  uint32_t since;   /**< Time since the first sample, slots and buckets start from it */
+  float speed;
+  float direction;
+  float gust;       /**< 3 s mean as of this sample */
+}sWindSample_t;
+
+static bool near(double a, double b, double tolerance)
+{
+  return fabs(a - b) <= tolerance * (fabs(b) + 1);
+}
+
+static double angleDiff(double a, double b)
+{
+  double d = fmod(fabs(a - b), 360);
+  return (d > 180) ? 360 - d : d;
+}
+
+static void expect(bool ok, const char *what, double got, double want)
+{
+  checks++;
+  if(ok) return;
+  if(mismatches++ < 20) printf("%s: got %g, want %g\n", what, got, want);
+}
+
+/**
+ * @brief Wind statistics over the samples selected by keep, directions weighted by speed
+ */
+template<typename F> static bool naiveStat(const std::vector<sWindSample_t> &samples, F keep, sWindStat_t *stat)
+{
+  double speed = 0, u = 0, v = 0, gust = 0;
+  uint32_t count = 0;
+  for(size_t i = 0; i < samples.size(); i++){
+    const sWindSample_t &s = samples[i];
+    if(!keep(s)) continue;
+    speed += s.speed;
+    u += s.speed * sin(s.direction * M_PI / 180);
+    v += s.speed * cos(s.direction * M_PI / 180);
+    if((count == 0) || (s.gust > gust)) gust = s.gust;
+    count++;
+  }
+  if(count == 0) return false;
+  stat->count = count;
+  stat->speed = speed / count;
+  stat->vectorSpeed = sqrt(u * u + v * v) / count;
+  stat->direction = atan2(u, v) * 180 / M_PI;
+  if(stat->direction < 0) stat->direction += 360;
+  stat->gust = gust;
+  return true;
+}
+
+static void compare(const char *name, bool hasGot, const sWindStat_t &got, bool hasWant, const sWindStat_t &want)
+{
+  char what[64];
+  snprintf(what, sizeof(what), "%s samples", name);
+  expect(hasGot == hasWant, what, hasGot, hasWant);
+  if(!hasGot || !hasWant) return;
+  snprintf(what, sizeof(what), "%s count", name);
+  expect(got.count == want.count, what, got.count, want.count);
+  snprintf(what, sizeof(what), "%s speed", name);
+  expect(near(got.speed, want.speed, 1e-4), what, got.speed, want.speed);
+  snprintf(what, sizeof(what), "%s vector speed", name);
+  expect(near(got.vectorSpeed, want.vectorSpeed, 1e-3), what, got.vectorSpeed, want.vectorSpeed);
+  snprintf(what, sizeof(what), "%s gust", name);
+  expect(near(got.gust, want.gust, 1e-4), what, got.gust, want.gust);
+  //The direction of a nearly calm mean vector is rounding noise
+  if(want.vectorSpeed > 0.01 * want.speed){
+    snprintf(what, sizeof(what), "%s direction", name);
+    expect(angleDiff(got.direction, want.direction) < 0.05, what, got.direction, want.direction);
+  }
+}
+
+static void checkFixed(void)
+{
+  DFRobot_LarkWeatherStation_Wind wind;
+  sWindStat_t stat;
+
+  //One sample per gust slot with speed = slot number: the mean covers the last 12 slots only
+  for(uint32_t slot = 0; slot < 30; slot++){
+    double want = 0;
+    uint32_t first = (slot >= LARK_WIND_GUST_SLOTS) ? slot - LARK_WIND_GUST_SLOTS + 1 : 0;
+    wind.add(100000 + slot * GUST_SLOT_MS, slot, 0);
+    for(uint32_t s = first; s <= slot; s++) want += s;
+    want /= slot - first + 1;
+    expect(near(wind.gustSpeed(), want, 1e-6), "3 s mean over the gust slots", wind.gustSpeed(), want);
+  }
+  //A gap longer than 3 s leaves only the new sample
+  wind.add(100000 + 30 * GUST_SLOT_MS + LARK_WIND_GUST_MS, 2, 0);
+  expect(near(wind.gustSpeed(), 2, 1e-6), "3 s mean after a gap", wind.gustSpeed(), 2);
+  //The 2 minute gust is the highest 3 s mean seen, 29 + 28 + ... + 18 over 12
+  wind.get(eWindTwoMinute, &stat);
+  expect(near(stat.gust, 23.5, 1e-6), "2 minute gust", stat.gust, 23.5);
+
+  //350 and 10 degrees average to north, not south
+  wind.clear();
+  for(uint32_t i = 0; i < 20; i++) wind.add(i * 1000, 5, (i & 1) ? 10 : 350);
+  wind.get(eWindTwoMinute, &stat);
+  expect(angleDiff(stat.direction, 0) < 0.01, "mean of 350 and 10 degrees", stat.direction, 0);
+  expect(near(stat.vectorSpeed, 5 * cos(10 * M_PI / 180), 1e-5), "vector speed around north", stat.vectorSpeed,
+         5 * cos(10 * M_PI / 180));
+  expect(near(stat.speed, 5, 1e-6), "scalar speed around north", stat.speed, 5);
+  //Crossing north in one direction only
+  wind.clear();
+  for(uint32_t i = 0; i < 21; i++) wind.add(i * 1000, 3, fmod(340 + i * 2, 360));
+  wind.get(eWindTwoMinute, &stat);
+  expect(angleDiff(stat.direction, 0) < 0.01, "mean of 340 to 20 degrees", stat.direction, 0);
+
+  //The mean direction is weighted by speed: 3 m/s from the east and 1 m/s from the north
+  wind.clear();
+  wind.add(0, 3, 90);
+  wind.add(1000, 1, 0);
+  wind.get(eWindTwoMinute, &stat);
+  expect(angleDiff(stat.direction, atan2(3, 1) * 180 / M_PI) < 0.01, "speed weighted direction", stat.direction,
+         atan2(3, 1) * 180 / M_PI);
+
+  //Opposite winds cancel out to calm, reported as 0 degrees
+  wind.clear();
+  wind.add(0, 4, 90);
+  wind.add(1000, 4, 270);
+  wind.get(eWindTwoMinute, &stat);
+  expect(stat.direction == 0, "direction of calm", stat.direction, 0);
+
+  //One sample a second across the wrap of millis()
+  wind.clear();
+  for(uint32_t n = 0; n < 600; n++) wind.add(0xffffffffUL - 30000 + n * 1000, n % 7, 90);
+  wind.get(eWindTwoMinute, &stat);
+  expect(stat.count == 120, "2 minute count across the wrap", stat.count, 120);
+  wind.get(eWindTenMinute, &stat);
+  expect(stat.count == 600, "10 minute count across the wrap", stat.count, 600);
+  //The last three samples, 597 to 599
+  expect(near(wind.gustSpeed(), (2 + 3 + 4) / 3.0, 1e-6), "3 s mean across the wrap", wind.gustSpeed(), 3);
+}
+
+int main(int argc, char *argv[])
+{
+  uint32_t samples = 30000, seed = 1;
+  for(int i = 1; i < argc; i++){
+    if((strcmp(argv[i], "--samples") == 0) && (i + 1 < argc)) samples = atoi(argv[++i]);
+    else if((strcmp(argv[i], "--seed") == 0) && (i + 1 < argc)) seed = atoi(argv[++i]);
+    else{
+      fprintf(stderr, "usage: %s [--samples N] [--seed N]\n", argv[0]);
+      return 1;
+    }
+  }
+  checkFixed();
+
+  DFRobot_LarkWeatherStation_Wind wind;
+  std::vector<sWindSample_t> kept;
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> unit(0, 1);
+  //Start 10 minutes before millis() wraps
+  uint32_t stamp = 0xffffffffUL - 600000, origin = 0, intervalStart = 0, newestSlot = 0;
+  double heading = 180;
+  for(uint32_t n = 0; n < samples; n++){
+    sWindSample_t sample;
+    double roll = unit(rng);
+    //Mostly 4 Hz, now and then a gap; some samples are late and the older of them fall before the newest gust slot
+    if(roll < 0.002) stamp += 5000 + rng() % 900000;
+    else stamp += 50 + rng() % 400;
+    sample.stamp = (unit(rng) < 0.05) ? stamp - rng() % 400 : stamp;
+    heading = fmod(heading + 360 + (unit(rng) - 0.5) * 20, 360);
+    sample.speed = unit(rng) * 12;
+    sample.direction = fmod(heading + (unit(rng) - 0.5) * 60 + 360, 360);
+    wind.add(sample.stamp, sample.speed, sample.direction);
+    if(n == 0) origin = sample.stamp;
+    //A late sample before the first one or the newest gust slot is ignored
+    if((int32_t)(sample.stamp - origin) < 0) continue;
+    sample.since = sample.stamp - origin;
+    if(!kept.empty() && (sample.since / GUST_SLOT_MS < newestSlot)) continue;
+    newestSlot = sample.since / GUST_SLOT_MS;
+
+    //3 s mean over the samples of the last LARK_WIND_GUST_SLOTS slots
+    kept.push_back(sample);
+    double sum = 0;
+    uint32_t count = 0;
+    for(size_t i = kept.size(); i-- > 0;){
+      if(newestSlot - kept[i].since / GUST_SLOT_MS >= LARK_WIND_GUST_SLOTS) break;
+      sum += kept[i].speed;
+      count++;
+    }
+    kept.back().gust = sum / count;
+    expect(near(wind.gustSpeed(), kept.back().gust, 1e-4), "gust", wind.gustSpeed(), kept.back().gust);
+
+    for(uint8_t w = 0; w < eWindWindows; w++){
+      uint32_t bucketMs = windowSpan[w] / LARK_WIND_BUCKETS, newest = sample.since / bucketMs;
+      sWindStat_t got, want;
+      bool hasGot = wind.get((eWindWindow_t)w, &got);
+      bool hasWant = naiveStat(kept, [&](const sWindSample_t &s){ return newest - s.since / bucketMs < LARK_WIND_BUCKETS; }, &want);
+      compare(w == eWindTwoMinute ? "2 minute" : "10 minute", hasGot, got, hasWant, want);
+    }
+    if(n % 1000 == 999){
+      sWindStat_t got, want;
+      size_t first = intervalStart;
+      bool hasWant = naiveStat(kept, [&](const sWindSample_t &s){ return &s >= kept.data() + first; }, &want);
+      bool hasGot = wind.takeInterval(&got);
+      compare("interval", hasGot, got, hasWant, want);
+      intervalStart = kept.size();
+    }
+    //Keep what the 10 minute window and the interval can still need
+    if(kept.size() > 20000){
+      size_t drop = kept.size() - 10000;
+      if(drop > intervalStart) drop = intervalStart;
+      kept.erase(kept.begin(), kept.begin() + drop);
+      intervalStart -= drop;
+    }
+  }
+  printf("%u samples, %u checks, %u mismatches\n", samples, checks, mismatches);
+  return mismatches ? 1 : 0;
+}
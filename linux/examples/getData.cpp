@@ -0,0 +1,49 @@
+/*!
+ * @file  getData.cpp
+ * @brief This is a routine to get skylark data from a Linux gateway
+ * @n     Usage: lark_get_data [uart DEVICE | i2c DEVICE]
+ * @copyright	Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+ * @license   The MIT License (MIT)
+ * @author    [TangJie](jie.tang@dfrobot.com)
+ * @version   V1.0
+ * @date      2023-07-03
+ * @url       https://github.com/DFRobot/DFRobot_LarkWeatherStation
+ */
+#include "DFRobot_LarkWeatherStation.h"
+#include <stdio.h>
+
+#define DEVICE_ADDR                  0x42
+
+int main(int argc, char *argv[])
+{
+  DFRobot_LarkWeatherStation *atm;
+  if((argc > 2) && (strcmp(argv[1], "i2c") == 0)){
+    atm = new DFRobot_LarkWeatherStation_I2C(DEVICE_ADDR, argv[2]);
+  }else{
+    atm = new DFRobot_LarkWeatherStation_UART(argc > 2 ? argv[2] : LARK_LINUX_UART_DEVICE);
+  }
+  while(atm->begin() != 0){
+    Serial.println("init error");
+    delay(1000);
+  }
+  Serial.println("init success");
+  atm->setMaxAge(NULL, 1000);
+  while(true){
+    sWeatherSnapshot_t snapshot;
+    if(atm->getSnapshot(snapshot)){
+      printf("%04u/%02u/%02u %02u:%02u:%02u\n", snapshot.time.year, snapshot.time.month, snapshot.time.day,
+             snapshot.time.hour, snapshot.time.minute, snapshot.time.second);
+      printf("Temp: %.2f%s\n", snapshot.temp, atm->getUnit(eSensorTemp).c_str());
+      printf("Humi: %.2f%s\n", snapshot.humidity, atm->getUnit(eSensorHumi).c_str());
+      printf("Speed: %.2f%s\n", snapshot.speed, atm->getUnit(eSensorSpeed).c_str());
+      printf("Dir: %.1f\n", snapshot.direction);
+      printf("Altitude: %.2f%s\n", snapshot.altitude, atm->getUnit(eSensorAltitude).c_str());
+      printf("Pressure: %.2f%s\n", snapshot.pressure, atm->getUnit(eSensorPressure).c_str());
+    }else{
+      printf("read error %d\n", atm->lastError());
+    }
+    fflush(stdout);
+    delay(1000);
+  }
+  return 0;
+}
@@ -5,18 +5,20 @@
   @copyright   Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
   @license     The MIT License (MIT)
   @author      TangJie(jie.tang@dfrobot.com)
-  @version     V1.0
+  @version     V1.1
   @date        2023-07-03
   @url         https://github.com/DFRobor/DFRobot_LarkWeatherStation
 '''
-import serial
 import time
-import smbus
-import os
-import math
-import RPi.GPIO as GPIO
-import math
-import serial
+try:
+  import serial
+except ImportError:
+  serial = None
+try:
+  from smbus2 import SMBus, i2c_msg
+except ImportError:
+  SMBus = None
+  i2c_msg = None
 
 
 I2C_MODE                  = 0x01
@@ -52,7 +54,7 @@ class DFRobot_Atmospherlum:
   CMD_END         =    CMD_TOP
 
 
-  ERR_CODE_NONE           =    0x00 #Normal communication 
+  ERR_CODE_NONE           =    0x00 #Normal communication
   ERR_CODE_CMD_INVAILED    =   0x01 #Invalid command
   ERR_CODE_RES_PKT         =   0x02 #Response packet error
   ERR_CODE_M_NO_SPACE      =   0x03 #Insufficient memory of I2C controller(master)
@@ -64,8 +66,9 @@ class DFRobot_Atmospherlum:
   ERR_CODE_S_NO_SPACE       =  0x09 # Insufficient memory of I2C peripheral(slave)
   ERR_CODE_I2C_ADRESS      =   0x0A # Invalid I2C address
 
-  STATUS_SUCCESS   =   0x53  #Status of successful response   
-  STATUS_FAILED     =  0x63  # Status of failed response 
+  STATUS_SUCCESS   =   0x53  #Status of successful response
+  STATUS_FAILED     =  0x63  # Status of failed response
+  STATUS_CORRUPT    =  0xD3  # Garbled status, the device sends the response again after CMD_RESET_DATA
 
   INDEX_CMD        = 0
   INDEX_ARGS_NUM_L = 1
@@ -86,9 +89,21 @@ class DFRobot_Atmospherlum:
   INDEX_RES_LEN_L  = 3
   INDEX_RES_LEN_H  = 4
   INDEX_RES_DATA   = 5
+
+  POLL_MIN          = 0.002  # First gap between two status polls, s
+  POLL_MAX          = 0.05   # Largest gap between two status polls, s
+
+  # Usual processing time of a command in s, the first status poll is made after it
+  LATENCY = {CMD_RADIUS_DATA: 0.2, CMD_CALIBRATOR: 0.2, CMD_SPEED1_DATA: 1.0, CMD_SPEED2_DATA: 1.0,
+             CMD_GET_ALL_DATA: 0.01, CMD_DTU: 0.02, CMD_WIFI: 0.02, CMD_LORA: 0.02, CMD_MQTT1: 0.02,
+             CMD_MQTT2: 0.02, CMD_TOP: 0.02}
+  # Longest processing time of a command in s, the response timeout runs after it
+  DEADLINE = {CMD_RADIUS_DATA: 2.0, CMD_CALIBRATOR: 10.0, CMD_SPEED1_DATA: 10.0, CMD_SPEED2_DATA: 10.0}
+
   def __init__(self):
-    pass
-  
+    self._latency = dict(self.LATENCY)
+    self._deadline = dict(self.DEADLINE)
+
   def begin(self):
     '''!
       @brief Initialize the SCI acquisition module, mainly used for initializing the communication interface
@@ -97,31 +112,25 @@ class DFRobot_Atmospherlum:
       @n      others  Initialization failed
     '''
     return 0
+
+  def set_deadline(self, cmd, deadline, latency = None):
+    '''!
+      @brief Set how long a command may take before its response times out
+      @param cmd Command, e.g. CMD_GET_DATA
+      @param deadline Seconds from sending the command to the last status poll
+      @param latency Seconds before the first status poll, None keeps the current one
+    '''
+    self._deadline[cmd] = deadline
+    if latency is not None:
+      self._latency[cmd] = latency
+
   def get_value(self, keys):
     '''!
       @brief Get sensor data
       @param keys  Data to be obtained
       @return Returns the acquired data
     '''
-    rslt = ""
-    length = len(keys)
-    pkt = [0] * (3 + length)
-    pkt[self.INDEX_CMD]        = self.CMD_GET_DATA
-    pkt[self.INDEX_ARGS_NUM_L] = length & 0xFF
-    pkt[self.INDEX_ARGS_NUM_H] = (length >> 8) & 0xFF
-    i = 0
-    for c in keys:
-      pkt[self.INDEX_ARGS + i] = ord(c)
-      i += 1
-    self._send_packet(pkt)
-    #time.sleep(0.1)
-    recv_pkt = self._recv_packet(self.CMD_GET_DATA)
-    if (len(recv_pkt) >= 5) and (recv_pkt[self.INDEX_RES_ERR] == self.ERR_CODE_NONE and recv_pkt[self.INDEX_RES_STATUS] == self.STATUS_SUCCESS):
-      length = recv_pkt[self.INDEX_RES_LEN_L] | (recv_pkt[self.INDEX_RES_LEN_H] << 8)
-      if length:
-        for data in recv_pkt[self.INDEX_RES_DATA:]:
-          rslt += chr(data)
-    return rslt
+    return self._execute_text(self.CMD_GET_DATA, keys)
 
   def get_unit(self, keys):
     '''!
@@ -129,100 +138,36 @@ class DFRobot_Atmospherlum:
       @param keys  Data for which units need to be obtained
       @return Returns the obtained units
     '''
-    rslt = ""
-    length = len(keys)
-    pkt = [0] * (3 + length)
-    pkt[self.INDEX_CMD]        = self.CMD_GET_UNIT
-    pkt[self.INDEX_ARGS_NUM_L] = length & 0xFF
-    pkt[self.INDEX_ARGS_NUM_H] = (length >> 8) & 0xFF
-    i = 0
-    for c in keys:
-      pkt[self.INDEX_ARGS + i] = ord(c)
-      i += 1
-    self._send_packet(pkt)
-    #time.sleep(0.1)
-    recv_pkt = self._recv_packet(self.CMD_GET_UNIT)
-    if (len(recv_pkt) >= 5) and (recv_pkt[self.INDEX_RES_ERR] == self.ERR_CODE_NONE and recv_pkt[self.INDEX_RES_STATUS] == self.STATUS_SUCCESS):
-      length = recv_pkt[self.INDEX_RES_LEN_L] | (recv_pkt[self.INDEX_RES_LEN_H] << 8)
-      if length:
-        for data in recv_pkt[self.INDEX_RES_DATA:]:
-          rslt += chr(data)
-    return rslt
-  
+    return self._execute_text(self.CMD_GET_UNIT, keys)
+
   def set_radius(self,radius):
     '''!
-      @brief Set standard wind speed 1. 
-      @param speed Data for standard wind speed 1
+      @brief Set the radius of the anemometer cup
+      @param radius Radius in cm
+      @return 1 when the device accepted it, 0 otherwise
     '''
-    length = 2
-    data = radius * 100;
-    pkt = [0] * (3 + length)
-    pkt[self.INDEX_CMD]        = self.CMD_RADIUS_DATA
-    pkt[self.INDEX_ARGS_NUM_L] = length & 0xFF
-    pkt[self.INDEX_ARGS_NUM_H] = (length >> 8) & 0xFF
-    pkt[self.INDEX_ARGS + 0]       = data >> 8
-    pkt[self.INDEX_ARGS + 1]       = data & 0xff
-    self._send_packet(pkt)
-    time.sleep(2)
-    recv_pkt = self._recv_packet(self.CMD_RADIUS_DATA)
-    if (len(recv_pkt) >= 5) and (recv_pkt[self.INDEX_RES_ERR] == self.ERR_CODE_NONE and recv_pkt[self.INDEX_RES_STATUS] == self.STATUS_SUCCESS):
-      length = recv_pkt[self.INDEX_RES_LEN_L] | (recv_pkt[self.INDEX_RES_LEN_H] << 8)
-      return 1
-    
+    return self._execute_status(self.CMD_RADIUS_DATA, self._centi_args(radius))
+
   def set_speed1(self,speed1):
     '''!
-      @brief Set standard wind speed 2.
-      @param speed Data for standard wind speed 2
+      @brief Set standard wind speed 1.
+      @param speed1 Data for standard wind speed 1
     '''
-    length = 2
-    data = speed1 * 100;
-    pkt = [0] * (3 + length)
-    pkt[self.INDEX_CMD]        = self.CMD_SPEED1_DATA
-    pkt[self.INDEX_ARGS_NUM_L] = length & 0xFF
-    pkt[self.INDEX_ARGS_NUM_H] = (length >> 8) & 0xFF
-    pkt[self.INDEX_ARGS + 0]       = data >> 8
-    pkt[self.INDEX_ARGS + 1]       = data & 0xff
-    self._send_packet(pkt)
-    time.sleep(10)
-    recv_pkt = self._recv_packet(self.CMD_SPEED1_DATA)
-    if (len(recv_pkt) >= 5) and (recv_pkt[self.INDEX_RES_ERR] == self.ERR_CODE_NONE and recv_pkt[self.INDEX_RES_STATUS] == self.STATUS_SUCCESS):
-      length = recv_pkt[self.INDEX_RES_LEN_L] | (recv_pkt[self.INDEX_RES_LEN_H] << 8)
-    
+    return self._execute_status(self.CMD_SPEED1_DATA, self._centi_args(speed1))
+
   def set_speed2(self,speed2):
     '''!
-      @brief Start calculating data.
-      @return Status data
+      @brief Set standard wind speed 2.
+      @param speed2 Data for standard wind speed 2
     '''
-    length = 2
-    data = speed2 * 100;
-    pkt = [0] * (3 + length)
-    pkt[self.INDEX_CMD]        = self.CMD_SPEED2_DATA
-    pkt[self.INDEX_ARGS_NUM_L] = length & 0xFF
-    pkt[self.INDEX_ARGS_NUM_H] = (length >> 8) & 0xFF
-    pkt[self.INDEX_ARGS + 0]       = data >> 8
-    pkt[self.INDEX_ARGS + 1]       = data & 0xff
-    self._send_packet(pkt)
-    time.sleep(10)
-    recv_pkt = self._recv_packet(self.CMD_SPEED2_DATA)
-    if (len(recv_pkt) >= 5) and (recv_pkt[self.INDEX_RES_ERR] == self.ERR_CODE_NONE and recv_pkt[self.INDEX_RES_STATUS] == self.STATUS_SUCCESS):
-      length = recv_pkt[self.INDEX_RES_LEN_L] | (recv_pkt[self.INDEX_RES_LEN_H] << 8)
-    
+    return self._execute_status(self.CMD_SPEED2_DATA, self._centi_args(speed2))
+
   def calibration_speed(self):
     '''!
-      @brief Configure DTU enablement.
-      @param dtuswitch DTU switch
-      @param method Operation mode
+      @brief Start calculating data.
+      @return Status data
     '''
-    length = 0
-    pkt = [0] * (3 + length)
-    pkt[self.INDEX_CMD]        = self.CMD_CALIBRATOR
-    pkt[self.INDEX_ARGS_NUM_L] = length & 0xFF
-    pkt[self.INDEX_ARGS_NUM_H] = (length >> 8) & 0xFF
-    self._send_packet(pkt)
-    time.sleep(10)
-    recv_pkt = self._recv_packet(self.CMD_CALIBRATOR)
-    if (len(recv_pkt) >= 5) and (recv_pkt[self.INDEX_RES_ERR] == self.ERR_CODE_NONE and recv_pkt[self.INDEX_RES_STATUS] == self.STATUS_SUCCESS):
-      length = recv_pkt[self.INDEX_RES_LEN_L] | (recv_pkt[self.INDEX_RES_LEN_H] << 8)
+    return self._execute_text(self.CMD_CALIBRATOR, "")
 
   def get_information(self, state):
     '''!
@@ -230,25 +175,7 @@ class DFRobot_Atmospherlum:
       @param state true: include timestamp, false: do not include timestamp
       @return String Returns all the acquired data
     '''
-    rslt = ""
-    length = 1
-    pkt = [0] * (3 + length)
-    pkt[self.INDEX_CMD]        = self.CMD_GET_ALL_DATA
-    pkt[self.INDEX_ARGS_NUM_L] = length & 0xFF
-    pkt[self.INDEX_ARGS_NUM_H] = (length >> 8) & 0xFF
-    if state == True :
-      pkt[self.INDEX_ARGS]       = 1
-    else:
-      pkt[self.INDEX_ARGS]       = 0
-    self._send_packet(pkt)
-    time.sleep(0.1)
-    recv_pkt = self._recv_packet(self.CMD_GET_ALL_DATA)
-    if (len(recv_pkt) >= 5) and (recv_pkt[self.INDEX_RES_ERR] == self.ERR_CODE_NONE and recv_pkt[self.INDEX_RES_STATUS] == self.STATUS_SUCCESS):
-      length = recv_pkt[self.INDEX_RES_LEN_L] | (recv_pkt[self.INDEX_RES_LEN_H] << 8)
-      if length:
-        for data in recv_pkt[self.INDEX_RES_DATA:]:
-          rslt += chr(data)
-    return rslt
+    return self._execute_text(self.CMD_GET_ALL_DATA, bytearray([1 if state == True else 0]))
 
   def set_time(self, year, month, day,hour, minute, second):
     '''!
@@ -260,90 +187,38 @@ class DFRobot_Atmospherlum:
       @param minute Minute
       @param second Second
     '''
-    length = 7
-    pkt = [0] * (3 + length)
-    pkt[self.INDEX_CMD]        = self.CMD_SET_TIME
-    pkt[self.INDEX_ARGS_NUM_L] = length & 0xFF
-    pkt[self.INDEX_ARGS_NUM_H] = (length >> 8) & 0xFF
-    pkt[self.INDEX_ARGS + self.INDEX_YEAR]       = (year - 2000)
-    pkt[self.INDEX_ARGS + self.INDEX_MONTH]       = month
-    pkt[self.INDEX_ARGS + self.INDEX_DAY]       = day
-    pkt[self.INDEX_ARGS + self.INDEX_WEEK]       = 0
-    pkt[self.INDEX_ARGS + self.INDEX_HOUR]       = hour
-    pkt[self.INDEX_ARGS + self.INDEX_MINUTE]       = minute
-    pkt[self.INDEX_ARGS + self.INDEX_SECOND]       = second
-    self._send_packet(pkt)
-    time.sleep(0.1)
-    recv_pkt = self._recv_packet(self.CMD_SET_TIME)
-    if (len(recv_pkt) >= 5) and (recv_pkt[self.INDEX_RES_ERR] == self.ERR_CODE_NONE and recv_pkt[self.INDEX_RES_STATUS] == self.STATUS_SUCCESS):
-      length = recv_pkt[self.INDEX_RES_LEN_L] | (recv_pkt[self.INDEX_RES_LEN_H] << 8)
+    args = bytearray(7)
+    args[self.INDEX_YEAR]   = (year - 2000) & 0xFF
+    args[self.INDEX_MONTH]  = month
+    args[self.INDEX_DAY]    = day
+    args[self.INDEX_WEEK]   = 0
+    args[self.INDEX_HOUR]   = hour
+    args[self.INDEX_MINUTE] = minute
+    args[self.INDEX_SECOND] = second
+    return self._execute_status(self.CMD_SET_TIME, args)
 
   def get_time_stamp(self):
     '''!
       @brief Get the RTC time
     '''
-    rslt = ""
-    length = 0
-    pkt = [0] * (3 + length)
-    pkt[self.INDEX_CMD]        = self.CME_GET_TIME
-    pkt[self.INDEX_ARGS_NUM_L] = length & 0xFF
-    pkt[self.INDEX_ARGS_NUM_H] = (length >> 8) & 0xFF
-    self._send_packet(pkt)
-    time.sleep(0.1)
-    recv_pkt = self._recv_packet(self.CME_GET_TIME)
-    if (len(recv_pkt) >= 5) and (recv_pkt[self.INDEX_RES_ERR] == self.ERR_CODE_NONE and recv_pkt[self.INDEX_RES_STATUS] == self.STATUS_SUCCESS):
-      length = recv_pkt[self.INDEX_RES_LEN_L] | (recv_pkt[self.INDEX_RES_LEN_H] << 8)
-      if length:
-        for data in recv_pkt[self.INDEX_RES_DATA:]:
-          rslt += chr(data)
-    return rslt
-  
+    return self._execute_text(self.CME_GET_TIME, "")
+
   def config_DTU(self, dtuswitch, method):
     '''!
       @brief Configure DTU enablement.
       @param dtuswitch DTU switch
       @param method Operation mode
     '''
-    data = dtuswitch + ',' + method
-    length = len(data)
-    pkt = [0] * (3 + length)
-    pkt[self.INDEX_CMD]        = self.CMD_DTU
-    pkt[self.INDEX_ARGS_NUM_L] = length & 0xFF
-    pkt[self.INDEX_ARGS_NUM_H] = (length >> 8) & 0xFF
-    i = 0
-    for c in data:
-      pkt[self.INDEX_ARGS + i] = ord(c)
-      i += 1
-    self._send_packet(pkt)
-    time.sleep(0.1)
-    recv_pkt = self._recv_packet(self.CMD_DTU)
-    if (len(recv_pkt) >= 5) and (recv_pkt[self.INDEX_RES_ERR] == self.ERR_CODE_NONE and recv_pkt[self.INDEX_RES_STATUS] == self.STATUS_SUCCESS):
-      return 1
-    return 0
-  
+    return self._execute_status(self.CMD_DTU, dtuswitch + ',' + method)
+
   def config_WIFI(self,ssid,pwd):
     '''!
       @brief Configure WiFi information.
       @param SSID WiFi name
       @param PWD WiFi password
     '''
-    data = ssid + ',' + pwd
-    length = len(data)
-    pkt = [0] * (3 + length)
-    pkt[self.INDEX_CMD]        = self.CMD_WIFI
-    pkt[self.INDEX_ARGS_NUM_L] = length & 0xFF
-    pkt[self.INDEX_ARGS_NUM_H] = (length >> 8) & 0xFF
-    i = 0
-    for c in data:
-      pkt[self.INDEX_ARGS + i] = ord(c)
-      i += 1
-    self._send_packet(pkt)
-    time.sleep(0.1)
-    recv_pkt = self._recv_packet(self.CMD_WIFI)
-    if (len(recv_pkt) >= 5) and (recv_pkt[self.INDEX_RES_ERR] == self.ERR_CODE_NONE and recv_pkt[self.INDEX_RES_STATUS] == self.STATUS_SUCCESS):
-      return 1
-    return 0
-  
+    return self._execute_status(self.CMD_WIFI, ssid + ',' + pwd)
+
   def config_Lora(self,deui,eui,key):
     '''!
       @brief Configure LoRa.
@@ -351,23 +226,8 @@ class DFRobot_Atmospherlum:
       @param EUI Node
       @param KEY Key
     '''
-    data = deui + ',' + eui + ',' + key
-    length = len(data)
-    pkt = [0] * (3 + length)
-    pkt[self.INDEX_CMD]        = self.CMD_LORA
-    pkt[self.INDEX_ARGS_NUM_L] = length & 0xFF
-    pkt[self.INDEX_ARGS_NUM_H] = (length >> 8) & 0xFF
-    i = 0
-    for c in data:
-      pkt[self.INDEX_ARGS + i] = ord(c)
-      i += 1
-    self._send_packet(pkt)
-    time.sleep(0.1)
-    recv_pkt = self._recv_packet(self.CMD_LORA)
-    if (len(recv_pkt) >= 5) and (recv_pkt[self.INDEX_RES_ERR] == self.ERR_CODE_NONE and recv_pkt[self.INDEX_RES_STATUS] == self.STATUS_SUCCESS):
-      return 1
-    return 0
-  
+    return self._execute_status(self.CMD_LORA, deui + ',' + eui + ',' + key)
+
   def config_MQTT1(self,Server,Server_IP,Save):
     '''!
       @brief MQTT configuration 1.
@@ -375,71 +235,66 @@ class DFRobot_Atmospherlum:
       @param Server_IP MQTT platform IP
       @param Save Whether to save transmitted data
     '''
-    data = Server + ',' + Server_IP + ',' +  Save
-    length = len(data)
-    pkt = [0] * (3 + length)
-    pkt[self.INDEX_CMD]        = self.CMD_MQTT1
-    pkt[self.INDEX_ARGS_NUM_L] = length & 0xFF
-    pkt[self.INDEX_ARGS_NUM_H] = (length >> 8) & 0xFF
-    i = 0
-    for c in data:
-      pkt[self.INDEX_ARGS + i] = ord(c)
-      i += 1
-    self._send_packet(pkt)
-    time.sleep(0.1)
-    recv_pkt = self._recv_packet(self.CMD_MQTT1)
-    if (len(recv_pkt) >= 5) and (recv_pkt[self.INDEX_RES_ERR] == self.ERR_CODE_NONE and recv_pkt[self.INDEX_RES_STATUS] == self.STATUS_SUCCESS):
-      return 1
-    return 0
+    return self._execute_status(self.CMD_MQTT1, Server + ',' + Server_IP + ',' +  Save)
+
   def config_MQTT2(self,Iot_ID,Iot_PWD):
     '''!
       @brief MQTT configuration 2.
       @param Iot_ID Login username
       @param Iot_PWD Login password
     '''
-    data = Iot_ID + ',' + Iot_PWD
-    length = len(data)
-    pkt = [0] * (3 + length)
-    pkt[self.INDEX_CMD]        = self.CMD_MQTT2
-    pkt[self.INDEX_ARGS_NUM_L] = length & 0xFF
-    pkt[self.INDEX_ARGS_NUM_H] = (length >> 8) & 0xFF
-    i = 0
-    for c in data:
-      pkt[self.INDEX_ARGS + i] = ord(c)
-      i += 1
-    self._send_packet(pkt)
-    time.sleep(0.1)
-    recv_pkt = self._recv_packet(self.CMD_MQTT2)
-    if (len(recv_pkt) >= 5) and (recv_pkt[self.INDEX_RES_ERR] == self.ERR_CODE_NONE and recv_pkt[self.INDEX_RES_STATUS] == self.STATUS_SUCCESS):
-      return 1
-    return 0
-  
+    return self._execute_status(self.CMD_MQTT2, Iot_ID + ',' + Iot_PWD)
+
   def config_Topic(self,name,chan):
     '''!
       @brief Topic subscription.
       @param name Topic name
       @param chan Key
     '''
-    data = name + ':' + chan
-    length = len(data)
-    pkt = [0] * (3 + length)
-    pkt[self.INDEX_CMD]        = self.CMD_TOP
-    pkt[self.INDEX_ARGS_NUM_L] = length & 0xFF
-    pkt[self.INDEX_ARGS_NUM_H] = (length >> 8) & 0xFF
-    i = 0
-    for c in data:
-      pkt[self.INDEX_ARGS + i] = ord(c)
-      i += 1
+    return self._execute_status(self.CMD_TOP, name + ':' + chan)
+
+  def _centi_args(self, value):
+    data = int(value * 100 + 0.5)
+    if data < 0 or data > 0xFFFF:
+      return None
+    return bytearray([data >> 8, data & 0xFF])
+
+  def _execute_text(self, cmd, args):
+    recv_pkt = self._execute(cmd, args)
+    rslt = ""
+    if self._succeeded(recv_pkt):
+      for data in recv_pkt[self.INDEX_RES_DATA:]:
+        rslt += chr(data)
+    return rslt
+
+  def _execute_status(self, cmd, args):
+    if args is None:
+      return 0
+    return 1 if self._succeeded(self._execute(cmd, args)) else 0
+
+  def _succeeded(self, recv_pkt):
+    return (len(recv_pkt) >= 5) and (recv_pkt[self.INDEX_RES_ERR] == self.ERR_CODE_NONE) and (recv_pkt[self.INDEX_RES_STATUS] == self.STATUS_SUCCESS)
+
+  def _execute(self, cmd, args):
+    '''!
+      @brief Send a command and wait for its response
+      @param cmd Command
+      @param args Argument bytes or text
+      @return Response packet list, see _recv_packet
+    '''
+    if not isinstance(args, bytearray):
+      args = bytearray(args, 'ascii')
+    length = len(args)
+    pkt = bytearray([cmd, length & 0xFF, (length >> 8) & 0xFF]) + args
+    self._recv_flush()
     self._send_packet(pkt)
-    time.sleep(0.1)
-    recv_pkt = self._recv_packet(self.CMD_TOP)
-    if (len(recv_pkt) >= 5) and (recv_pkt[self.INDEX_RES_ERR] == self.ERR_CODE_NONE and recv_pkt[self.INDEX_RES_STATUS] == self.STATUS_SUCCESS):
-      return 1
-    return 0
+    return self._recv_packet(cmd)
 
   def _recv_packet(self, cmd):
     '''!
       @brief Receive and parse the response data packet
+      @n     The status is polled from the command's usual latency on, with gaps growing from POLL_MIN to POLL_MAX,
+      @n     until the command's deadline
       @param cmd Command to receive the packet
       @return Error code and response packet list
       @n      The zeroth element in the list: error code, only when the error code is ERR_CODE_NONE, there can be other elements
@@ -449,124 +304,145 @@ class DFRobot_Atmospherlum:
       @n      The fourth element in the list: high byte of the valid data length after the response packet
       @n      The 5th element or more in the list: valid data
     '''
-    rslt = [0] * 1
     t = time.time()
-    while time.time() - t < self.DEBUG_TIMEOUT_MS:
-      status = self._recv_data(1)[0]
-      #print(status)
-      if status != 0xff:
-        if status == 0xD3:
-          self._reset_data()
-          time.sleep(0.2)
-        else:
-          if status == self.STATUS_SUCCESS or status == self.STATUS_FAILED:
-            command = self._recv_data(1)[0]
-            #print("command=%x cmd=%x"%(command,cmd))
-            if command != cmd:
-              rslt[0] = self.ERR_CODE_RES_PKT
-              #print("Response pkt is error!")
-              return rslt
-            lenL = self._recv_data(2)
-            length = (lenL[1] << 2) | lenL[0]
-            #print("length=%x length=%d"%(length,length))
-            rslt[0] = self.ERR_CODE_NONE
-            rslt = rslt + [status, command, lenL[0], lenL[1]]
-            if length:
-              rslt = rslt + self._recv_data(length)
-            #print(rslt)
-            #print("time: %f"%(time.time() - t))
-            return rslt
-      time.sleep(0.1)
+    deadline = t + self._deadline.get(cmd, self.DEBUG_TIMEOUT_MS)
+    time.sleep(self._latency.get(cmd, 0.005))
+    gap = 0
+    while True:
+      status = self._poll_status()
+      if status == self.STATUS_CORRUPT:
+        self._recv_flush()
+        self._reset_data()
+        gap = self.POLL_MAX
+      elif status == self.STATUS_SUCCESS or status == self.STATUS_FAILED:
+        header = self._recv_data(3)
+        command = header[0]
+        if command != cmd:
+          return [self.ERR_CODE_RES_PKT]
+        length = header[1] | (header[2] << 8)
+        rslt = [self.ERR_CODE_NONE, status, command, header[1], header[2]]
+        if length:
+          rslt = rslt + self._recv_data(length)
+        return rslt
+      else:
+        # Not ready yet, probe again soon and back off while the device stays busy
+        gap = min(gap * 2, self.POLL_MAX) if gap else self.POLL_MIN
+      remain = deadline - time.time()
+      if remain <= 0:
+        break
+      time.sleep(min(gap, remain))
     print("time out: %f"%(time.time() - t))
     return [self.ERR_CODE_RES_TIMEOUT]
-    
+
   def _reset_data(self):
-    length = 0
-    pkt = [0] * (3 + length)
-    pkt[self.INDEX_CMD]        = self.CMD_RESET_DATA
-    pkt[self.INDEX_ARGS_NUM_L] = 0
-    pkt[self.INDEX_ARGS_NUM_H] = 0
-    self._send_packet(pkt)
-    time.sleep(0.1)
-    
+    self._send_packet(bytearray([self.CMD_RESET_DATA, 0, 0]))
+
+  def _recv_flush(self):
+    pass
+
 
 
 class DFRobot_Atmospherlum_I2C(DFRobot_Atmospherlum):
-  def __init__(self,addr):
+  def __init__(self,addr,bus = 1):
     '''!
-      @brief DFRobot_SCI_IIC Constructor
-      @param addr:  7-bit IIC address, support the following address settings
-      @n RP2040_SCI_ADDR_0X21      0x21 default I2C address
-      @n RP2040_SCI_ADDR_0X22      0x22
-      @n RP2040_SCI_ADDR_0X23      0x23
+      @brief DFRobot_Atmospherlum_I2C Constructor
+      @param addr:  7-bit IIC address
+      @param bus:  I2C bus number, or an opened smbus2.SMBus
     '''
     self._addr = addr
-    self._bus = smbus.SMBus(1)
+    self._bus = SMBus(bus) if isinstance(bus, int) else bus
     DFRobot_Atmospherlum.__init__(self)
-    
 
   def _send_packet(self, pkt):
     '''!
-      @brief Send data
-      @param pkt List of data to be sent
+      @brief Send data, one transfer with a repeated start every IIC_MAX_TRANSFER bytes
+      @param pkt Data to be sent
       @return None
     '''
-    for data in pkt:
-      try:
-        self._bus.write_byte(self._addr, data)
-      except:
-        pass
-    
-  def _recv_data(self, len):
+    msgs = [i2c_msg.write(self._addr, pkt[i:i + self.IIC_MAX_TRANSFER]) for i in range(0, len(pkt), self.IIC_MAX_TRANSFER)]
+    try:
+      self._bus.i2c_rdwr(*msgs)
+    except IOError:
+      pass
+
+  def _poll_status(self):
+    '''!
+      @brief Read the status byte, the device answers 0xff while it has nothing to send
+      @return The status, None when not ready
+    '''
+    status = self._recv_data(1)[0]
+    return None if status == 0xFF else status
+
+  def _recv_data(self, length):
     '''!
-      @brief Read data
-      @param len Number of bytes to be read
+      @brief Read data, one transfer with a repeated start every I2C_ACHE_MAX_LEN bytes
+      @param length Number of bytes to be read
       @return The read data list
     '''
-    rslt = [0]*len
-    i = 0
-    while i < len:
-      try:
-        rslt[i] = self._bus.read_byte(self._addr)
-      except:
-        rslt[i] = 0
-      i += 1
+    msgs = [i2c_msg.read(self._addr, min(self.I2C_ACHE_MAX_LEN, length - i)) for i in range(0, length, self.I2C_ACHE_MAX_LEN)]
+    try:
+      self._bus.i2c_rdwr(*msgs)
+    except IOError:
+      return [0] * length
+    rslt = []
+    for msg in msgs:
+      rslt += list(msg)
     return rslt
 
 class DFRobot_Atmospherlum_UART(DFRobot_Atmospherlum):
-  def __init__(self):
+  def __init__(self, port = "/dev/ttyAMA0", ser = None):
     '''!
-      @brief DFRobot_SCI_IIC Constructor
-      @param addr:  7-bit IIC address, support the following address settings
-      @n RP2040_SCI_ADDR_0X21      0x21 default I2C address
-      @n RP2040_SCI_ADDR_0X22      0x22
-      @n RP2040_SCI_ADDR_0X23      0x23
+      @brief DFRobot_Atmospherlum_UART Constructor
+      @param port Serial device, 115200 baud
+      @param ser An opened serial.Serial-like port to use instead
     '''
-    self.ser = serial.Serial("/dev/ttyAMA0",115200)
-    if self.ser.isOpen == False:
+    self.ser = ser if ser is not None else serial.Serial(port, 115200, timeout = 0.1)
+    if not self.ser.is_open:
       self.ser.open()
+    self._rx = bytearray()
     DFRobot_Atmospherlum.__init__(self)
+
   def _send_packet(self, pkt):
     '''!
       @brief Send data
-      @param pkt List of data to be sent
+      @param pkt Data to be sent
       @return None
     '''
     self.ser.write(pkt)
-    
-  def _recv_data(self, len):
+
+  def _recv_flush(self):
+    self._rx = bytearray()
+    self.ser.reset_input_buffer()
+
+  def _fill(self):
+    waiting = self.ser.in_waiting
+    if waiting:
+      self._rx += self.ser.read(waiting)
+
+  def _poll_status(self):
+    '''!
+      @brief Take everything received so far in one read, 0xff before the status is line noise
+      @return The status, None when nothing has arrived
+    '''
+    self._fill()
+    while len(self._rx) and self._rx[0] == 0xFF:
+      del self._rx[0]
+    if not len(self._rx):
+      return None
+    status = self._rx[0]
+    del self._rx[0]
+    return status
+
+  def _recv_data(self, length):
     '''!
-      @brief Read data
-      @param len Number of bytes to be read
+      @brief Read data, what is already buffered first, the rest in one read bounded by the port timeout
+      @param length Number of bytes to be read
       @return The read data list
     '''
-    
-    rslt = [0]*len
-    i = 0
-    while i < len:
-      try:
-        rslt[i] =  ord(self.ser.read(1))
-      except:
-        rslt[i] = 0
-      i += 1
-    return rslt
\ No newline at end of file
+    if length > len(self._rx):
+      self._fill()
+    if length > len(self._rx):
+      self._rx += self.ser.read(length - len(self._rx))
+    rslt = list(self._rx[:length])
+    del self._rx[:length]
+    return rslt + [0] * (length - len(rslt))
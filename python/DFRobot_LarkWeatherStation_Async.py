@@ -0,0 +1,264 @@
+# -*- coding: utf-8 -*-
+'''!
+  @file       DFRobot_LarkWeatherStation_Async.py
+  @brief       asyncio client for DFRobot_LarkWeatherStation stations on serial ports
+  @n           The port is read and written without blocking from the event loop, so one process can serve many
+  @n           stations at once, e.g. with asyncio.gather(). Python 3.5 or later, no pyserial needed.
+  @copyright   Copyright (c) 2021 DFRobot Co.Ltd (http://www.dfrobot.com)
+  @license     The MIT License (MIT)
+  @author      TangJie(jie.tang@dfrobot.com)
+  @version     V1.0
+  @date        2023-07-03
+  @url         https://github.com/DFRobor/DFRobot_LarkWeatherStation
+'''
+import asyncio
+import errno
+import os
+import termios
+import tty
+
+from DFRobot_LarkWeatherStation import DFRobot_Atmospherlum
+
+
+class DFRobot_Atmospherlum_Async(DFRobot_Atmospherlum):
+  '''!
+    @brief One station on a serial port. Requests of several tasks are sent one after the other; while one waits
+    @n     for its response the loop serves the other stations.
+  '''
+  QUIET_S  =  0.02   #Silence after which the rest of a timed out response is taken to be gone
+
+  def __init__(self, port = "/dev/ttyAMA0", fd = None, timeout = None, max_pending = 8):
+    '''!
+      @brief DFRobot_Atmospherlum_Async Constructor
+      @param port Serial device, opened at 115200 baud by begin()
+      @param fd An opened non-blocking file descriptor to use instead, e.g. one end of a pty
+      @param timeout Seconds a request may take, None for the per-command deadlines of DFRobot_Atmospherlum
+      @param max_pending Requests that may wait for this station, further requests fail at once with
+      @n                 ERR_CODE_M_NO_SPACE instead of piling up behind a slow station
+    '''
+    DFRobot_Atmospherlum.__init__(self)
+    self._port = port
+    self._fd = fd
+    self._own_fd = fd is None
+    self._timeout = timeout
+    self._max_pending = max_pending
+    self._pending = 0
+    self._lock = None
+    self._loop = None
+    self._rx = bytearray()
+    self._waiter = None
+    self._stale = False   # A request timed out, the rest of its response may still arrive
+    self.last_error = self.ERR_CODE_NONE
+    self.requests = 0     # Requests sent
+    self.timeouts = 0     # Requests without a response before their deadline
+    self.rejected = 0     # Requests refused because max_pending were waiting
+
+  async def begin(self):
+    '''!
+      @brief Open the port and start watching it on the running loop
+      @return int Initialization status
+      @n       0      Initialization successful
+      @n      others  Initialization failed
+    '''
+    self._loop = asyncio.get_event_loop()
+    self._lock = asyncio.Lock()
+    if self._fd is None:
+      try:
+        self._fd = os.open(self._port, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+        tty.setraw(self._fd)
+        attrs = termios.tcgetattr(self._fd)
+        attrs[4] = attrs[5] = termios.B115200
+        termios.tcsetattr(self._fd, termios.TCSANOW, attrs)
+      except OSError:
+        self._fd = None
+        return -1
+    else:
+      os.set_blocking(self._fd, False)
+    self._loop.add_reader(self._fd, self._on_readable)
+    return 0
+
+  def close(self):
+    '''!
+      @brief Stop watching the port and close it if begin() opened it
+    '''
+    if self._fd is None:
+      return
+    self._loop.remove_reader(self._fd)
+    if self._own_fd:
+      os.close(self._fd)
+    self._fd = None
+
+  async def __aenter__(self):
+    await self.begin()
+    return self
+
+  async def __aexit__(self, *exc):
+    self.close()
+
+  async def get_value(self, keys):
+    '''!
+      @brief Get sensor data
+      @param keys  Data to be obtained
+      @return Returns the acquired data, "" on failure, see last_error
+    '''
+    return self._text(await self._execute(self.CMD_GET_DATA, keys))
+
+  async def get_unit(self, keys):
+    '''!
+      @brief Get data units
+      @param keys  Data for which units need to be obtained
+      @return Returns the obtained units
+    '''
+    return self._text(await self._execute(self.CMD_GET_UNIT, keys))
+
+  async def get_information(self, state = True):
+    '''!
+      @brief Get all data
+      @param state true: include timestamp, false: do not include timestamp
+      @return String Returns all the acquired data
+    '''
+    return self._text(await self._execute(self.CMD_GET_ALL_DATA, bytearray([1 if state == True else 0])))
+
+  async def get_time_stamp(self):
+    '''!
+      @brief Get the RTC time
+    '''
+    return self._text(await self._execute(self.CME_GET_TIME, ""))
+
+  async def set_time(self, year, month, day, hour, minute, second):
+    '''!
+      @brief Set the RTC time
+      @return 1 when the device accepted it, 0 otherwise
+    '''
+    args = bytearray([(year - 2000) & 0xFF, month, day, 0, hour, minute, second])
+    return 1 if self._succeeded(await self._execute(self.CMD_SET_TIME, args)) else 0
+
+  def _text(self, recv_pkt):
+    if not self._succeeded(recv_pkt):
+      return ""
+    return "".join(chr(data) for data in recv_pkt[self.INDEX_RES_DATA:])
+
+  async def _execute(self, cmd, args):
+    '''!
+      @brief Queue a command behind the requests already waiting for this station and wait for its response
+      @return Response packet list as DFRobot_Atmospherlum._recv_packet() returns it
+    '''
+    if self._fd is None:
+      rslt = [self.ERR_CODE_SLAVE_BREAK]
+    elif self._pending >= self._max_pending:
+      self.rejected += 1
+      rslt = [self.ERR_CODE_M_NO_SPACE]
+    else:
+      self._pending += 1
+      try:
+        async with self._lock:
+          deadline = self._timeout if self._timeout is not None else self._deadline.get(cmd, self.DEBUG_TIMEOUT_MS)
+          self.requests += 1
+          try:
+            rslt = await asyncio.wait_for(self._exchange(cmd, args), deadline)
+          except asyncio.TimeoutError:
+            self.timeouts += 1
+            self._stale = True
+            rslt = [self.ERR_CODE_RES_TIMEOUT]
+          except OSError:
+            rslt = [self.ERR_CODE_SLAVE_BREAK]
+      finally:
+        self._pending -= 1
+    self.last_error = rslt[0]
+    return rslt
+
+  async def _exchange(self, cmd, args):
+    if not isinstance(args, bytearray):
+      args = bytearray(args, 'ascii')
+    length = len(args)
+    if self._stale:
+      await self._drain()
+    self._rx = bytearray()
+    await self._write(bytearray([cmd, length & 0xFF, (length >> 8) & 0xFF]) + args)
+    while True:
+      status = (await self._read(1))[0]
+      if status == self.STATUS_CORRUPT:
+        # Ask for the response again
+        self._rx = bytearray()
+        await self._write(bytearray([self.CMD_RESET_DATA, 0, 0]))
+      elif status == self.STATUS_SUCCESS or status == self.STATUS_FAILED:
+        break
+      # Anything else before the status is line noise
+    header = await self._read(3)
+    if header[0] != cmd:
+      return [self.ERR_CODE_RES_PKT]
+    length = header[1] | (header[2] << 8)
+    return [self.ERR_CODE_NONE, status, header[0], header[1], header[2]] + list(await self._read(length))
+
+  async def _read(self, length):
+    while len(self._rx) < length:
+      self._waiter = self._loop.create_future()
+      try:
+        await self._waiter
+      finally:
+        self._waiter = None
+    rslt = self._rx[:length]
+    del self._rx[:length]
+    return rslt
+
+  async def _drain(self):
+    '''!
+      @brief Drop what is left of a response that timed out, so that it is not taken for the next one: flush the
+      @n     port, then wait until it stays quiet for QUIET_S
+    '''
+    while True:
+      try:
+        termios.tcflush(self._fd, termios.TCIFLUSH)
+      except (termios.error, OSError):
+        # Not a tty, e.g. a pipe; the reader takes what is there and it is dropped with _rx
+        pass
+      self._rx = bytearray()
+      self._waiter = self._loop.create_future()
+      try:
+        await asyncio.wait_for(self._waiter, self.QUIET_S)
+      except asyncio.TimeoutError:
+        break
+      finally:
+        self._waiter = None
+    self._stale = False
+
+  def _on_readable(self):
+    try:
+      data = os.read(self._fd, 4096)
+    except OSError as e:
+      if e.errno in (errno.EAGAIN, errno.EINTR):
+        return
+      data = b''
+    if not data:
+      # The port went away, e.g. a USB adapter was unplugged
+      self.close()
+      if self._waiter is not None and not self._waiter.done():
+        self._waiter.set_exception(OSError(errno.EIO, "serial port closed"))
+      return
+    self._rx += data
+    if self._waiter is not None and not self._waiter.done():
+      self._waiter.set_result(None)
+
+  async def _write(self, data):
+    '''!
+      @brief Write all of data, waiting for the port to drain when its buffer is full
+    '''
+    view = memoryview(data)
+    while len(view):
+      if self._fd is None:
+        raise OSError(errno.EIO, "serial port closed")
+      try:
+        n = os.write(self._fd, view)
+      except OSError as e:
+        if e.errno not in (errno.EAGAIN, errno.EINTR):
+          raise
+        n = 0
+      view = view[n:]
+      if len(view):
+        fd = self._fd
+        writable = self._loop.create_future()
+        self._loop.add_writer(fd, writable.set_result, None)
+        try:
+          await writable
+        finally:
+          self._loop.remove_writer(fd)
@@ -0,0 +1,118 @@
+# -*- coding: utf-8 -*-
+'''!
+  @file bench_async.py
+  @brief Load test of DFRobot_Atmospherlum_Async against simulated stations on pty pairs
+  @n     Usage: python3 bench_async.py [--stations 1,20,200] [--seconds 3] [--latency MS] [--json]
+  @n     Every station answers get_value() after the processing latency; one task per station requests in a loop.
+  @n     Prints requests per second, response time percentiles and the cycle, the time until every station was read
+  @n     once; read one after the other, the cycle would be the station number times the single station p50.
+  @n     The stations run on the same loop, so the figures include their cost.
+  @copyright    Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+  @license      The MIT License (MIT)
+  @author       [TangJie](jie.tang@dfrobot.com)
+  @version      V1.0.0
+  @date         2023-06-8
+  @url         https://github.com/DFRobot/DFRobot_LarkWeatherStation
+'''
+import asyncio
+import json
+import os
+import sys
+import time
+import tty
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+
+from DFRobot_LarkWeatherStation_Async import DFRobot_Atmospherlum_Async
+
+class PtyStation:
+  '''!
+    @brief Station on the master side of a pty, the client gets the slave side
+  '''
+  def __init__(self, loop, latency):
+    self.loop, self.latency = loop, latency
+    self.master, self.slave = os.openpty()
+    tty.setraw(self.slave)
+    os.set_blocking(self.master, False)
+    self.rx = bytearray()
+    loop.add_reader(self.master, self.on_readable)
+
+  def on_readable(self):
+    self.rx += os.read(self.master, 4096)
+    while len(self.rx) >= 3 and len(self.rx) >= 3 + (self.rx[1] | (self.rx[2] << 8)):
+      length = self.rx[1] | (self.rx[2] << 8)
+      cmd = self.rx[0]
+      del self.rx[:3 + length]
+      payload = b"20.07"
+      self.loop.call_later(self.latency, os.write, self.master, bytes(bytearray([0x53, cmd, len(payload), 0])) + payload)
+
+  def close(self):
+    self.loop.remove_reader(self.master)
+    os.close(self.master)
+    os.close(self.slave)
+
+async def run(stations, seconds, latency):
+  loop = asyncio.get_event_loop()
+  sims = [PtyStation(loop, latency) for i in range(stations)]
+  clients = [DFRobot_Atmospherlum_Async(fd = sim.slave, timeout = 1.0) for sim in sims]
+  for client in clients:
+    await client.begin()
+  times, failed = [], [0]
+  end = time.time() + seconds
+
+  async def station_loop(client):
+    while time.time() < end:
+      start = time.time()
+      if await client.get_value("Temp") == "20.07":
+        times.append(time.time() - start)
+      else:
+        failed[0] += 1
+
+  cpu = time.process_time()
+  start = time.time()
+  await asyncio.gather(*[station_loop(client) for client in clients])
+  elapsed = time.time() - start
+  cpu = time.process_time() - cpu
+  for client in clients:
+    client.close()
+  for sim in sims:
+    sim.close()
+  times.sort()
+  pick = lambda q: times[min(len(times) - 1, int(q * len(times)))] * 1000 if times else 0
+  return {"stations": stations, "requests": len(times) + failed[0], "failed": failed[0],
+          "requests_per_s": len(times) / elapsed, "p50_ms": pick(0.5), "p99_ms": pick(0.99),
+          "cycle_ms": stations * elapsed / max(1, len(times)) * 1000,
+          "cpu_percent": 100 * cpu / elapsed}
+
+def main(argv):
+  stations, seconds, latency, as_json = [1, 20, 200], 3.0, 0.005, False
+  i = 1
+  while i < len(argv):
+    if argv[i] == "--stations" and i + 1 < len(argv):
+      i += 1
+      stations = [int(n) for n in argv[i].split(",")]
+    elif argv[i] == "--seconds" and i + 1 < len(argv):
+      i += 1
+      seconds = float(argv[i])
+    elif argv[i] == "--latency" and i + 1 < len(argv):
+      i += 1
+      latency = float(argv[i]) / 1000
+    elif argv[i] == "--json":
+      as_json = True
+    else:
+      print("usage: %s [--stations 1,20,200] [--seconds 3] [--latency MS] [--json]" % argv[0])
+      return 1
+    i += 1
+  loop = asyncio.get_event_loop()
+  if not as_json:
+    print("%9s %10s %8s %10s %8s %8s %9s %6s" % ("stations", "requests", "failed", "req/s", "p50 ms", "p99 ms", "cycle ms", "cpu %"))
+  for n in stations:
+    row = loop.run_until_complete(run(n, seconds, latency))
+    if as_json:
+      print(json.dumps(row))
+    else:
+      print("%9u %10u %8u %10.1f %8.2f %8.2f %9.2f %6.1f" % (row["stations"], row["requests"], row["failed"], row["requests_per_s"],
+            row["p50_ms"], row["p99_ms"], row["cycle_ms"], row["cpu_percent"]))
+  return 0
+
+if __name__ == "__main__":
+  sys.exit(main(sys.argv))
@@ -0,0 +1,294 @@
+# -*- coding: utf-8 -*-
+'''!
+  @file bench_latency.py
+  @brief Command latency of the Python driver against the previous per-byte driver on a simulated station
+  @n     Usage: python bench_latency.py [--uart] [--latency MS] [--iterations N] [--json]
+  @n     The station, the I2C bus and the serial port are simulated on a virtual clock, so the figures are modelled
+  @n     bus and device time: an I2C transfer costs 0.15 ms plus 9 bits per byte at 100 kHz, a UART byte 10 bits
+  @n     at 115200 baud. Neither smbus2 nor pyserial is needed.
+  @copyright    Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+  @license      The MIT License (MIT)
+  @author       [TangJie](jie.tang@dfrobot.com)
+  @version      V1.0.0
+  @date         2023-06-8
+  @url         https://github.com/DFRobot/DFRobot_LarkWeatherStation
+'''
+from __future__ import print_function
+import sys
+import os
+import json
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+
+import DFRobot_LarkWeatherStation as lark
+from DFRobot_LarkWeatherStation import DFRobot_Atmospherlum, DFRobot_Atmospherlum_I2C, DFRobot_Atmospherlum_UART
+
+I2C_TRANSFER_S = 0.00015      # ioctl and start/address/stop of one transfer
+I2C_BYTE_S     = 9 / 100000.0
+UART_BYTE_S    = 10 / 115200.0
+
+class VirtualClock:
+  def __init__(self):
+    self.now = 0.0
+  def time(self):
+    return self.now
+  def sleep(self, seconds):
+    if seconds > 0:
+      self.now += seconds
+
+clock = VirtualClock()
+
+class SimStation:
+  '''!
+    @brief Station answering the command protocol, responses are ready after the processing latency
+  '''
+  VALUES = {"Temp": ("20.07", "C"), "Humi": ("51.30", "%RH"), "Speed": ("3.40", "m/s"), "Dir": ("NE", ""),
+            "Altitude": ("42.00", "m"), "Pressure": ("1013.25", "hPa")}
+
+  def __init__(self, latency):
+    self.latency = latency
+    self.rx = bytearray()
+    self.tx = bytearray()
+    self.last = bytearray()
+    self.ready = 0
+    self.transfers = 0
+
+  def receive(self, data):
+    self.rx += bytearray(data)
+    while len(self.rx) >= 3 and len(self.rx) >= 3 + (self.rx[1] | (self.rx[2] << 8)):
+      length = self.rx[1] | (self.rx[2] << 8)
+      cmd, args = self.rx[0], bytes(self.rx[3:3 + length]).decode('ascii', 'replace')
+      del self.rx[:3 + length]
+      if cmd == DFRobot_Atmospherlum.CMD_RESET_DATA:
+        # Send the last response again
+        self.tx = bytearray(self.last)
+        continue
+      self.respond(cmd, args)
+
+  def respond(self, cmd, args):
+    d = DFRobot_Atmospherlum
+    payload, latency = "", self.latency
+    if cmd == d.CMD_GET_DATA:
+      payload = self.VALUES.get(args, ("", ""))[0]
+    elif cmd == d.CMD_GET_UNIT:
+      payload = self.VALUES.get(args, ("", ""))[1]
+    elif cmd == d.CMD_GET_ALL_DATA:
+      payload = ",".join(k + ":" + v[0] + " " + v[1] for k, v in self.VALUES.items())
+      latency *= 2
+    elif cmd == d.CME_GET_TIME:
+      payload = "2023/07/03 12:00:00"
+    elif cmd in (d.CMD_RADIUS_DATA, d.CMD_CALIBRATOR):
+      latency = 0.15
+    elif cmd in (d.CMD_SPEED1_DATA, d.CMD_SPEED2_DATA):
+      latency = 0.8
+    data = bytearray(payload, 'ascii')
+    self.tx = bytearray([d.STATUS_SUCCESS, cmd, len(data) & 0xFF, len(data) >> 8]) + data
+    self.last = bytearray(self.tx)
+    self.ready = clock.time() + latency
+
+  def transmit(self, n):
+    '''!
+      @brief Bytes read by a polled master, 0xff while nothing is ready
+    '''
+    out = bytearray()
+    for i in range(n):
+      if clock.time() < self.ready or not self.tx:
+        out.append(0xFF)
+      else:
+        out.append(self.tx.pop(0))
+    return out
+
+class SimMsg:
+  '''!
+    @brief Stands in for smbus2.i2c_msg
+  '''
+  def __init__(self, addr, data, read):
+    self.addr, self.buf, self.is_read = addr, bytearray(data), read
+  @staticmethod
+  def write(addr, data):
+    return SimMsg(addr, data, False)
+  @staticmethod
+  def read(addr, length):
+    return SimMsg(addr, bytearray(length), True)
+  def __iter__(self):
+    return iter(self.buf)
+
+class SimBus:
+  '''!
+    @brief I2C bus with smbus2 block transfers and the smbus byte calls of the previous driver
+  '''
+  def __init__(self, station):
+    self.station = station
+
+  def transfer(self, nbytes):
+    self.station.transfers += 1
+    clock.sleep(I2C_TRANSFER_S + (nbytes + 1) * I2C_BYTE_S)
+
+  def i2c_rdwr(self, *msgs):
+    self.transfer(sum(len(m.buf) + 1 for m in msgs) - 1)
+    for m in msgs:
+      if m.is_read:
+        m.buf = self.station.transmit(len(m.buf))
+      else:
+        self.station.receive(m.buf)
+
+  def write_byte(self, addr, data):
+    self.transfer(1)
+    self.station.receive([data])
+
+  def read_byte(self, addr):
+    self.transfer(1)
+    return self.station.transmit(1)[0]
+
+class SimSerial:
+  '''!
+    @brief 115200 baud port, the response streams in from its ready time
+  '''
+  def __init__(self, station, timeout = 0.1):
+    self.station = station
+    self.timeout = timeout
+    self.is_open = True
+
+  def write(self, data):
+    self.station.transfers += 1
+    clock.sleep(len(data) * UART_BYTE_S)
+    self.station.receive(data)
+
+  @property
+  def in_waiting(self):
+    s = self.station
+    if not s.tx or clock.time() < s.ready:
+      return 0
+    return min(len(s.tx), int((clock.time() - s.ready) / UART_BYTE_S) + 1)
+
+  def read(self, size = 1):
+    self.station.transfers += 1
+    s, out = self.station, bytearray()
+    end = clock.time() + self.timeout
+    while len(out) < size:
+      if s.tx and clock.time() >= s.ready:
+        waiting = self.in_waiting
+        if waiting:
+          n = min(waiting, size - len(out))
+          out += s.tx[:n]
+          del s.tx[:n]
+          continue
+      step = max(s.ready - clock.time(), UART_BYTE_S) if s.tx else end - clock.time()
+      if clock.time() + step > end:
+        clock.sleep(end - clock.time())
+        break
+      clock.sleep(step)
+    return bytes(out)
+
+  def reset_input_buffer(self):
+    pass
+
+class LegacyDriver:
+  '''!
+    @brief The request path of the previous driver: byte-wise transfers, fixed sleeps and 0.1 s between polls
+  '''
+  SLEEP = {DFRobot_Atmospherlum.CMD_GET_ALL_DATA: 0.1, DFRobot_Atmospherlum.CMD_SET_TIME: 0.1,
+           DFRobot_Atmospherlum.CME_GET_TIME: 0.1, DFRobot_Atmospherlum.CMD_RADIUS_DATA: 2,
+           DFRobot_Atmospherlum.CMD_SPEED1_DATA: 10}
+
+  def __init__(self, bus = None, ser = None):
+    self.bus, self.ser = bus, ser
+
+  def send(self, pkt):
+    if self.bus:
+      for data in pkt:
+        self.bus.write_byte(0x42, data)
+    else:
+      self.ser.write(bytearray(pkt))
+
+  def recv(self, length):
+    if self.bus:
+      return [self.bus.read_byte(0x42) for i in range(length)]
+    return [bytearray(self.ser.read(1) or b'\0')[0] for i in range(length)]
+
+  def execute(self, cmd, args):
+    args = bytearray(args, 'ascii') if not isinstance(args, bytearray) else args
+    self.send([cmd, len(args) & 0xFF, len(args) >> 8] + list(args))
+    clock.sleep(self.SLEEP.get(cmd, 0))
+    t = clock.time()
+    while clock.time() - t < DFRobot_Atmospherlum.DEBUG_TIMEOUT_MS:
+      status = self.recv(1)[0]
+      if status in (DFRobot_Atmospherlum.STATUS_SUCCESS, DFRobot_Atmospherlum.STATUS_FAILED):
+        header = self.recv(3)
+        length = header[1] | (header[2] << 8)
+        return "".join(chr(c) for c in self.recv(length))
+      clock.sleep(0.1)
+    return None
+
+def run(uart, latency, iterations):
+  lark.time = clock
+  lark.i2c_msg = SimMsg
+  d = DFRobot_Atmospherlum
+  station = SimStation(latency)
+  if uart:
+    new, old = DFRobot_Atmospherlum_UART(ser = SimSerial(station)), LegacyDriver(ser = SimSerial(station))
+  else:
+    new, old = DFRobot_Atmospherlum_I2C(0x42, SimBus(station)), LegacyDriver(bus = SimBus(station))
+  keys = ["Speed", "Dir", "Temp", "Humi", "Pressure", "Altitude"]
+  cases = [
+    ("get_value", lambda: new.get_value("Temp"), lambda: old.execute(d.CMD_GET_DATA, "Temp")),
+    ("get_unit", lambda: new.get_unit("Temp"), lambda: old.execute(d.CMD_GET_UNIT, "Temp")),
+    ("get_information", lambda: new.get_information(True), lambda: old.execute(d.CMD_GET_ALL_DATA, bytearray([1]))),
+    ("get_time_stamp", lambda: new.get_time_stamp(), lambda: old.execute(d.CME_GET_TIME, "")),
+    ("set_time", lambda: new.set_time(2023, 7, 3, 12, 0, 0), lambda: old.execute(d.CMD_SET_TIME, bytearray([23, 7, 3, 0, 12, 0, 0]))),
+    ("set_radius", lambda: new.set_radius(9), lambda: old.execute(d.CMD_RADIUS_DATA, bytearray([3, 132]))),
+    ("set_speed1", lambda: new.set_speed1(3), lambda: old.execute(d.CMD_SPEED1_DATA, bytearray([1, 44]))),
+    ("six fields", lambda: [new.get_value(k) for k in keys], lambda: [old.execute(d.CMD_GET_DATA, k) for k in keys]),
+  ]
+  rows = []
+  for name, new_call, old_call in cases:
+    row = {"command": name}
+    for label, call in (("old", old_call), ("new", new_call)):
+      station.transfers = 0
+      start = clock.time()
+      for i in range(iterations):
+        result = call()
+      row[label + "_ms"] = (clock.time() - start) * 1000 / iterations
+      row[label + "_transfers"] = station.transfers / float(iterations)
+      row[label + "_result"] = result
+    rows.append(row)
+  return rows
+
+def main(argv):
+  uart, latency, iterations, as_json = False, 0.005, 20, False
+  i = 1
+  while i < len(argv):
+    if argv[i] == "--uart":
+      uart = True
+    elif argv[i] == "--latency" and i + 1 < len(argv):
+      i += 1
+      latency = float(argv[i]) / 1000
+    elif argv[i] == "--iterations" and i + 1 < len(argv):
+      i += 1
+      iterations = int(argv[i])
+    elif argv[i] == "--json":
+      as_json = True
+    else:
+      print("usage: %s [--uart] [--latency MS] [--iterations N] [--json]" % argv[0])
+      return 1
+    i += 1
+  rows = run(uart, latency, iterations)
+  if not as_json:
+    print("%-16s %10s %10s %8s %10s %10s" % ("command", "old ms", "new ms", "speedup", "old xfer", "new xfer"))
+  for row in rows:
+    if row["new_result"] == 1:
+      # Status commands, the previous driver returned no result
+      ok = row["old_result"] is not None
+    else:
+      ok = row["old_result"] == row["new_result"]
+    if not ok:
+      print("%s: results differ, %r != %r" % (row["command"], row["old_result"], row["new_result"]))
+      return 1
+    if as_json:
+      print(json.dumps({k: v for k, v in row.items() if not k.endswith("_result")}))
+    else:
+      print("%-16s %10.2f %10.2f %7.1fx %10.1f %10.1f" % (row["command"], row["old_ms"], row["new_ms"],
+            row["old_ms"] / row["new_ms"], row["old_transfers"], row["new_transfers"]))
+  return 0
+
+if __name__ == "__main__":
+  sys.exit(main(sys.argv))
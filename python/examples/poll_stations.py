@@ -0,0 +1,37 @@
+# -*- coding: utf-8 -*-
+'''!
+  @file poll_stations.py
+  @brief Read several stations at the same time with the asyncio client
+  @n     Pass the serial ports of the stations, e.g. python3 poll_stations.py /dev/ttyUSB0 /dev/ttyUSB1
+  @copyright    Copyright (c) 2010 DFRobot Co.Ltd (http://www.dfrobot.com)
+  @license      The MIT License (MIT)
+  @author       [TangJie](jie.tang@dfrobot.com)
+  @version      V1.0.0
+  @date         2023-06-8
+  @url         https://github.com/DFRobot/DFRobot_LarkWeatherStation
+'''
+import asyncio
+import sys
+sys.path.append("../")
+
+from DFRobot_LarkWeatherStation_Async import DFRobot_Atmospherlum_Async
+
+async def read_station(port):
+  station = DFRobot_Atmospherlum_Async(port, timeout = 0.5)
+  if await station.begin() != 0:
+    print(port, "cannot be opened")
+    return
+  while True:
+    temp = await station.get_value("Temp")
+    humi = await station.get_value("Humi")
+    if station.last_error != station.ERR_CODE_NONE:
+      print(port, "error", station.last_error)
+    else:
+      print(port, "Temp=", temp, "Humi=", humi)
+    await asyncio.sleep(1)
+
+async def main(ports):
+  await asyncio.gather(*[read_station(port) for port in ports])
+
+if __name__ == "__main__":
+  asyncio.get_event_loop().run_until_complete(main(sys.argv[1:] or ["/dev/ttyAMA0"]))